@@ -0,0 +1,448 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___ATOMIC_OPTIONAL_HPP___
+# define ___ATOMIC_OPTIONAL_HPP___
+
+# include "optional.hpp"
+# include <atomic>
+# include <thread>
+# include <cstdint>
+# include <cstring>
+
+// A double-word CAS is only used where the compiler emits it inline (x86-64 with -mcx16);
+// otherwise values that do not fit a single word go to the spinlock implementation.
+# if defined __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16 && defined __SIZEOF_INT128__
+#   define OPTIONAL_HAS_DOUBLE_WORD_CAS 1
+# else
+#   define OPTIONAL_HAS_DOUBLE_WORD_CAS 0
+# endif
+
+// compare_exchange compares values bit by bit, so the padding bits of T are zeroed in the
+// copies compared (as std::atomic does in C++20); without the builtin T may have no padding
+# if defined __has_builtin
+#   if __has_builtin(__builtin_clear_padding)
+#     define OPTIONAL_HAS_CLEAR_PADDING 1
+#   endif
+# endif
+# if !defined OPTIONAL_HAS_CLEAR_PADDING
+#   define OPTIONAL_HAS_CLEAR_PADDING 0
+# endif
+
+namespace std{
+
+namespace experimental{
+
+// How atomic_optional<T> stores its state, by the size of T (atomic_optional<T>::implementation):
+//   packed_word  sizeof(T) < 8: the value and a flag byte in one word of up to 8 bytes
+//   niche_word   atomic_optional_niche<T> is specialized and sizeof(T) is 1, 2, 4 or 8: the value
+//                alone in a word of its size, the disengaged state being the niche
+//   double_word  sizeof(T) < 16 and OPTIONAL_HAS_DOUBLE_WORD_CAS: the value and a flag byte in 16 bytes
+//   spinlock     otherwise, e.g. an 8-byte T (a pointer, a double) without -mcx16 or a niche
+// Only the spinlock is not lock-free.
+enum class atomic_optional_implementation { packed_word, niche_word, double_word, spinlock };
+
+// atomic_optional_niche<T>: derive from true_type and add `static T niche() noexcept`, a value
+// that is never stored, and atomic_optional<T> represents the disengaged state by it
+template <class T>
+struct atomic_optional_niche : false_type {};
+
+
+namespace detail_
+{
+
+// the smallest unsigned integer that can hold sizeof(T) bytes of value plus one flag byte
+template <size_t N> struct atomic_word { typedef void type; };
+template <> struct atomic_word<1> { typedef uint8_t type; };
+template <> struct atomic_word<2> { typedef uint16_t type; };
+template <> struct atomic_word<4> { typedef uint32_t type; };
+template <> struct atomic_word<8> { typedef uint64_t type; };
+# if OPTIONAL_HAS_DOUBLE_WORD_CAS
+template <> struct atomic_word<16> { typedef unsigned __int128 type; };
+# endif
+
+constexpr size_t atomic_word_size(size_t n)
+{
+  return n <= 1 ? 1 : n <= 2 ? 2 : n <= 4 ? 4 : n <= 8 ? 8 : n <= 16 ? 16 : 0;
+}
+
+template <class T>
+using atomic_word_t = typename atomic_word<atomic_word_size(sizeof(T) + 1)>::type;
+
+
+// copies the object representation of v to out, with the padding bits zeroed
+template <class T>
+void copy_value_bits(void* out, const T& v) noexcept
+{
+# if OPTIONAL_HAS_CLEAR_PADDING
+  typename aligned_storage<sizeof(T), alignof(T)>::type tmp;
+  std::memcpy(&tmp, std::addressof(v), sizeof(T));
+  __builtin_clear_padding(reinterpret_cast<T*>(&tmp));
+  std::memcpy(out, &tmp, sizeof(T));
+# else
+  std::memcpy(out, std::addressof(v), sizeof(T));
+# endif
+}
+
+
+// word cells: the same interface over std::atomic and over the double-word builtins
+template <class W>
+class atomic_word_cell
+{
+  std::atomic<W> w_;
+
+public:
+  constexpr atomic_word_cell(W w) noexcept : w_(w) {}
+
+  bool is_lock_free() const noexcept { return w_.is_lock_free(); }
+  W load(memory_order mo) const noexcept { return w_.load(mo); }
+  void store(W w, memory_order mo) noexcept { w_.store(w, mo); }
+  W exchange(W w, memory_order mo) noexcept { return w_.exchange(w, mo); }
+
+  bool compare_exchange_weak(W& e, W d, memory_order mo) noexcept
+  {
+    return w_.compare_exchange_weak(e, d, mo, mo == memory_order_acq_rel ? memory_order_acquire
+                                            : mo == memory_order_release ? memory_order_relaxed : mo);
+  }
+
+  bool compare_exchange_strong(W& e, W d, memory_order mo) noexcept
+  {
+    return w_.compare_exchange_strong(e, d, mo, mo == memory_order_acq_rel ? memory_order_acquire
+                                              : mo == memory_order_release ? memory_order_relaxed : mo);
+  }
+};
+
+# if OPTIONAL_HAS_DOUBLE_WORD_CAS
+// cmpxchg16b is a full barrier, so every memory order is honoured by being exceeded
+template <>
+class atomic_word_cell<unsigned __int128>
+{
+  typedef unsigned __int128 W;
+  alignas(16) mutable W w_;
+
+public:
+  constexpr atomic_word_cell(W w) noexcept : w_(w) {}
+
+  bool is_lock_free() const noexcept { return true; }
+  W load(memory_order) const noexcept { return __sync_val_compare_and_swap(&w_, W(0), W(0)); }
+
+  W exchange(W w, memory_order) noexcept
+  {
+    W e = load(memory_order_relaxed);
+    for (;;) {
+      W v = __sync_val_compare_and_swap(&w_, e, w);
+      if (v == e) return e;
+      e = v;
+    }
+  }
+
+  void store(W w, memory_order mo) noexcept { exchange(w, mo); }
+
+  bool compare_exchange_strong(W& e, W d, memory_order) noexcept
+  {
+    W v = __sync_val_compare_and_swap(&w_, e, d);
+    if (v == e) return true;
+    e = v;
+    return false;
+  }
+
+  bool compare_exchange_weak(W& e, W d, memory_order mo) noexcept { return compare_exchange_strong(e, d, mo); }
+};
+# endif
+
+
+enum class atomic_optional_impl { word, niche, spinlock };
+
+template <class T>
+constexpr atomic_optional_impl select_atomic_optional_impl()
+{
+  return atomic_optional_niche<T>::value && atomic_word_size(sizeof(T)) == sizeof(T) ? atomic_optional_impl::niche
+       : is_void<atomic_word_t<T>>::value ? atomic_optional_impl::spinlock : atomic_optional_impl::word;
+}
+
+template <class T, atomic_optional_impl = select_atomic_optional_impl<T>()>
+class atomic_optional_base;
+
+
+// flag and value packed in one word: bytes [0, sizeof(T)) hold the value,
+// byte sizeof(T) holds the flag; the disengaged state is the all-zero word
+template <class T>
+class atomic_optional_base<T, atomic_optional_impl::word>
+{
+  typedef atomic_word_t<T> W;
+  atomic_word_cell<W> cell_;
+
+  static W pack(const optional<T>& o) noexcept
+  {
+    unsigned char bytes[sizeof(W)] = {};
+    if (o) {
+      copy_value_bits(bytes, *o);
+      bytes[sizeof(T)] = 1;
+    }
+    W w;
+    std::memcpy(&w, bytes, sizeof(W));
+    return w;
+  }
+
+  static optional<T> unpack(W w) noexcept
+  {
+    unsigned char bytes[sizeof(W)];
+    std::memcpy(bytes, &w, sizeof(W));
+    if (!bytes[sizeof(T)]) return nullopt;
+    typename aligned_storage<sizeof(T), alignof(T)>::type v;
+    std::memcpy(&v, bytes, sizeof(T));
+    return *reinterpret_cast<const T*>(&v);
+  }
+
+public:
+  constexpr static bool is_always_lock_free = true;
+  constexpr static atomic_optional_implementation implementation =
+    sizeof(W) == 16 ? atomic_optional_implementation::double_word : atomic_optional_implementation::packed_word;
+
+  atomic_optional_base() noexcept : cell_(W(0)) {}
+  explicit atomic_optional_base(const optional<T>& o) noexcept : cell_(pack(o)) {}
+
+  bool is_lock_free() const noexcept { return cell_.is_lock_free(); }
+
+  optional<T> load(memory_order mo) const noexcept { return unpack(cell_.load(mo)); }
+  void store(const optional<T>& o, memory_order mo) noexcept { cell_.store(pack(o), mo); }
+  optional<T> exchange(const optional<T>& o, memory_order mo) noexcept { return unpack(cell_.exchange(pack(o), mo)); }
+
+  bool compare_exchange_weak(optional<T>& e, const optional<T>& d, memory_order mo) noexcept
+  {
+    W we = pack(e);
+    if (cell_.compare_exchange_weak(we, pack(d), mo)) return true;
+    e = unpack(we);
+    return false;
+  }
+
+  bool compare_exchange_strong(optional<T>& e, const optional<T>& d, memory_order mo) noexcept
+  {
+    W we = pack(e);
+    if (cell_.compare_exchange_strong(we, pack(d), mo)) return true;
+    e = unpack(we);
+    return false;
+  }
+};
+
+template <class T>
+constexpr bool atomic_optional_base<T, atomic_optional_impl::word>::is_always_lock_free;
+
+template <class T>
+constexpr atomic_optional_implementation atomic_optional_base<T, atomic_optional_impl::word>::implementation;
+
+
+// the value alone in a word of its size; the disengaged state is the niche, which is never stored
+template <class T>
+class atomic_optional_base<T, atomic_optional_impl::niche>
+{
+  typedef typename atomic_word<sizeof(T)>::type W;
+  atomic_word_cell<W> cell_;
+
+  static W bits(const T& v) noexcept
+  {
+    W w = 0;
+    copy_value_bits(&w, v);
+    return w;
+  }
+
+  static W pack(const optional<T>& o) noexcept
+  {
+    assert (!o || bits(*o) != bits(atomic_optional_niche<T>::niche()));
+    return bits(o ? *o : atomic_optional_niche<T>::niche());
+  }
+
+  static optional<T> unpack(W w) noexcept
+  {
+    if (w == bits(atomic_optional_niche<T>::niche())) return nullopt;
+    typename aligned_storage<sizeof(T), alignof(T)>::type v;
+    std::memcpy(&v, &w, sizeof(T));
+    return *reinterpret_cast<const T*>(&v);
+  }
+
+public:
+  constexpr static bool is_always_lock_free = true;
+  constexpr static atomic_optional_implementation implementation = atomic_optional_implementation::niche_word;
+
+  atomic_optional_base() noexcept : cell_(pack(nullopt)) {}
+  explicit atomic_optional_base(const optional<T>& o) noexcept : cell_(pack(o)) {}
+
+  bool is_lock_free() const noexcept { return cell_.is_lock_free(); }
+
+  optional<T> load(memory_order mo) const noexcept { return unpack(cell_.load(mo)); }
+  void store(const optional<T>& o, memory_order mo) noexcept { cell_.store(pack(o), mo); }
+  optional<T> exchange(const optional<T>& o, memory_order mo) noexcept { return unpack(cell_.exchange(pack(o), mo)); }
+
+  bool compare_exchange_weak(optional<T>& e, const optional<T>& d, memory_order mo) noexcept
+  {
+    W we = pack(e);
+    if (cell_.compare_exchange_weak(we, pack(d), mo)) return true;
+    e = unpack(we);
+    return false;
+  }
+
+  bool compare_exchange_strong(optional<T>& e, const optional<T>& d, memory_order mo) noexcept
+  {
+    W we = pack(e);
+    if (cell_.compare_exchange_strong(we, pack(d), mo)) return true;
+    e = unpack(we);
+    return false;
+  }
+};
+
+template <class T>
+constexpr bool atomic_optional_base<T, atomic_optional_impl::niche>::is_always_lock_free;
+
+template <class T>
+constexpr atomic_optional_implementation atomic_optional_base<T, atomic_optional_impl::niche>::implementation;
+
+
+// fallback: a plain optional<T> guarded by a test-and-set spinlock
+template <class T>
+class atomic_optional_base<T, atomic_optional_impl::spinlock>
+{
+  mutable std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
+  optional<T> val_;
+
+  struct guard
+  {
+    std::atomic_flag& f;
+    explicit guard(std::atomic_flag& f) noexcept : f(f) { while (f.test_and_set(memory_order_acquire)) std::this_thread::yield(); }
+    ~guard() { f.clear(memory_order_release); }
+  };
+
+  // bitwise comparison without the padding, for the same semantics as the lock-free implementations
+  static bool same_bits(const optional<T>& a, const optional<T>& b) noexcept
+  {
+    if (bool(a) != bool(b)) return false;
+    if (!a) return true;
+    unsigned char x[sizeof(T)], y[sizeof(T)];
+    copy_value_bits(x, *a);
+    copy_value_bits(y, *b);
+    return std::memcmp(x, y, sizeof(T)) == 0;
+  }
+
+public:
+  constexpr static bool is_always_lock_free = false;
+  constexpr static atomic_optional_implementation implementation = atomic_optional_implementation::spinlock;
+
+  atomic_optional_base() noexcept {}
+  explicit atomic_optional_base(const optional<T>& o) noexcept : val_(o) {}
+
+  bool is_lock_free() const noexcept { return false; }
+
+  optional<T> load(memory_order) const noexcept { guard g(lock_); return val_; }
+  void store(const optional<T>& o, memory_order) noexcept { guard g(lock_); val_ = o; }
+
+  optional<T> exchange(const optional<T>& o, memory_order) noexcept
+  {
+    guard g(lock_);
+    optional<T> old = val_;
+    val_ = o;
+    return old;
+  }
+
+  bool compare_exchange_strong(optional<T>& e, const optional<T>& d, memory_order) noexcept
+  {
+    guard g(lock_);
+    if (same_bits(val_, e)) { val_ = d; return true; }
+    e = val_;
+    return false;
+  }
+
+  bool compare_exchange_weak(optional<T>& e, const optional<T>& d, memory_order mo) noexcept
+  {
+    return compare_exchange_strong(e, d, mo);
+  }
+};
+
+template <class T>
+constexpr bool atomic_optional_base<T, atomic_optional_impl::spinlock>::is_always_lock_free;
+
+template <class T>
+constexpr atomic_optional_implementation atomic_optional_base<T, atomic_optional_impl::spinlock>::implementation;
+
+} // namespace detail_
+
+
+// atomic_optional<T>: an optional<T> that can be shared between threads without a mutex.
+// Engagement flag and value are read and written as one unit. T must be trivially copyable;
+// like std::atomic<T>, compare_exchange compares object representations, padding excluded.
+// Whether it is lock-free depends on the size of T; see atomic_optional_implementation.
+template <class T>
+class atomic_optional : private detail_::atomic_optional_base<T>
+{
+  static_assert( is_trivially_copyable<T>::value, "atomic_optional requires a trivially copyable T" );
+# if !OPTIONAL_HAS_CLEAR_PADDING && (defined __cpp_lib_has_unique_object_representations)
+  static_assert( has_unique_object_representations<T>::value || is_scalar<T>::value,
+                 "atomic_optional cannot clear the padding of T here: equal values could compare unequal" );
+# endif
+  static_assert( !is_const<T>::value && !is_volatile<T>::value, "bad T" );
+
+  typedef detail_::atomic_optional_base<T> base;
+
+public:
+  typedef T value_type;
+
+  using base::is_always_lock_free;
+  using base::implementation;
+  using base::is_lock_free;
+
+  atomic_optional() noexcept : base() {}
+  atomic_optional(nullopt_t) noexcept : base() {}
+  atomic_optional(const T& v) noexcept : base(optional<T>(v)) {}
+  atomic_optional(const optional<T>& o) noexcept : base(o) {}
+
+  atomic_optional(const atomic_optional&) = delete;
+  atomic_optional& operator=(const atomic_optional&) = delete;
+
+  optional<T> load(memory_order mo = memory_order_seq_cst) const noexcept
+  {
+    return base::load(mo);
+  }
+
+  void store(const optional<T>& o, memory_order mo = memory_order_seq_cst) noexcept
+  {
+    base::store(o, mo);
+  }
+
+  optional<T> exchange(const optional<T>& o, memory_order mo = memory_order_seq_cst) noexcept
+  {
+    return base::exchange(o, mo);
+  }
+
+  bool compare_exchange_weak(optional<T>& expected, const optional<T>& desired,
+                             memory_order mo = memory_order_seq_cst) noexcept
+  {
+    return base::compare_exchange_weak(expected, desired, mo);
+  }
+
+  bool compare_exchange_strong(optional<T>& expected, const optional<T>& desired,
+                               memory_order mo = memory_order_seq_cst) noexcept
+  {
+    return base::compare_exchange_strong(expected, desired, mo);
+  }
+
+  void reset(memory_order mo = memory_order_seq_cst) noexcept
+  {
+    base::store(nullopt, mo);
+  }
+
+  // stores T(args...) only if disengaged; returns false if another value was already there
+  template <class... Args>
+  bool emplace_if_empty(Args&&... args) noexcept(noexcept(T(std::forward<Args>(args)...)))
+  {
+    optional<T> expected;
+    return base::compare_exchange_strong(expected, optional<T>(in_place, std::forward<Args>(args)...),
+                                         memory_order_acq_rel);
+  }
+};
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___ATOMIC_OPTIONAL_HPP___
@@ -0,0 +1,1035 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Micro-benchmarks of optional<T> against the representations it replaces: a nullable T*,
+// pair<bool, T> and, in C++17, std::optional<T>; then of the components built on optional
+// against their usual alternatives, and in C++20 of optional coroutines against early
+// returns. Results are written as JSON.
+//
+//   bench_optional [--filter SUBSTRING] [--repetitions N] [--min-ns N] [--max-threads N] [--quick]
+//                  [--table] [--output FILE]
+//
+// Each benchmark runs a batch of n operations, n doubled until a batch takes --min-ns; the
+// batch is then timed --repetitions times and the fastest and the median time per operation
+// are reported, in ticks of the cycle counter (rdtsc, cntvct_el0, or steady_clock elsewhere)
+// and in nanoseconds. allocations_per_op comes from test_alloc.hpp.
+//
+// optional_slot and promise/future are compared by the distribution of the latencies of single
+// handoffs (100000 of them, 1000 with --quick), as percentiles and a log2 histogram.
+//
+// The concurrent components are also run on 1, 2, 4, ... up to --max-threads threads (64 by
+// default): the time is then the wall time of the batch divided by the operations of all the
+// measured threads, so an operation that scales halves its time when the threads double (as
+// long as there are cores for them). The "threads" of each result is the number of measured
+// threads; a writer running beside them is not counted.
+
+# include "optional.hpp"
+# include "optional_lookup.hpp"
+# include "atomic_optional.hpp"
+# include "once_optional.hpp"
+# include "tls_optional.hpp"
+# include "seqlock_optional.hpp"
+# include "rcu_optional.hpp"
+# include "optional_queue.hpp"
+# include "optional_slot.hpp"
+# include "cow_optional.hpp"
+# include "poly_optional.hpp"
+# include "expected.hpp"
+# include "optional_with_reason.hpp"
+# include "optional_generator.hpp"
+# include "optional_coroutine.hpp"
+# include "test_alloc.hpp"
+# include <algorithm>
+# include <chrono>
+# include <cstdint>
+# include <cstdio>
+# include <cstring>
+# include <deque>
+# include <fstream>
+# include <functional>
+# include <future>
+# include <iomanip>
+# include <iostream>
+# include <memory>
+# include <mutex>
+# include <string>
+# include <thread>
+# include <unordered_map>
+# include <utility>
+# include <vector>
+
+# if __cplusplus >= 201703L && defined __has_include
+#   if __has_include(<optional>)
+#     include <optional>
+#     define BENCH_HAS_STD_OPTIONAL 1
+#   endif
+#   if __has_include(<shared_mutex>)
+#     include <shared_mutex>
+#     define BENCH_HAS_SHARED_MUTEX 1
+#   endif
+# endif
+
+# if defined __GNUC__
+#   define BENCH_NOINLINE __attribute__((noinline))
+# elif defined _MSC_VER
+#   define BENCH_NOINLINE __declspec(noinline)
+# else
+#   define BENCH_NOINLINE
+# endif
+
+namespace tr2 = std::experimental;
+
+
+// the harness
+
+namespace bench
+{
+
+# if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+const char* const timer_name = "rdtsc";
+inline std::uint64_t ticks()
+{
+  unsigned lo, hi;
+  asm volatile("lfence\n\trdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+  return (std::uint64_t(hi) << 32) | lo;
+}
+# elif defined __GNUC__ && defined __aarch64__
+const char* const timer_name = "cntvct_el0";
+inline std::uint64_t ticks()
+{
+  std::uint64_t v;
+  asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(v) : : "memory");
+  return v;
+}
+# else
+const char* const timer_name = "steady_clock";
+inline std::uint64_t ticks()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+# endif
+
+// ticks per nanosecond, measured against steady_clock over 20 ms
+inline double ticks_per_ns()
+{
+  typedef std::chrono::steady_clock clock;
+  clock::time_point t0 = clock::now();
+  std::uint64_t c0 = ticks();
+  while (clock::now() - t0 < std::chrono::milliseconds(20)) {}
+  std::uint64_t c1 = ticks();
+  double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count());
+  return double(c1 - c0) / ns;
+}
+
+// makes the compiler assume that x is read, so that computing it is not optimized away
+template <class T>
+inline void keep(const T& x)
+{
+# if defined __GNUC__
+  asm volatile("" : : "r,m"(x) : "memory");
+# else
+  static const void* volatile sink;
+  sink = &x;
+# endif
+}
+
+struct result
+{
+  std::string name, variant, payload;
+  double ticks_per_op, median_ticks_per_op, allocations_per_op;
+  size_t batch;
+  unsigned threads;
+};
+
+// the distribution of single-operation latencies, in ticks
+struct latency_result
+{
+  std::string name, variant, payload;
+  size_t samples;
+  double p50, p90, p99, p999, max;
+  std::vector<size_t> buckets;   // buckets[k]: latencies of [2^k, 2^(k+1)) ns, 0 and 1 ns in buckets[0]
+};
+
+class runner
+{
+  std::vector<result> results_;
+  std::vector<latency_result> latencies_;
+  std::string filter_;
+  int repetitions_;
+  double min_ticks_;
+  double ticks_per_ns_;
+
+  template <class F>
+  std::uint64_t time(F& f, size_t n)
+  {
+    std::uint64_t t0 = ticks();
+    f(n);
+    return ticks() - t0;
+  }
+
+  // starts threads threads, runs f(t, n, stop) on each at once and times the batch until the
+  // first measured threads return; the others run until stop is set
+  template <class F>
+  std::uint64_t time_threads(F& f, size_t n, unsigned threads, unsigned measured, long* allocs = nullptr)
+  {
+    std::atomic<bool> go(false), stop(false);
+    std::atomic<unsigned> finished(0);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t != threads; ++t)
+      pool.emplace_back([&, t] {
+        while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+        f(t, n, stop);
+        if (t < measured) finished.fetch_add(1, std::memory_order_release);
+      });
+    long allocs0 = allocations.load();
+    std::uint64_t t0 = ticks();
+    go.store(true, std::memory_order_release);
+    while (finished.load(std::memory_order_acquire) != measured) std::this_thread::yield();
+    std::uint64_t t1 = ticks();
+    if (allocs) *allocs = allocations.load() - allocs0;
+    stop.store(true, std::memory_order_release);
+    for (std::thread& th : pool) th.join();
+    return t1 - t0;
+  }
+
+public:
+  runner(std::string filter, int repetitions, double min_ns)
+  : filter_(std::move(filter)), repetitions_(repetitions), ticks_per_ns_(ticks_per_ns())
+  {
+    min_ticks_ = min_ns * ticks_per_ns_;
+  }
+
+  // f(n) performs n iterations of ops_per_iteration operations each
+  template <class F>
+  void run(const char* name, const char* variant, const char* payload, F f, int ops_per_iteration = 1)
+  {
+    std::string id = std::string(name) + '/' + variant + '/' + payload;
+    if (id.find(filter_) == std::string::npos) return;
+
+    size_t n = 1;
+    while (double(time(f, n)) < min_ticks_ && n < (size_t(1) << 30)) n *= 2;
+
+    std::vector<double> per_op;
+    for (int r = 0; r != repetitions_; ++r)
+      per_op.push_back(double(time(f, n)) / (double(n) * ops_per_iteration));
+    std::sort(per_op.begin(), per_op.end());
+
+    long allocs = count_allocations([&] { f(n); });
+    result res = { name, variant, payload, per_op.front(), per_op[per_op.size() / 2],
+                   double(allocs) / (double(n) * ops_per_iteration), n, 1 };
+    results_.push_back(res);
+  }
+
+  // f(t, n, stop) is run on threads t = 0 .. threads - 1 at once; the first measured threads
+  // each perform n operations, the others (writers beside readers) loop until stop is set
+  template <class F>
+  void run_threads(const char* name, const char* variant, const char* payload, unsigned threads, F f,
+                   unsigned extra = 0)
+  {
+    std::string id = std::string(name) + '/' + variant + '/' + payload + '/' + std::to_string(threads);
+    if (id.find(filter_) == std::string::npos) return;
+
+    size_t n = 1024;   // enough that waking the threads does not make the whole batch
+    while (double(time_threads(f, n, threads + extra, threads)) < min_ticks_ && n < (size_t(1) << 30)) n *= 2;
+
+    std::vector<double> per_op;
+    for (int r = 0; r != repetitions_; ++r)
+      per_op.push_back(double(time_threads(f, n, threads + extra, threads)) / (double(n) * threads));
+    std::sort(per_op.begin(), per_op.end());
+
+    long allocs = 0;
+    time_threads(f, n, threads + extra, threads, &allocs);
+    result res = { name, variant, payload, per_op.front(), per_op[per_op.size() / 2],
+                   double(allocs) / (double(n) * threads), n, threads };
+    results_.push_back(res);
+  }
+
+  // f(rounds, samples) appends the ticks taken by each of rounds operations to samples
+  template <class F>
+  void run_latency(const char* name, const char* variant, const char* payload, size_t rounds, F f)
+  {
+    std::string id = std::string(name) + '/' + variant + '/' + payload;
+    if (id.find(filter_) == std::string::npos) return;
+
+    std::vector<std::uint64_t> samples;
+    samples.reserve(rounds);
+    f(rounds, samples);
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) { return double(samples[std::min(samples.size() - 1, size_t(q * double(samples.size())))]); };
+
+    latency_result res = { name, variant, payload, samples.size(), at(0.5), at(0.9), at(0.99), at(0.999),
+                           double(samples.back()), std::vector<size_t>() };
+    for (std::uint64_t t : samples) {
+      size_t k = 0;
+      for (double ns = double(t) / ticks_per_ns_; ns >= 2; ns /= 2) ++k;
+      if (res.buckets.size() <= k) res.buckets.resize(k + 1);
+      ++res.buckets[k];
+    }
+    latencies_.push_back(res);
+  }
+
+  void write_json(std::ostream& os) const
+  {
+    os << "{\n  \"timer\": \"" << timer_name << "\",\n  \"ticks_per_ns\": " << ticks_per_ns_
+       << ",\n  \"cplusplus\": " << __cplusplus << ",\n  \"benchmarks\": [";
+    for (size_t i = 0; i != results_.size(); ++i) {
+      const result& r = results_[i];
+      os << (i ? ",\n" : "\n")
+         << "    {\"name\": " << quoted(r.name) << ", \"variant\": " << quoted(r.variant)
+         << ", \"payload\": " << quoted(r.payload)
+         << ", \"ns_per_op\": " << r.ticks_per_op / ticks_per_ns_
+         << ", \"median_ns_per_op\": " << r.median_ticks_per_op / ticks_per_ns_
+         << ", \"ticks_per_op\": " << r.ticks_per_op
+         << ", \"allocations_per_op\": " << r.allocations_per_op
+         << ", \"batch\": " << r.batch << ", \"threads\": " << r.threads << "}";
+    }
+    os << "\n  ],\n  \"latencies\": [";
+    for (size_t i = 0; i != latencies_.size(); ++i) {
+      const latency_result& l = latencies_[i];
+      os << (i ? ",\n" : "\n")
+         << "    {\"name\": " << quoted(l.name) << ", \"variant\": " << quoted(l.variant)
+         << ", \"payload\": " << quoted(l.payload) << ", \"samples\": " << l.samples
+         << ", \"p50_ns\": " << l.p50 / ticks_per_ns_ << ", \"p90_ns\": " << l.p90 / ticks_per_ns_
+         << ", \"p99_ns\": " << l.p99 / ticks_per_ns_ << ", \"p999_ns\": " << l.p999 / ticks_per_ns_
+         << ", \"max_ns\": " << l.max / ticks_per_ns_ << ", \"log2_ns_histogram\": [";
+      for (size_t k = 0; k != l.buckets.size(); ++k) os << (k ? ", " : "") << l.buckets[k];
+      os << "]}";
+    }
+    os << "\n  ]\n}\n";
+  }
+
+  void write_table(std::ostream& os) const
+  {
+    os << std::left << std::setw(26) << "name" << std::setw(30) << "variant" << std::setw(10) << "payload"
+       << std::right << std::setw(8) << "threads" << std::setw(10) << "ns/op" << std::setw(10) << "median"
+       << std::setw(8) << "allocs" << '\n';
+    for (const result& r : results_)
+      os << std::left << std::setw(26) << r.name << std::setw(30) << r.variant << std::setw(10) << r.payload
+         << std::right << std::setw(8) << r.threads << std::fixed << std::setprecision(2)
+         << std::setw(10) << r.ticks_per_op / ticks_per_ns_ << std::setw(10) << r.median_ticks_per_op / ticks_per_ns_
+         << std::setw(8) << r.allocations_per_op << '\n';
+    if (latencies_.empty()) return;
+    os << '\n' << std::left << std::setw(26) << "latency" << std::setw(30) << "variant" << std::setw(10) << "payload"
+       << std::right << std::setw(10) << "p50 ns" << std::setw(10) << "p90" << std::setw(10) << "p99"
+       << std::setw(10) << "p99.9" << std::setw(12) << "max" << '\n';
+    for (const latency_result& l : latencies_)
+      os << std::left << std::setw(26) << l.name << std::setw(30) << l.variant << std::setw(10) << l.payload
+         << std::right << std::fixed << std::setprecision(0)
+         << std::setw(10) << l.p50 / ticks_per_ns_ << std::setw(10) << l.p90 / ticks_per_ns_
+         << std::setw(10) << l.p99 / ticks_per_ns_ << std::setw(10) << l.p999 / ticks_per_ns_
+         << std::setw(12) << l.max / ticks_per_ns_ << '\n';
+  }
+
+  static std::string quoted(const std::string& s)
+  {
+    std::string q = "\"";
+    for (char c : s) {
+      if (c == '"' || c == '\\') q += '\\';
+      q += c;
+    }
+    return q + '"';
+  }
+};
+
+} // namespace bench
+
+
+// payloads
+
+struct Large
+{
+  std::uint64_t w[32];
+  explicit Large(std::uint64_t i = 0) { for (std::uint64_t& x : w) x = i++; }
+};
+
+bool operator==(const Large& x, const Large& y) { return std::memcmp(x.w, y.w, sizeof x.w) == 0; }
+bool operator<(const Large& x, const Large& y) { return std::memcmp(x.w, y.w, sizeof x.w) < 0; }
+
+namespace std
+{
+  template <> struct hash<Large>
+  {
+    typedef Large argument_type;
+    typedef size_t result_type;
+    size_t operator()(const Large& x) const noexcept { return hash<std::uint64_t>()(x.w[0] ^ x.w[31]); }
+  };
+}
+
+
+// the representations of "maybe a T" compared by the core benchmarks
+
+template <class O, class T>
+struct optional_rep
+{
+  typedef O type;
+  static type make(const T& v) { return type(v); }
+  static type none() { return type(); }
+  static void emplace(type& o, const T& v) { o.emplace(v); }
+  static void reset(type& o) { o.reset(); }
+  static T value_or(const type& o, const T& d) { return o.value_or(d); }
+  static bool equal(const type& x, const type& y) { return x == y; }
+  static bool less(const type& x, const type& y) { return x < y; }
+  static void swap(type& x, type& y) { x.swap(y); }
+  static size_t hash(const type& o) { return std::hash<type>()(o); }
+};
+
+// the flag next to a live T: reset only clears the flag and emplace assigns
+template <class T>
+struct pair_rep
+{
+  typedef std::pair<bool, T> type;
+  static type make(const T& v) { return type(true, v); }
+  static type none() { return type(false, T()); }
+  static void emplace(type& o, const T& v) { o.second = v; o.first = true; }
+  static void reset(type& o) { o.first = false; }
+  static T value_or(const type& o, const T& d) { return o.first ? o.second : d; }
+  static bool equal(const type& x, const type& y) { return x.first == y.first && (!x.first || x.second == y.second); }
+  static bool less(const type& x, const type& y) { return y.first && (!x.first || x.second < y.second); }
+  static void swap(type& x, type& y) { std::swap(x, y); }
+  static size_t hash(const type& o) { return o.first ? std::hash<T>()(o.second) : 0; }
+};
+
+// a pointer to a T owned elsewhere: no payload is ever copied
+template <class T>
+struct pointer_rep
+{
+  typedef const T* type;
+  static type make(const T& v) { return &v; }
+  static type none() { return nullptr; }
+  static void emplace(type& o, const T& v) { o = &v; }
+  static void reset(type& o) { o = nullptr; }
+  static T value_or(const type& o, const T& d) { return o ? *o : d; }
+  static bool equal(const type& x, const type& y) { return x && y ? *x == *y : x == y; }
+  static bool less(const type& x, const type& y) { return y && (!x || *x < *y); }
+  static void swap(type& x, type& y) { std::swap(x, y); }
+  static size_t hash(const type& o) { return o ? std::hash<T>()(*o) : 0; }
+};
+
+
+// the core operations over one representation and one payload
+
+template <class Rep, class T>
+void core_suite(bench::runner& r, const char* variant, const char* payload, const T& v, const T& w)
+{
+  typedef typename Rep::type type;
+  const size_t mask = 63;
+
+  // 64 objects, every third one empty, the rest holding v or w
+  std::vector<type> objs;
+  for (size_t i = 0; i != mask + 1; ++i)
+    objs.push_back(i % 3 == 0 ? Rep::none() : Rep::make(i % 2 ? v : w));
+
+  r.run("construct_empty", variant, payload, [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { type o = Rep::none(); bench::keep(o); }
+  });
+
+  r.run("construct", variant, payload, [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { type o = Rep::make(v); bench::keep(o); }
+  });
+
+  r.run("copy", variant, payload, [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { type o(objs[i & mask]); bench::keep(o); }
+  });
+
+  r.run("move", variant, payload, [&](size_t n) {
+    type a = Rep::make(v);
+    for (size_t i = 0; i != n; ++i) {
+      type b(std::move(a));   // move construction
+      a = std::move(b);       // move assignment
+      bench::keep(a);
+    }
+  }, 2);
+
+  r.run("emplace", variant, payload, [&](size_t n) {
+    type o = Rep::make(v);
+    for (size_t i = 0; i != n; ++i) { Rep::emplace(o, i & 1 ? v : w); bench::keep(o); }
+  });
+
+  r.run("emplace_reset", variant, payload, [&](size_t n) {
+    type o = Rep::none();
+    for (size_t i = 0; i != n; ++i) { Rep::emplace(o, v); bench::keep(o); Rep::reset(o); bench::keep(o); }
+  });
+
+  r.run("value_or", variant, payload, [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(Rep::value_or(objs[i & mask], v));
+  });
+
+  r.run("compare", variant, payload, [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) {
+      bench::keep(Rep::equal(objs[i & mask], objs[(i + 1) & mask]));
+      bench::keep(Rep::less(objs[i & mask], objs[(i + 5) & mask]));
+    }
+  }, 2);
+
+  r.run("swap", variant, payload, [&](size_t n) {
+    type a = Rep::make(v), b = Rep::make(w);
+    for (size_t i = 0; i != n; ++i) { Rep::swap(a, b); bench::keep(a); }
+  });
+
+  r.run("hash", variant, payload, [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(Rep::hash(objs[i & mask]));
+  });
+}
+
+template <class T>
+void core_suites(bench::runner& r, const char* payload, const T& v, const T& w)
+{
+  core_suite<optional_rep<tr2::optional<T>, T>>(r, "optional", payload, v, w);
+# if BENCH_HAS_STD_OPTIONAL
+  core_suite<optional_rep<std::optional<T>, T>>(r, "std::optional", payload, v, w);
+# endif
+  core_suite<pair_rep<T>>(r, "pair<bool,T>", payload, v, w);
+  core_suite<pointer_rep<T>>(r, "T*", payload, v, w);
+}
+
+
+// value() in a hot loop under each checked access policy
+
+template <class Policy> struct Checked { int i; };
+
+namespace std { namespace experimental {
+  template <class Policy> struct optional_check_policy<Checked<Policy>> { typedef Policy type; };
+}}
+
+template <class Policy>
+BENCH_NOINLINE int sum_values(const tr2::optional<Checked<Policy>>* a, size_t n)
+{
+  int s = 0;
+  for (size_t i = 0; i != n; ++i) s += a[i].value().i;
+  return s;
+}
+
+template <class Policy>
+void policy_bench(bench::runner& r, const char* variant)
+{
+  std::vector<tr2::optional<Checked<Policy>>> a;
+  for (int i = 0; i != 1024; ++i) a.push_back(Checked<Policy>{i});
+  r.run("value_loop", variant, "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(sum_values(a.data(), a.size()));
+  }, int(a.size()));
+}
+
+void policy_benches(bench::runner& r)
+{
+  policy_bench<tr2::optional_check_throw>(r, "check_throw");
+  policy_bench<tr2::optional_check_terminate>(r, "check_terminate");
+  policy_bench<tr2::optional_check_trap>(r, "check_trap");
+  policy_bench<tr2::optional_check_assert>(r, "check_assert");
+  policy_bench<tr2::optional_check_unchecked>(r, "check_unchecked");
+}
+
+
+// the components built on optional, against what they replace
+
+void lookup_benches(bench::runner& r)
+{
+  std::unordered_map<int, int> m;
+  for (int i = 0; i != 1024; ++i) m[i * 2] = i;       // even keys hit, odd keys miss
+
+  r.run("map_lookup", "find", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) {
+      auto it = m.find(int(i & 2047));
+      bench::keep(it != m.end() ? it->second : -1);
+    }
+  });
+  r.run("map_lookup", "lookup", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(tr2::lookup(m, int(i & 2047)).value_or(-1));
+  });
+
+  std::unordered_map<int, int> e;
+  r.run("map_lookup_or_emplace", "find_then_emplace", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) {
+      int k = int(i & 4095);
+      auto it = e.find(k);
+      if (it == e.end()) it = e.emplace(k, 0).first;
+      bench::keep(++it->second);
+    }
+  });
+  e.clear();
+  r.run("map_lookup_or_emplace", "lookup_or_emplace", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(++tr2::lookup_or_emplace(e, int(i & 4095), 0));
+  });
+}
+
+// the atomic_optional rows name the implementation this build selected for the payload
+struct Ticket { unsigned long long id; };   // 8 bytes, and id ~0 is never issued
+
+namespace std { namespace experimental {
+  template <> struct atomic_optional_niche<Ticket> : true_type { static Ticket niche() noexcept { return Ticket{~0ull}; } };
+}}
+
+template <class T>
+const char* atomic_variant()
+{
+  switch (tr2::atomic_optional<T>::implementation) {
+    case tr2::atomic_optional_implementation::packed_word: return "atomic_optional(packed_word)";
+    case tr2::atomic_optional_implementation::niche_word:  return "atomic_optional(niche_word)";
+    case tr2::atomic_optional_implementation::double_word: return "atomic_optional(double_word)";
+    case tr2::atomic_optional_implementation::spinlock:    return "atomic_optional(spinlock)";
+  }
+  return "atomic_optional";
+}
+
+template <class T, class Make>
+void atomic_load_store_bench(bench::runner& r, const char* payload, Make make)
+{
+  tr2::atomic_optional<T> a(make(1));
+  r.run("shared_load", atomic_variant<T>(), payload, [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(a.load(std::memory_order_acquire));
+  });
+  r.run("shared_store", atomic_variant<T>(), payload, [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) a.store(tr2::optional<T>(make(i)), std::memory_order_release);
+  });
+}
+
+void shared_value_benches(bench::runner& r)
+{
+  struct Quad { int a, b, c, d; };
+  std::mutex mtx;
+  tr2::optional<int> guarded_int(1);
+  tr2::optional<Quad> guarded_quad(Quad{1, 2, 3, 4});
+
+  atomic_load_store_bench<int>(r, "int", [](size_t i) { return int(i); });
+  atomic_load_store_bench<long long>(r, "int64", [](size_t i) { return (long long)i; });
+  atomic_load_store_bench<Ticket>(r, "Ticket", [](size_t i) { return Ticket{i}; });
+  r.run("shared_load", "mutex+optional", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { std::lock_guard<std::mutex> g(mtx); bench::keep(guarded_int); }
+  });
+  r.run("shared_store", "mutex+optional", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { std::lock_guard<std::mutex> g(mtx); guarded_int = int(i); }
+  });
+
+  tr2::seqlock_optional<Quad> sq(Quad{1, 2, 3, 4});
+  r.run("shared_load", "seqlock_optional", "int[4]", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(sq.load());
+  });
+  r.run("shared_load", "mutex+optional", "int[4]", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { std::lock_guard<std::mutex> g(mtx); tr2::optional<Quad> c(guarded_quad); bench::keep(c); }
+  });
+
+  tr2::rcu_optional<std::string> rs(tr2::in_place, std::string(40, 'r'));
+  std::string guarded_string(40, 'r');
+  r.run("shared_read", "rcu_optional", "string40", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { tr2::rcu_snapshot<std::string> s = rs.read(); bench::keep(s->size()); }
+  });
+  r.run("shared_read", "mutex+string", "string40", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { std::lock_guard<std::mutex> g(mtx); bench::keep(guarded_string.size()); }
+  });
+}
+
+int make_answer() { return 42; }
+
+// the guarded function-local static that once_optional replaces where the value is global
+inline int& static_answer()
+{
+  static int v = make_answer();
+  return v;
+}
+
+void lazy_benches(bench::runner& r)
+{
+  tr2::once_optional<int> once;
+  r.run("lazy_get", "once_optional", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(once.get_or_init(make_answer));
+  });
+  std::once_flag flag;
+  int value = 0;
+  r.run("lazy_get", "call_once", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { std::call_once(flag, [&] { value = make_answer(); }); bench::keep(value); }
+  });
+  r.run("lazy_get", "function-local static", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(static_answer());
+  });
+
+  tr2::tls_optional<int> tls;
+  r.run("thread_local_get", "tls_optional", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(tls.get_or_emplace(1));
+  });
+  r.run("thread_local_get", "thread_local optional", "int", [&](size_t n) {
+    static thread_local tr2::optional<int> local;
+    for (size_t i = 0; i != n; ++i) { if (!local) local.emplace(1); bench::keep(*local); }
+  });
+}
+
+void queue_benches(bench::runner& r)
+{
+  tr2::optional_queue<int> q(1024);
+  r.run("queue_push_pop", "optional_queue", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { q.try_push(int(i)); bench::keep(q.try_pop()); }
+  });
+  std::mutex mtx;
+  std::deque<int> d;
+  r.run("queue_push_pop", "mutex+deque", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) {
+      { std::lock_guard<std::mutex> g(mtx); d.push_back(int(i)); }
+      std::lock_guard<std::mutex> g(mtx);
+      int v = d.front();
+      d.pop_front();
+      bench::keep(v);
+    }
+  });
+}
+
+// one value handed from a producer thread to a consumer that is already waiting for it: the
+// value is the time it was sent, and the consumer records how long it took to arrive
+void handoff_latency_benches(bench::runner& r, size_t rounds)
+{
+  r.run_latency("handoff_latency", "optional_slot", "uint64", rounds, [](size_t rounds, std::vector<std::uint64_t>& out) {
+    tr2::optional_slot<std::uint64_t> slot;
+    std::atomic<size_t> waiting(0);
+    std::thread producer([&] {
+      for (size_t i = 1; i <= rounds; ++i) {
+        while (waiting.load(std::memory_order_acquire) != i) std::this_thread::yield();
+        slot.emplace(bench::ticks());
+      }
+    });
+    for (size_t i = 1; i <= rounds; ++i) {
+      waiting.store(i, std::memory_order_release);
+      std::uint64_t sent = *slot.wait();
+      out.push_back(bench::ticks() - sent);
+    }
+    producer.join();
+  });
+
+  // a promise serves one value, so the producer makes a pair per round and hands over the future first
+  r.run_latency("handoff_latency", "promise+future", "uint64", rounds, [](size_t rounds, std::vector<std::uint64_t>& out) {
+    std::atomic<std::future<std::uint64_t>*> next(nullptr);
+    std::atomic<size_t> waiting(0);
+    std::thread producer([&] {
+      for (size_t i = 1; i <= rounds; ++i) {
+        std::promise<std::uint64_t> p;
+        std::future<std::uint64_t> f = p.get_future();
+        next.store(&f, std::memory_order_release);
+        while (waiting.load(std::memory_order_acquire) != i) std::this_thread::yield();
+        p.set_value(bench::ticks());
+      }
+    });
+    for (size_t i = 1; i <= rounds; ++i) {
+      std::future<std::uint64_t>* pf;
+      while (!(pf = next.exchange(nullptr, std::memory_order_acq_rel))) std::this_thread::yield();
+      std::future<std::uint64_t> f = std::move(*pf);
+      waiting.store(i, std::memory_order_release);
+      std::uint64_t sent = f.get();
+      out.push_back(bench::ticks() - sent);
+    }
+    producer.join();
+  });
+}
+
+// the concurrent components on 1, 2, 4, ... max_threads threads
+
+# if defined BENCH_HAS_SHARED_MUTEX
+typedef std::shared_mutex read_write_mutex;
+#   define BENCH_READ_WRITE_MUTEX "shared_mutex"
+template <class M> using read_lock = std::shared_lock<M>;
+# else
+typedef std::mutex read_write_mutex;   // before C++17 readers take the mutex alone
+#   define BENCH_READ_WRITE_MUTEX "mutex"
+template <class M> using read_lock = std::lock_guard<M>;
+# endif
+
+void scaling_benches(bench::runner& r, unsigned max_threads)
+{
+  struct Quad { int a, b, c, d; };
+
+  for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+    // every thread reads, or every thread increments the same value
+    tr2::atomic_optional<int> ai(0);
+    tr2::atomic_optional<long long> al(0);
+    std::mutex mtx;
+    tr2::optional<int> guarded_int(0);
+    r.run_threads("threads_load", atomic_variant<int>(), "int", threads, [&](unsigned, size_t n, const std::atomic<bool>&) {
+      for (size_t i = 0; i != n; ++i) bench::keep(ai.load(std::memory_order_acquire));
+    });
+    r.run_threads("threads_load", atomic_variant<long long>(), "int64", threads, [&](unsigned, size_t n, const std::atomic<bool>&) {
+      for (size_t i = 0; i != n; ++i) bench::keep(al.load(std::memory_order_acquire));
+    });
+    r.run_threads("threads_load", "mutex+optional", "int", threads, [&](unsigned, size_t n, const std::atomic<bool>&) {
+      for (size_t i = 0; i != n; ++i) { std::lock_guard<std::mutex> g(mtx); bench::keep(guarded_int); }
+    });
+    r.run_threads("threads_increment", atomic_variant<int>(), "int", threads, [&](unsigned, size_t n, const std::atomic<bool>&) {
+      for (size_t i = 0; i != n; ++i) {
+        tr2::optional<int> e = ai.load(std::memory_order_relaxed);
+        while (!ai.compare_exchange_weak(e, tr2::optional<int>(e ? *e + 1 : 0), std::memory_order_acq_rel)) {}
+      }
+    });
+    r.run_threads("threads_increment", atomic_variant<long long>(), "int64", threads, [&](unsigned, size_t n, const std::atomic<bool>&) {
+      for (size_t i = 0; i != n; ++i) {
+        tr2::optional<long long> e = al.load(std::memory_order_relaxed);
+        while (!al.compare_exchange_weak(e, tr2::optional<long long>(e ? *e + 1 : 0), std::memory_order_acq_rel)) {}
+      }
+    });
+    r.run_threads("threads_increment", "mutex+optional", "int", threads, [&](unsigned, size_t n, const std::atomic<bool>&) {
+      for (size_t i = 0; i != n; ++i) { std::lock_guard<std::mutex> g(mtx); guarded_int = *guarded_int + 1; }
+    });
+
+    // readers beside one writer that stores a new value whenever it is scheduled
+    tr2::seqlock_optional<Quad> sq(Quad{1, 2, 3, 4});
+    read_write_mutex rw;
+    tr2::optional<Quad> guarded_quad(Quad{1, 2, 3, 4});
+    r.run_threads("readers_one_writer", "seqlock_optional", "int[4]", threads, [&](unsigned t, size_t n, const std::atomic<bool>& stop) {
+      if (t == threads) {
+        for (int i = 0; !stop.load(std::memory_order_relaxed); ++i) { sq.emplace(Quad{i, i, i, i}); std::this_thread::yield(); }
+        return;
+      }
+      for (size_t i = 0; i != n; ++i) bench::keep(sq.load());
+    }, 1);
+    r.run_threads("readers_one_writer", BENCH_READ_WRITE_MUTEX "+optional", "int[4]", threads, [&](unsigned t, size_t n, const std::atomic<bool>& stop) {
+      if (t == threads) {
+        for (int i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+          { std::lock_guard<read_write_mutex> g(rw); guarded_quad = Quad{i, i, i, i}; }
+          std::this_thread::yield();
+        }
+        return;
+      }
+      for (size_t i = 0; i != n; ++i) { read_lock<read_write_mutex> g(rw); tr2::optional<Quad> c(guarded_quad); bench::keep(c); }
+    }, 1);
+
+    // the same with a payload that is not trivially copyable
+    tr2::rcu_optional<std::string> rs(tr2::in_place, std::string(40, 'r'));
+    std::string guarded_string(40, 'r');
+    r.run_threads("readers_one_writer", "rcu_optional", "string40", threads, [&](unsigned t, size_t n, const std::atomic<bool>& stop) {
+      if (t == threads) {
+        while (!stop.load(std::memory_order_relaxed)) { rs.emplace(40, 'w'); std::this_thread::yield(); }
+        return;
+      }
+      for (size_t i = 0; i != n; ++i) { tr2::rcu_snapshot<std::string> s = rs.read(); bench::keep(s->size()); }
+    }, 1);
+    r.run_threads("readers_one_writer", BENCH_READ_WRITE_MUTEX "+string", "string40", threads, [&](unsigned t, size_t n, const std::atomic<bool>& stop) {
+      if (t == threads) {
+        while (!stop.load(std::memory_order_relaxed)) {
+          { std::lock_guard<read_write_mutex> g(rw); guarded_string.assign(40, 'w'); }
+          std::this_thread::yield();
+        }
+        return;
+      }
+      for (size_t i = 0; i != n; ++i) { read_lock<read_write_mutex> g(rw); bench::keep(guarded_string.size()); }
+    }, 1);
+  }
+
+  // threads / 2 producers and as many consumers, each pushing or popping n elements
+  for (unsigned threads = 2; threads <= max_threads; threads *= 2) {
+    tr2::optional_queue<int> q(1024);
+    r.run_threads("producers_consumers", "optional_queue", "int", threads, [&](unsigned t, size_t n, const std::atomic<bool>&) {
+      if (t % 2 == 0) { for (size_t i = 0; i != n; ++i) while (!q.try_push(int(i))) std::this_thread::yield(); }
+      else            { for (size_t i = 0; i != n; ++i) { tr2::optional<int> v; while (!(v = q.try_pop())) std::this_thread::yield(); bench::keep(v); } }
+    });
+    std::mutex mtx;
+    std::deque<int> d;
+    r.run_threads("producers_consumers", "mutex+deque", "int", threads, [&](unsigned t, size_t n, const std::atomic<bool>&) {
+      if (t % 2 == 0) { for (size_t i = 0; i != n; ++i) { std::lock_guard<std::mutex> g(mtx); d.push_back(int(i)); } return; }
+      for (size_t i = 0; i != n; ) {
+        {
+          std::lock_guard<std::mutex> g(mtx);
+          if (!d.empty()) { bench::keep(d.front()); d.pop_front(); ++i; continue; }
+        }
+        std::this_thread::yield();
+      }
+    });
+  }
+}
+
+struct Shape { virtual ~Shape() {} virtual int area() const = 0; };
+struct Square : Shape { int s; explicit Square(int s) : s(s) {} int area() const override { return s * s; } };
+
+void ownership_benches(bench::runner& r)
+{
+  const std::string s(40, 'c');
+  tr2::cow_optional<std::string> cow(s);
+  tr2::optional<std::string> opt(s);
+  std::shared_ptr<const std::string> sp = std::make_shared<const std::string>(s);
+  r.run("copy_shared", "cow_optional", "string40", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { tr2::cow_optional<std::string> c(cow); bench::keep(c); }
+  });
+  r.run("copy_shared", "optional", "string40", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { tr2::optional<std::string> c(opt); bench::keep(c); }
+  });
+  r.run("copy_shared", "shared_ptr<const T>", "string40", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) { std::shared_ptr<const std::string> c(sp); bench::keep(c); }
+  });
+
+  r.run("polymorphic_emplace_call", "poly_optional", "Square", [&](size_t n) {
+    tr2::poly_optional<Shape> p;
+    for (size_t i = 0; i != n; ++i) { p.emplace<Square>(int(i)); bench::keep(p->area()); p.reset(); }
+  });
+  r.run("polymorphic_emplace_call", "unique_ptr", "Square", [&](size_t n) {
+    std::unique_ptr<Shape> p;
+    for (size_t i = 0; i != n; ++i) { p.reset(new Square(int(i))); bench::keep(p->area()); p.reset(); }
+  });
+}
+
+enum class why { none, not_found, invalid };
+
+// parse i, failing when (i & fail_mask) == 0: in one call of fail_mask + 1
+BENCH_NOINLINE tr2::expected<int, int> parse_expected(size_t i, size_t fail_mask)
+{
+  if ((i & fail_mask) == 0) return tr2::make_unexpected(int(i));
+  return int(i);
+}
+
+BENCH_NOINLINE int parse_throwing(size_t i, size_t fail_mask)
+{
+  if ((i & fail_mask) == 0) throw int(i);
+  return int(i);
+}
+
+BENCH_NOINLINE tr2::optional_with_reason<int, why> parse_with_reason(size_t i, size_t fail_mask)
+{
+  if ((i & fail_mask) == 0) return why::invalid;
+  return int(i);
+}
+
+BENCH_NOINLINE tr2::optional<int> parse_optional(size_t i, size_t fail_mask)
+{
+  if ((i & fail_mask) == 0) return tr2::nullopt;
+  return int(i);
+}
+
+void error_benches(bench::runner& r)
+{
+  // the error rate decides between exceptions and error values, so it is swept: from no
+  // failures (only i == 0 fails) to every call failing
+  struct rate { const char* name; size_t fail_mask; };
+  static const rate rates[] = {
+    { "error_propagation_0", ~size_t(0) }, { "error_propagation_1/1024", 1023 },
+    { "error_propagation_1/64", 63 }, { "error_propagation_1/8", 7 },
+    { "error_propagation_1/2", 1 }, { "error_propagation_1", 0 },
+  };
+  for (const rate& rt : rates) {
+    const size_t m = rt.fail_mask;
+    r.run(rt.name, "expected", "int", [&](size_t n) {
+      for (size_t i = 0; i != n; ++i) {
+        tr2::expected<int, int> e = parse_expected(i, m);
+        bench::keep(e.has_value() ? *e : -e.error());
+      }
+    });
+    r.run(rt.name, "exceptions", "int", [&](size_t n) {
+      for (size_t i = 0; i != n; ++i) {
+        try { bench::keep(parse_throwing(i, m)); }
+        catch (int e) { bench::keep(-e); }
+      }
+    });
+    r.run(rt.name, "optional_with_reason", "int", [&](size_t n) {
+      for (size_t i = 0; i != n; ++i) {
+        tr2::optional_with_reason<int, why> o = parse_with_reason(i, m);
+        bench::keep(o ? *o : -int(o.reason()));
+      }
+    });
+    r.run(rt.name, "optional", "int", [&](size_t n) {
+      for (size_t i = 0; i != n; ++i) bench::keep(parse_optional(i, m).value_or(-1));
+    });
+  }
+}
+
+void generator_benches(bench::runner& r)
+{
+  r.run("generate", "step_generator", "int", [&](size_t n) {
+    size_t k = 0;
+    auto g = tr2::make_step_generator<int>([&](tr2::optional<int>& out) {
+      if (k == n) return false;
+      out = int(k++);
+      return true;
+    });
+    tr2::optional<int> v;
+    while (g.next(v)) bench::keep(*v);
+  });
+  r.run("generate", "callback", "int", [&](size_t n) {
+    std::function<void(int)> sink = [](int v) { bench::keep(v); };
+    for (size_t k = 0; k != n; ++k) sink(int(k));
+  });
+}
+
+# if OPTIONAL_HAS_COROUTINES
+BENCH_NOINLINE tr2::optional<int> bench_digit(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  return tr2::nullopt;
+}
+
+BENCH_NOINLINE tr2::optional<int> number2_early_return(const char* s)
+{
+  tr2::optional<int> a = bench_digit(s[0]);
+  if (!a) return tr2::nullopt;
+  tr2::optional<int> b = bench_digit(s[1]);
+  if (!b) return tr2::nullopt;
+  return *a * 10 + *b;
+}
+
+BENCH_NOINLINE tr2::optional<int> number2_coroutine(const char* s)
+{
+  int a = co_await bench_digit(s[0]);
+  int b = co_await bench_digit(s[1]);
+  co_return a * 10 + b;
+}
+# endif
+
+void coroutine_benches(bench::runner& r)
+{
+# if OPTIONAL_HAS_COROUTINES
+  // one input in four fails, at the first or at the second digit
+  static const char* const inputs[] = { "42", "x7", "13", "08", "99", "5x", "71", "26" };
+  r.run("propagate_nullopt", "co_await", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(number2_coroutine(inputs[i & 7]));
+  });
+  r.run("propagate_nullopt", "early_return", "int", [&](size_t n) {
+    for (size_t i = 0; i != n; ++i) bench::keep(number2_early_return(inputs[i & 7]));
+  });
+# else
+  (void)r;
+# endif
+}
+
+
+int main(int argc, char** argv)
+{
+  std::string filter;
+  int repetitions = 5;
+  double min_ns = 2e6;
+  unsigned max_threads = 64;
+  bool quick = false;
+  bool table = false;
+  std::string output;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--filter" && i + 1 < argc) filter = argv[++i];
+    else if (a == "--repetitions" && i + 1 < argc) repetitions = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--min-ns" && i + 1 < argc) min_ns = std::atof(argv[++i]);
+    else if (a == "--max-threads" && i + 1 < argc) max_threads = unsigned(std::max(1, std::atoi(argv[++i])));
+    else if (a == "--quick") { repetitions = 1; min_ns = 2e4; max_threads = std::min(max_threads, 4u); quick = true; }
+    else if (a == "--table") table = true;
+    else if (a == "--output" && i + 1 < argc) output = argv[++i];
+    else {
+      std::fprintf(stderr, "usage: %s [--filter SUBSTRING] [--repetitions N] [--min-ns N] [--max-threads N] [--quick] [--table] [--output FILE]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  bench::runner r(filter, repetitions, min_ns);
+
+  core_suites(r, "int", 1, 2);
+  core_suites(r, "Large", Large(1), Large(2));
+  core_suites(r, "string40", std::string(40, 'v'), std::string(40, 'w')); // beyond the small string buffer
+
+  policy_benches(r);
+  lookup_benches(r);
+  shared_value_benches(r);
+  lazy_benches(r);
+  queue_benches(r);
+  scaling_benches(r, max_threads);
+  handoff_latency_benches(r, quick ? 1000 : 100000);
+  ownership_benches(r);
+  error_benches(r);
+  generator_benches(r);
+  coroutine_benches(r);
+
+  std::ofstream file;
+  if (!output.empty()) file.open(output.c_str());
+  std::ostream& os = output.empty() ? std::cout : file;
+  if (table) r.write_table(os);
+  else r.write_json(os);
+  return os ? 0 : 1;
+}
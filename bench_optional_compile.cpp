@@ -0,0 +1,323 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Measures what optional costs the compiler. For each header and each count of payload types
+// the program writes translation units that
+//
+//   empty        include nothing (the compiler's own start-up)
+//   include      only include the header
+//   instantiate  instantiate optional<T> for N distinct types: construction, assignment,
+//                emplace, reset, swap, the observers and value_or
+//   operators    additionally use every relational operator (optional with optional, with
+//                nullopt and with T) and std::hash for each of the N types
+//
+// in each configuration of the headers, the portable baseline first, and compiles each one
+// --repetitions times with the compiler of the build, keeping the fastest. It reports the wall
+// time and the peak memory of the compiler and, from GCC's -ftime-report or Clang's
+// -ftime-trace, the time of each compiler phase. Results are written as JSON.
+//
+//   bench_optional_compile [--types N,N...] [--header H]... [--repetitions N] [--quick]
+//                          [--dir DIR] [--output FILE]
+
+# include <algorithm>
+# include <cerrno>
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <fstream>
+# include <iostream>
+# include <sstream>
+# include <string>
+# include <utility>
+# include <vector>
+# include <fcntl.h>
+# include <sys/resource.h>
+# include <sys/stat.h>
+# include <sys/wait.h>
+# include <unistd.h>
+
+// set by the build
+# if !defined OPTIONAL_CXX
+#   define OPTIONAL_CXX "c++"
+# endif
+# if !defined OPTIONAL_CXX_FLAGS
+#   define OPTIONAL_CXX_FLAGS "-std=c++11"
+# endif
+# if !defined OPTIONAL_SOURCE_DIR
+#   define OPTIONAL_SOURCE_DIR "."
+# endif
+
+
+// the generated translation units
+
+std::string payload(int i)
+{
+  std::ostringstream os;
+  os << "struct P" << i << " { int v; };\n";
+  for (const char* op : { "==", "!=", "<", "<=", ">", ">=" })
+    os << "inline bool operator" << op << "(P" << i << " a, P" << i << " b) { return a.v " << op << " b.v; }\n";
+  return os.str();
+}
+
+std::string instantiate(int i)
+{
+  std::ostringstream os;
+  os << "int instantiate" << i << "(P" << i << " v)\n{\n"
+     << "  tr2::optional<P" << i << "> a, b(v), c(tr2::in_place, v), d(tr2::nullopt);\n"
+     << "  a = b; c = std::move(b); d = v; a.emplace(v); b.reset(); a.swap(c); d = tr2::nullopt;\n"
+     << "  tr2::optional<P" << i << "> e = tr2::make_optional(v);\n"
+     << "  return bool(a) + a.has_value() + (*c).v + c->v + e.value().v + d.value_or(v).v;\n}\n";
+  return os.str();
+}
+
+std::string operators(int i)
+{
+  std::ostringstream os;
+  os << "namespace std { template <> struct hash<P" << i << "> {\n"
+     << "  typedef P" << i << " argument_type; typedef size_t result_type;\n"
+     << "  size_t operator()(P" << i << " p) const { return size_t(p.v); } }; }\n"
+     << "int compare" << i << "(const tr2::optional<P" << i << ">& a, const tr2::optional<P" << i << ">& b, P" << i << " v)\n{\n  return 0";
+  for (const char* op : { "==", "!=", "<", "<=", ">", ">=" })
+    os << "\n    + (a " << op << " b) + (a " << op << " tr2::nullopt) + (tr2::nullopt " << op << " a)"
+       << " + (a " << op << " v) + (v " << op << " a)";
+  os << "\n    + int(std::hash<tr2::optional<P" << i << ">>()(a));\n}\n";
+  return os.str();
+}
+
+// the configurations of the headers: the portable one, the baseline, includes <memory> and
+// <functional>; the other opts in to libstdc++'s smaller internal headers (the same as the
+// portable one with other libraries)
+const char* const configs[] = { "portable", "libstdcxx_internal_headers" };
+
+std::string translation_unit(const std::string& kind, const std::string& config, const std::string& header, int types)
+{
+  std::ostringstream os;
+  if (kind == "empty") return "int main() { }\n";
+  if (config == "libstdcxx_internal_headers") os << "# define OPTIONAL_LIBSTDCXX_INTERNAL_HEADERS\n";
+  os << "# include \"" << header << "\"\n";
+  if (kind != "include") {
+    // what the code below needs beyond optional_core.hpp, so that the parts can be measured
+    // on their own; these are no-ops after optional.hpp
+    os << "# include \"optional_bad_access.hpp\"\n";
+    if (kind == "operators") os << "# include \"optional_relops.hpp\"\n# include \"optional_hash.hpp\"\n# include <functional>\n";
+    os << "# include <utility>\nnamespace tr2 = std::experimental;\n";
+    for (int i = 0; i != types; ++i) {
+      os << payload(i) << instantiate(i);
+      if (kind == "operators") os << operators(i);
+    }
+  }
+  os << "int main() { }\n";
+  return os.str();
+}
+
+
+// running the compiler
+
+struct compilation
+{
+  double wall_s;
+  long max_rss_kb;
+  std::vector<std::pair<std::string, double>> phases;   // seconds
+};
+
+std::vector<std::string> words(const std::string& s)
+{
+  std::istringstream is(s);
+  std::vector<std::string> ans;
+  std::string w;
+  while (is >> w) ans.push_back(w);
+  return ans;
+}
+
+std::string slurp(const std::string& path)
+{
+  std::ifstream f(path.c_str());
+  std::ostringstream os;
+  os << f.rdbuf();
+  return os.str();
+}
+
+// runs the command with stderr into the file; returns the exit status and the peak memory
+int run(const std::vector<std::string>& argv, const std::string& stderr_file, long& max_rss_kb)
+{
+  pid_t pid = fork();
+  if (pid < 0) return -1;
+  if (pid == 0) {
+    int fd = open(stderr_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) { dup2(fd, 2); close(fd); }
+    std::vector<char*> args;
+    for (const std::string& a : argv) args.push_back(const_cast<char*>(a.c_str()));
+    args.push_back(nullptr);
+    execvp(args[0], args.data());
+    _exit(127);
+  }
+  int status = 0;
+  struct rusage ru;
+  while (wait4(pid, &status, 0, &ru) < 0)
+    if (errno != EINTR) return -1;
+  max_rss_kb = ru.ru_maxrss;   // the compiler driver and, as it waits for them, its children
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// the front end rows of GCC's -ftime-report:
+// " phase parsing   :   0.24 ( 96%)   0.10 ( 91%)   0.35 ( 92%)    32M ( 89%)"
+void gcc_phases(const std::string& report, compilation& c)
+{
+  static const char* const rows[] = { "phase ", "|", "preprocessing", "parser ", "template instantiation",
+                                      "constant expression evaluation", "TOTAL" };
+  std::istringstream is(report);
+  std::string line;
+  while (std::getline(is, line)) {
+    std::string::size_type colon = line.find(':');
+    if (colon == std::string::npos || line.empty() || line[0] != ' ') continue;
+    std::string name = line.substr(1, line.find_last_not_of(' ', colon - 1));
+    bool wanted = false;
+    for (const char* r : rows) wanted = wanted || name.compare(0, std::strlen(r), r) == 0;
+    if (!wanted) continue;
+    std::vector<std::string> w;
+    for (const std::string& x : words(line.substr(colon + 1)))
+      if (x[0] != '(' && x.back() != ')') w.push_back(x);   // usr sys wall GGC, without percentages
+    if (w.size() >= 3) c.phases.push_back(std::make_pair(name, std::atof(w[2].c_str())));
+  }
+}
+
+// the "Total ..." events of Clang's -ftime-trace: {"pid":1,...,"dur":1234,"name":"Total Frontend",...}
+void clang_phases(const std::string& trace, compilation& c)
+{
+  const std::string key = "\"name\":\"Total ";
+  for (std::string::size_type p = trace.find(key); p != std::string::npos; p = trace.find(key, p + 1)) {
+    std::string::size_type b = trace.rfind('{', p), e = trace.find('}', p);
+    std::string event = trace.substr(b, e - b);
+    std::string::size_type d = event.find("\"dur\":");
+    if (d == std::string::npos) continue;
+    std::string::size_type n = p + key.size();
+    std::string name = "Total " + trace.substr(n, trace.find('"', n) - n);
+    c.phases.push_back(std::make_pair(name, std::atof(event.c_str() + d + 6) / 1e6));
+  }
+}
+
+bool is_clang()
+{
+  static int clang = -1;
+  if (clang < 0) {
+    clang = 0;
+    if (FILE* f = popen("'" OPTIONAL_CXX "' --version", "r")) {
+      char buf[256];
+      while (std::fgets(buf, sizeof buf, f)) clang = clang || std::strstr(buf, "clang") != nullptr;
+      pclose(f);
+    }
+  }
+  return clang == 1;
+}
+
+compilation compile(const std::string& source, int repetitions)
+{
+  std::string object = source.substr(0, source.rfind('.')) + ".o";
+  std::string log = source.substr(0, source.rfind('.')) + ".log";
+  std::vector<std::string> argv = words(OPTIONAL_CXX " " OPTIONAL_CXX_FLAGS);
+  argv.push_back("-I" OPTIONAL_SOURCE_DIR);
+  argv.push_back(is_clang() ? "-ftime-trace" : "-ftime-report");
+  argv.push_back("-c");
+  argv.push_back(source);
+  argv.push_back("-o");
+  argv.push_back(object);
+
+  compilation best = { 1e100, 0, {} };
+  for (int r = 0; r != repetitions; ++r) {
+    long rss = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    int status = run(argv, log, rss);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (status != 0) {
+      std::cerr << "compilation of " << source << " failed:\n" << slurp(log);
+      std::exit(1);
+    }
+    if (wall < best.wall_s) {
+      best = compilation{ wall, rss, {} };
+      if (is_clang()) clang_phases(slurp(object.substr(0, object.size() - 2) + ".json"), best);
+      else gcc_phases(slurp(log), best);
+    }
+  }
+  std::remove(object.c_str());
+  return best;
+}
+
+
+std::string quoted(const std::string& s)
+{
+  std::string q = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') q += '\\';
+    q += c;
+  }
+  return q + '"';
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<int> type_counts = { 20, 100 };
+  std::vector<std::string> headers;
+  int repetitions = 3;
+  std::string dir = "bench_optional_compile.d", output;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--types" && i + 1 < argc) {
+      type_counts.clear();
+      std::string list = argv[++i];
+      std::replace(list.begin(), list.end(), ',', ' ');
+      for (const std::string& n : words(list)) type_counts.push_back(std::max(1, std::atoi(n.c_str())));
+    }
+    else if (a == "--header" && i + 1 < argc) headers.push_back(argv[++i]);
+    else if (a == "--repetitions" && i + 1 < argc) repetitions = std::max(1, std::atoi(argv[++i]));
+    else if (a == "--quick") { type_counts = { 10 }; repetitions = 1; }
+    else if (a == "--dir" && i + 1 < argc) dir = argv[++i];
+    else if (a == "--output" && i + 1 < argc) output = argv[++i];
+    else {
+      std::fprintf(stderr, "usage: %s [--types N,N...] [--header H]... [--repetitions N] [--quick] [--dir DIR] [--output FILE]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (headers.empty()) headers.push_back("optional.hpp");
+  mkdir(dir.c_str(), 0755);
+
+  std::ostringstream json;
+  json << "{\n  \"compiler\": " << quoted(OPTIONAL_CXX) << ",\n  \"flags\": " << quoted(OPTIONAL_CXX_FLAGS)
+       << ",\n  \"phase_report\": " << quoted(is_clang() ? "-ftime-trace" : "-ftime-report") << ",\n  \"results\": [";
+  bool first = true;
+  auto measure = [&](const std::string& kind, const std::string& config, const std::string& header, int types) {
+    std::string name = header;
+    std::replace(name.begin(), name.end(), '/', '_');
+    std::ostringstream path;
+    path << dir << '/' << kind << '_' << (kind == "empty" ? "none" : config + '_' + name.substr(0, name.rfind('.')))
+         << '_' << types << ".cpp";
+    std::ofstream(path.str().c_str()) << translation_unit(kind, config, header, types);
+
+    compilation c = compile(path.str(), repetitions);
+    json << (first ? "\n" : ",\n") << "    {\"tu\": " << quoted(kind) << ", \"header\": " << quoted(kind == "empty" ? "" : header)
+         << ", \"config\": " << quoted(kind == "empty" ? "" : config) << ", \"types\": " << types << ", \"wall_s\": " << c.wall_s << ", \"max_rss_kb\": " << c.max_rss_kb << ", \"phases\": {";
+    for (size_t i = 0; i != c.phases.size(); ++i)
+      json << (i ? ", " : "") << quoted(c.phases[i].first) << ": " << c.phases[i].second;
+    json << "}}";
+    first = false;
+    std::cerr << kind << ' ' << (kind == "empty" ? "-" : config + ' ' + header) << ' ' << types << ": " << c.wall_s << " s, "
+              << c.max_rss_kb << " kB\n";
+  };
+
+  measure("empty", "", "", 0);
+  for (const char* config : configs)
+    for (const std::string& h : headers) {
+      measure("include", config, h, 0);
+      for (int n : type_counts) {
+        measure("instantiate", config, h, n);
+        measure("operators", config, h, n);
+      }
+    }
+  json << "\n  ]\n}\n";
+
+  if (output.empty()) std::cout << json.str();
+  else std::ofstream(output.c_str()) << json.str();
+}
@@ -0,0 +1,252 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___COW_OPTIONAL_HPP___
+# define ___COW_OPTIONAL_HPP___
+
+# include "optional.hpp"
+# include <atomic>
+
+namespace std{
+
+namespace experimental{
+
+// reference counting policies for cow_optional
+
+// copies may be shared and released by different threads
+struct cow_atomic_policy
+{
+  typedef std::atomic<long> count_type;
+
+  static void increment(count_type& c) noexcept { c.fetch_add(1, memory_order_relaxed); }
+  static bool decrement(count_type& c) noexcept { return c.fetch_sub(1, memory_order_acq_rel) == 1; } // true for the last owner
+  static long load(const count_type& c) noexcept { return c.load(memory_order_acquire); }
+};
+
+// all copies of a payload stay within one thread
+struct cow_single_thread_policy
+{
+  typedef long count_type;
+
+  static void increment(count_type& c) noexcept { ++c; }
+  static bool decrement(count_type& c) noexcept { return --c == 0; }
+  static long load(const count_type& c) noexcept { return c; }
+};
+
+
+// cow_optional<T, Policy>: an optional<T> that is cheap to pass by value. Copies share one
+// immutable, reference-counted payload; a copy clones it only when it is about to be modified
+// through non-const access (operator*, operator->, value(), emplace, assignment of a T).
+// Read through a const reference to avoid the clone. The object is one pointer in size.
+template <class T, class Policy = cow_atomic_policy>
+class cow_optional
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, nullopt_t>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, in_place_t>::value, "bad T" );
+
+  struct payload
+  {
+    typename Policy::count_type refs;
+    T value;
+
+    template <class... Args>
+    explicit payload(Args&&... args) : refs(1), value(std::forward<Args>(args)...) {}
+  };
+
+  payload* p_;
+
+  typedef typename optional_check_policy<T>::type check_policy;
+
+  void release() noexcept
+  {
+    if (p_ && Policy::decrement(p_->refs)) delete p_;
+    p_ = nullptr;
+  }
+
+  // makes this the only owner of its payload
+  T& unshare()
+  {
+    assert (p_);
+    if (Policy::load(p_->refs) != 1) {
+      payload* c = new payload(static_cast<const T&>(p_->value));
+      release();
+      p_ = c;
+    }
+    return p_->value;
+  }
+
+public:
+  typedef T value_type;
+  typedef Policy policy_type;
+
+  constexpr cow_optional() noexcept : p_(nullptr) {}
+  constexpr cow_optional(nullopt_t) noexcept : p_(nullptr) {}
+
+  cow_optional(const T& v) : p_(new payload(v)) {}
+  cow_optional(T&& v) : p_(new payload(std::move(v))) {}
+
+  template <class... Args>
+  explicit cow_optional(in_place_t, Args&&... args) : p_(new payload(std::forward<Args>(args)...)) {}
+
+  explicit cow_optional(const optional<T>& o) : p_(o ? new payload(*o) : nullptr) {}
+  explicit cow_optional(optional<T>&& o) : p_(o ? new payload(std::move(*o)) : nullptr) {}
+
+  cow_optional(const cow_optional& rhs) noexcept : p_(rhs.p_)
+  {
+    if (p_) Policy::increment(p_->refs);
+  }
+
+  cow_optional(cow_optional&& rhs) noexcept : p_(rhs.p_) { rhs.p_ = nullptr; }
+
+  ~cow_optional() { release(); }
+
+  cow_optional& operator=(const cow_optional& rhs) noexcept
+  {
+    if (rhs.p_) Policy::increment(rhs.p_->refs);
+    release();
+    p_ = rhs.p_;
+    return *this;
+  }
+
+  cow_optional& operator=(cow_optional&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      release();
+      p_ = rhs.p_;
+      rhs.p_ = nullptr;
+    }
+    return *this;
+  }
+
+  cow_optional& operator=(nullopt_t) noexcept { release(); return *this; }
+
+  template <class U>
+  auto operator=(U&& v)
+  -> typename enable_if
+  <
+    is_same<typename decay<U>::type, T>::value,
+    cow_optional&
+  >::type
+  {
+    if (p_ && Policy::load(p_->refs) == 1) p_->value = std::forward<U>(v);
+    else                                   emplace(std::forward<U>(v));
+    return *this;
+  }
+
+  // a new payload; if this throws, *this is unchanged
+  template <class... Args>
+  void emplace(Args&&... args)
+  {
+    payload* n = new payload(std::forward<Args>(args)...);
+    release();
+    p_ = n;
+  }
+
+  void reset() noexcept { release(); }
+
+  void swap(cow_optional& rhs) noexcept { std::swap(p_, rhs.p_); }
+
+  // observers; the non-const ones make the payload private first
+  explicit operator bool() const noexcept { return p_ != nullptr; }
+  bool has_value() const noexcept { return p_ != nullptr; }
+
+  const T* operator->() const { assert (p_); return std::addressof(p_->value); }
+  T* operator->() { return std::addressof(unshare()); }
+
+  const T& operator*() const { assert (p_); return p_->value; }
+  T& operator*() { return unshare(); }
+
+  const T& value() const
+  {
+    if (check_policy::checks && !p_) check_policy::fail();
+    return p_->value;
+  }
+
+  T& value()
+  {
+    if (check_policy::checks && !p_) check_policy::fail();
+    return unshare();
+  }
+
+  template <class V>
+  T value_or(V&& v) const { return p_ ? p_->value : detail_::convert<T>(std::forward<V>(v)); }
+
+  // read access that never clones
+  const T& cref() const { assert (p_); return p_->value; }
+
+  // the number of cow_optional objects sharing the payload, 0 if disengaged
+  long use_count() const noexcept { return p_ ? Policy::load(p_->refs) : 0; }
+
+  // true if x and y share one payload
+  friend bool shares_payload(const cow_optional& x, const cow_optional& y) noexcept { return x.p_ && x.p_ == y.p_; }
+
+  optional<T> to_optional() const { return p_ ? optional<T>(p_->value) : optional<T>(); }
+};
+
+
+template <class T, class P> bool operator==(const cow_optional<T, P>& x, const cow_optional<T, P>& y)
+{
+  return bool(x) != bool(y) ? false : !bool(x) ? true : shares_payload(x, y) || x.cref() == y.cref();
+}
+
+template <class T, class P> bool operator!=(const cow_optional<T, P>& x, const cow_optional<T, P>& y)
+{
+  return !(x == y);
+}
+
+template <class T, class P> bool operator==(const cow_optional<T, P>& x, nullopt_t) noexcept
+{
+  return !x;
+}
+
+template <class T, class P> bool operator==(nullopt_t, const cow_optional<T, P>& x) noexcept
+{
+  return !x;
+}
+
+template <class T, class P> bool operator!=(const cow_optional<T, P>& x, nullopt_t) noexcept
+{
+  return bool(x);
+}
+
+template <class T, class P> bool operator!=(nullopt_t, const cow_optional<T, P>& x) noexcept
+{
+  return bool(x);
+}
+
+template <class T, class P> bool operator==(const cow_optional<T, P>& x, const T& v)
+{
+  return bool(x) ? x.cref() == v : false;
+}
+
+template <class T, class P> bool operator==(const T& v, const cow_optional<T, P>& x)
+{
+  return bool(x) ? v == x.cref() : false;
+}
+
+template <class T, class P> bool operator!=(const cow_optional<T, P>& x, const T& v)
+{
+  return bool(x) ? x.cref() != v : true;
+}
+
+template <class T, class P> bool operator!=(const T& v, const cow_optional<T, P>& x)
+{
+  return bool(x) ? v != x.cref() : true;
+}
+
+
+template <class T, class P>
+void swap(cow_optional<T, P>& x, cow_optional<T, P>& y) noexcept
+{
+  x.swap(y);
+}
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___COW_OPTIONAL_HPP___
@@ -0,0 +1,654 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___EXPECTED_HPP___
+# define ___EXPECTED_HPP___
+
+# include "optional.hpp"
+
+
+#if defined NDEBUG
+# define TR2_OPTIONAL_ASSERTED_EXPRESSION(CHECK, EXPR) (EXPR)
+#else
+# define TR2_OPTIONAL_ASSERTED_EXPRESSION(CHECK, EXPR) ((CHECK) ? (EXPR) : ([]{assert(!#CHECK);}(), (EXPR)))
+#endif
+
+namespace std{
+
+namespace experimental{
+
+// expected<T, E>: either a T or an error E that says why there is no T. It is laid out
+// like optional<T> (a flag followed by storage_t/constexpr_storage_t, now holding either
+// a T or an E), and is trivially destructible and trivially copyable whenever T and E
+// are, so returning one costs what returning an optional<T> costs. Errors
+// propagate through has_value() or the combinators; only value() fails, as the checked
+// access policy of optional<T> (optional_check_policy<T>) says: under optional_check_throw
+// it throws bad_expected_access<E>.
+
+template <class E> class unexpected;
+template <class T, class E> class expected;
+
+
+// the error, as a value distinguishable from a T
+template <class E>
+class unexpected
+{
+  static_assert( !std::is_reference<E>::value, "bad E" );
+
+  E error_;
+
+public:
+  constexpr explicit unexpected(const E& e) : error_(e) {}
+  constexpr explicit unexpected(E&& e) : error_(constexpr_move(e)) {}
+
+  constexpr const E& error() const noexcept { return error_; }
+  E& error() noexcept { return error_; }
+};
+
+template <class E>
+constexpr unexpected<typename decay<E>::type> make_unexpected(E&& e)
+{
+  return unexpected<typename decay<E>::type>(constexpr_forward<E>(e));
+}
+
+template <class E> constexpr bool operator==(const unexpected<E>& x, const unexpected<E>& y)
+{
+  return x.error() == y.error();
+}
+
+template <class E> constexpr bool operator!=(const unexpected<E>& x, const unexpected<E>& y)
+{
+  return !(x == y);
+}
+
+
+// in-place construction of the error
+constexpr struct unexpect_t{} unexpect{};
+
+
+template <class E>
+class bad_expected_access : public logic_error
+{
+  E error_;
+
+public:
+  explicit bad_expected_access(E e) : logic_error{"bad expected access"}, error_(std::move(e)) {}
+
+  const E& error() const noexcept { return error_; }
+};
+
+
+namespace detail_
+{
+
+# if OPTIONAL_HAS_EXCEPTIONS
+// the failure path of value(), out of line like that of optional<T>::value()
+template <class E>
+[[noreturn]] OPTIONAL_COLD_PATH void throw_bad_expected_access(const E& e)
+{
+  throw bad_expected_access<E>(e);
+}
+
+// for value() &&: the error is moved into the exception
+template <class E>
+[[noreturn]] OPTIONAL_COLD_PATH void throw_bad_expected_access_moving(E& e)
+{
+  throw bad_expected_access<E>(std::move(e));
+}
+# endif
+
+// what value() does on an error under the checked access policy Policy: every policy but
+// optional_check_throw fails as it does for optional<T>
+template <class Policy>
+struct expected_check
+{
+  template <class E> [[noreturn]] static void fail(const E&) { Policy::fail(); }
+  template <class E> [[noreturn]] static void fail_moving(E&) { Policy::fail(); }
+};
+
+template <>
+struct expected_check<optional_check_throw>
+{
+# if OPTIONAL_HAS_EXCEPTIONS
+  template <class E> [[noreturn]] static void fail(const E& e) { throw_bad_expected_access(e); }
+  template <class E> [[noreturn]] static void fail_moving(E& e) { throw_bad_expected_access_moving(e); }
+# else
+  template <class E> [[noreturn]] static void fail(const E&) { optional_check_throw::fail(); }
+  template <class E> [[noreturn]] static void fail_moving(E&) { optional_check_throw::fail(); }
+# endif
+};
+
+template <class T>
+struct is_unexpected : false_type {};
+
+template <class E>
+struct is_unexpected<unexpected<E>> : true_type {};
+
+template <class T>
+struct is_expected : false_type {};
+
+template <class T, class E>
+struct is_expected<expected<T, E>> : true_type {};
+
+
+// deletes the copy constructor of expected<T, E> unless both T and E are copy constructible;
+// that of expected_base below is user-provided and would otherwise always be declared
+template <bool Copyable>
+struct expected_copy_control {};
+
+template <>
+struct expected_copy_control<false>
+{
+  expected_copy_control() = default;
+  expected_copy_control(const expected_copy_control&) = delete;
+  expected_copy_control(expected_copy_control&&) = default;
+  expected_copy_control& operator=(const expected_copy_control&) = default;
+  expected_copy_control& operator=(expected_copy_control&&) = default;
+};
+
+// the parameter of the copy assignment of expected<T, E>, which is not declared unless both
+// T and E are copy constructible and copy assignable
+struct expected_not_copyable { expected_not_copyable() = delete; };
+
+
+// the dual of optional_base: the destructor destroys whichever member is alive
+template <class T, class E>
+struct expected_base
+{
+  bool has_value_;
+  union
+  {
+    storage_t<T> val_;
+    storage_t<E> err_;
+  };
+
+  template <class... Args> explicit constexpr expected_base(in_place_t, Args&&... args)
+    : has_value_(true), val_(constexpr_forward<Args>(args)...) {}
+
+  template <class... Args> explicit constexpr expected_base(unexpect_t, Args&&... args)
+    : has_value_(false), err_(constexpr_forward<Args>(args)...) {}
+
+  // if constructing the member throws, the destructor does not run
+  expected_base(const expected_base& rhs) : has_value_(rhs.has_value_), val_(trivial_init)
+  {
+    if (has_value_) ::new (static_cast<void*>(std::addressof(val_.value_))) T(rhs.val_.value_);
+    else            ::new (static_cast<void*>(std::addressof(err_.value_))) E(rhs.err_.value_);
+  }
+
+  expected_base(expected_base&& rhs)
+  noexcept(is_nothrow_move_constructible<T>::value && is_nothrow_move_constructible<E>::value)
+  : has_value_(rhs.has_value_), val_(trivial_init)
+  {
+    if (has_value_) ::new (static_cast<void*>(std::addressof(val_.value_))) T(std::move(rhs.val_.value_));
+    else            ::new (static_cast<void*>(std::addressof(err_.value_))) E(std::move(rhs.err_.value_));
+  }
+
+  ~expected_base()
+  {
+    if (has_value_) val_.value_.T::~T();
+    else            err_.value_.E::~E();
+  }
+};
+
+
+// the dual of constexpr_optional_base: trivially destructible and trivially copyable
+template <class T, class E>
+struct constexpr_expected_base
+{
+  bool has_value_;
+  union
+  {
+    constexpr_storage_t<T> val_;
+    constexpr_storage_t<E> err_;
+  };
+
+  template <class... Args> explicit constexpr constexpr_expected_base(in_place_t, Args&&... args)
+    : has_value_(true), val_(constexpr_forward<Args>(args)...) {}
+
+  template <class... Args> explicit constexpr constexpr_expected_base(unexpect_t, Args&&... args)
+    : has_value_(false), err_(constexpr_forward<Args>(args)...) {}
+
+  ~constexpr_expected_base() = default;
+};
+
+
+// Replaces the alive member *o with a New constructed from args. If that throws, *o
+// stays alive: the value is built before *o is destroyed where New can be constructed or
+// moved without throwing, and otherwise *o is moved aside and restored.
+template <class New, class Old, class... Args>
+void expected_reinit(integral_constant<int, 0>, New* n, Old* o, Args&&... args)
+{
+  o->Old::~Old();
+  ::new (static_cast<void*>(n)) New(std::forward<Args>(args)...);
+}
+
+template <class New, class Old, class... Args>
+void expected_reinit(integral_constant<int, 1>, New* n, Old* o, Args&&... args)
+{
+  New tmp(std::forward<Args>(args)...);
+  o->Old::~Old();
+  ::new (static_cast<void*>(n)) New(std::move(tmp));
+}
+
+template <class New, class Old, class... Args>
+void expected_reinit(integral_constant<int, 2>, New* n, Old* o, Args&&... args)
+{
+  static_assert( is_nothrow_move_constructible<Old>::value, "either T or E must be nothrow move constructible" );
+  Old saved(std::move(*o));
+  o->Old::~Old();
+# if OPTIONAL_HAS_EXCEPTIONS
+  try {
+    ::new (static_cast<void*>(n)) New(std::forward<Args>(args)...);
+  }
+  catch (...) {
+    ::new (static_cast<void*>(o)) Old(std::move(saved));
+    throw;
+  }
+# else
+  ::new (static_cast<void*>(n)) New(std::forward<Args>(args)...);
+# endif
+}
+
+template <class New, class Old, class... Args>
+void expected_reinit(New* n, Old* o, Args&&... args)
+{
+  typedef integral_constant<int,
+    is_nothrow_constructible<New, Args&&...>::value ? 0 :
+    is_nothrow_move_constructible<New>::value ? 1 : 2> strategy;
+  expected_reinit(strategy(), n, o, std::forward<Args>(args)...);
+}
+
+
+// Replaces the alive *p with a T constructed from args; if that throws, *p is unchanged.
+template <class T, class... Args>
+void expected_replace(true_type, T* p, Args&&... args)
+{
+  p->T::~T();
+  ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+}
+
+template <class T, class... Args>
+void expected_replace(false_type, T* p, Args&&... args)
+{
+  *p = T(std::forward<Args>(args)...);
+}
+
+
+template <class F, class V>
+using invoke_result_t = decltype(std::declval<F>()(std::declval<V>()));
+
+} // namespace detail_
+
+
+// the union of constexpr_expected_base has deleted copy and move constructors unless T and E
+// are trivially copyable
+template <class T, class E>
+using ExpectedBase = typename std::conditional<
+    is_trivially_destructible<T>::value && is_trivially_destructible<E>::value
+    && is_trivially_copyable<T>::value && is_trivially_copyable<E>::value,
+    detail_::constexpr_expected_base<T, E>,
+    detail_::expected_base<T, E>
+>::type;
+
+
+template <class T, class E>
+class expected : private ExpectedBase<T, E>,
+                 private detail_::expected_copy_control<is_copy_constructible<T>::value && is_copy_constructible<E>::value>
+{
+  static_assert( !std::is_reference<T>::value && !std::is_void<T>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, in_place_t>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, unexpect_t>::value, "bad T" );
+  static_assert( !detail_::is_unexpected<typename std::decay<T>::type>::value, "bad T" );
+  static_assert( !std::is_reference<E>::value && !std::is_void<E>::value, "bad E" );
+  static_assert( !std::is_const<T>::value && !std::is_const<E>::value, "bad T" );
+
+  typedef ExpectedBase<T, E> base;
+  typedef detail_::expected_check<typename optional_check_policy<T>::type> check;
+
+  constexpr static bool copyable = is_copy_constructible<T>::value && is_copy_constructible<E>::value
+                                && is_copy_assignable<T>::value && is_copy_assignable<E>::value;
+
+  constexpr bool accessible() const noexcept { return !optional_check_policy<T>::type::checks || has_value(); }
+
+  T* valptr() { return std::addressof(base::val_.value_); }
+  E* errptr() { return std::addressof(base::err_.value_); }
+  constexpr const T* valptr() const { return detail_::static_addressof(base::val_.value_); }
+
+  template <class... Args>
+  void set_value(Args&&... args)
+  {
+    if (has_value()) {
+      detail_::expected_replace(is_nothrow_constructible<T, Args&&...>(), valptr(), std::forward<Args>(args)...);
+    }
+    else {
+      detail_::expected_reinit(valptr(), errptr(), std::forward<Args>(args)...);
+      base::has_value_ = true;
+    }
+  }
+
+  template <class... Args>
+  void set_error(Args&&... args)
+  {
+    if (!has_value()) {
+      detail_::expected_replace(is_nothrow_constructible<E, Args&&...>(), errptr(), std::forward<Args>(args)...);
+    }
+    else {
+      detail_::expected_reinit(errptr(), valptr(), std::forward<Args>(args)...);
+      base::has_value_ = false;
+    }
+  }
+
+  template <class U>
+  void assign_value(U&& v)
+  {
+    if (has_value()) *valptr() = std::forward<U>(v);
+    else             set_value(std::forward<U>(v));
+  }
+
+  template <class G>
+  void assign_error(G&& e)
+  {
+    if (!has_value()) *errptr() = std::forward<G>(e);
+    else              set_error(std::forward<G>(e));
+  }
+
+  // the combinators, for any value category of self
+  template <class Self, class F,
+            class R = typename decay<detail_::invoke_result_t<F, decltype(*std::declval<Self>())>>::type>
+  static R and_then_impl(Self&& self, F&& f)
+  {
+    static_assert( detail_::is_expected<R>::value, "and_then requires a function returning expected" );
+    static_assert( is_same<typename R::error_type, E>::value, "and_then requires the same error type" );
+    if (self.has_value()) return std::forward<F>(f)(*std::forward<Self>(self));
+    return R(unexpect, std::forward<Self>(self).error());
+  }
+
+  template <class Self, class F,
+            class U = typename decay<detail_::invoke_result_t<F, decltype(*std::declval<Self>())>>::type>
+  static expected<U, E> transform_impl(Self&& self, F&& f)
+  {
+    if (self.has_value()) return expected<U, E>(in_place, std::forward<F>(f)(*std::forward<Self>(self)));
+    return expected<U, E>(unexpect, std::forward<Self>(self).error());
+  }
+
+  template <class Self, class F,
+            class R = typename decay<detail_::invoke_result_t<F, decltype(std::declval<Self>().error())>>::type>
+  static R or_else_impl(Self&& self, F&& f)
+  {
+    static_assert( detail_::is_expected<R>::value, "or_else requires a function returning expected" );
+    static_assert( is_same<typename R::value_type, T>::value, "or_else requires the same value type" );
+    if (self.has_value()) return R(in_place, *std::forward<Self>(self));
+    return std::forward<F>(f)(std::forward<Self>(self).error());
+  }
+
+  template <class Self, class F,
+            class G = typename decay<detail_::invoke_result_t<F, decltype(std::declval<Self>().error())>>::type>
+  static expected<T, G> transform_error_impl(Self&& self, F&& f)
+  {
+    if (self.has_value()) return expected<T, G>(in_place, *std::forward<Self>(self));
+    return expected<T, G>(unexpect, std::forward<F>(f)(std::forward<Self>(self).error()));
+  }
+
+public:
+  typedef T value_type;
+  typedef E error_type;
+  typedef unexpected<E> unexpected_type;
+
+  // constructors
+  constexpr expected() : base(in_place_t{}) {}
+
+  constexpr expected(const T& v) : base(in_place_t{}, v) {}
+  constexpr expected(T&& v) : base(in_place_t{}, constexpr_move(v)) {}
+
+  template <class... Args>
+  explicit constexpr expected(in_place_t, Args&&... args)
+  : base(in_place_t{}, constexpr_forward<Args>(args)...) {}
+
+  template <class G, typename enable_if<is_constructible<E, const G&>::value, bool>::type = false>
+  constexpr expected(const unexpected<G>& e) : base(unexpect_t{}, e.error()) {}
+
+  template <class G, typename enable_if<is_constructible<E, G&&>::value, bool>::type = false>
+  constexpr expected(unexpected<G>&& e) : base(unexpect_t{}, constexpr_move(e.error())) {}
+
+  template <class... Args>
+  explicit constexpr expected(unexpect_t, Args&&... args)
+  : base(unexpect_t{}, constexpr_forward<Args>(args)...) {}
+
+  expected(const expected&) = default;
+  expected(expected&&) = default;
+
+  // assignment
+  expected& operator=(typename conditional<copyable, const expected&, const detail_::expected_not_copyable&>::type rhs)
+  {
+    if (rhs.has_value()) assign_value(*rhs);
+    else                 assign_error(rhs.error());
+    return *this;
+  }
+
+  expected& operator=(expected&& rhs)
+  noexcept(is_nothrow_move_assignable<T>::value && is_nothrow_move_constructible<T>::value
+           && is_nothrow_move_assignable<E>::value && is_nothrow_move_constructible<E>::value)
+  {
+    if (rhs.has_value()) assign_value(std::move(*rhs));
+    else                 assign_error(std::move(rhs.error()));
+    return *this;
+  }
+
+  template <class U>
+  auto operator=(U&& v)
+  -> typename enable_if
+  <
+    is_same<typename decay<U>::type, T>::value,
+    expected&
+  >::type
+  {
+    assign_value(std::forward<U>(v));
+    return *this;
+  }
+
+  template <class G>
+  expected& operator=(const unexpected<G>& e) { assign_error(e.error()); return *this; }
+
+  template <class G>
+  expected& operator=(unexpected<G>&& e) { assign_error(std::move(e.error())); return *this; }
+
+  template <class... Args>
+  T& emplace(Args&&... args)
+  {
+    set_value(std::forward<Args>(args)...);
+    return *valptr();
+  }
+
+  void swap(expected& rhs)
+  {
+    if (has_value() && rhs.has_value())        { using std::swap; swap(**this, *rhs); }
+    else if (!has_value() && !rhs.has_value()) { using std::swap; swap(error(), rhs.error()); }
+    else {
+      expected tmp(std::move(rhs));
+      rhs = std::move(*this);
+      *this = std::move(tmp);
+    }
+  }
+
+  // observers
+  explicit constexpr operator bool() const noexcept { return base::has_value_; }
+  constexpr bool has_value() const noexcept { return base::has_value_; }
+
+  constexpr const T* operator->() const { return TR2_OPTIONAL_ASSERTED_EXPRESSION(has_value(), valptr()); }
+  T* operator->() { assert(has_value()); return valptr(); }
+
+# if OPTIONAL_HAS_THIS_RVALUE_REFS == 1
+
+  constexpr const T& operator*() const& { return TR2_OPTIONAL_ASSERTED_EXPRESSION(has_value(), base::val_.value_); }
+  T& operator*() & { assert(has_value()); return base::val_.value_; }
+  T&& operator*() && { assert(has_value()); return std::move(base::val_.value_); }
+
+  constexpr const E& error() const& { return TR2_OPTIONAL_ASSERTED_EXPRESSION(!has_value(), base::err_.value_); }
+  E& error() & { assert(!has_value()); return base::err_.value_; }
+  E&& error() && { assert(!has_value()); return std::move(base::err_.value_); }
+
+  constexpr const T& value() const& {
+    return accessible() ? base::val_.value_ : (check::fail(base::err_.value_), base::val_.value_);
+  }
+
+  T& value() & {
+    if (!accessible()) check::fail(base::err_.value_);
+    return base::val_.value_;
+  }
+
+  T&& value() && {
+    if (!accessible()) check::fail_moving(base::err_.value_);
+    return std::move(base::val_.value_);
+  }
+
+  template <class V>
+  constexpr T value_or(V&& v) const& { return has_value() ? **this : detail_::convert<T>(constexpr_forward<V>(v)); }
+
+  template <class V>
+  T value_or(V&& v) && { return has_value() ? std::move(**this) : detail_::convert<T>(std::forward<V>(v)); }
+
+  optional<T> to_optional() const& { return has_value() ? optional<T>(**this) : optional<T>(); }
+  optional<T> to_optional() && { return has_value() ? optional<T>(std::move(**this)) : optional<T>(); }
+
+  template <class F> auto and_then(F&& f) const& -> decltype(and_then_impl(*this, std::forward<F>(f)))
+  { return and_then_impl(*this, std::forward<F>(f)); }
+  template <class F> auto and_then(F&& f) && -> decltype(and_then_impl(std::move(*this), std::forward<F>(f)))
+  { return and_then_impl(std::move(*this), std::forward<F>(f)); }
+
+  template <class F> auto transform(F&& f) const& -> decltype(transform_impl(*this, std::forward<F>(f)))
+  { return transform_impl(*this, std::forward<F>(f)); }
+  template <class F> auto transform(F&& f) && -> decltype(transform_impl(std::move(*this), std::forward<F>(f)))
+  { return transform_impl(std::move(*this), std::forward<F>(f)); }
+
+  template <class F> auto or_else(F&& f) const& -> decltype(or_else_impl(*this, std::forward<F>(f)))
+  { return or_else_impl(*this, std::forward<F>(f)); }
+  template <class F> auto or_else(F&& f) && -> decltype(or_else_impl(std::move(*this), std::forward<F>(f)))
+  { return or_else_impl(std::move(*this), std::forward<F>(f)); }
+
+  template <class F> auto transform_error(F&& f) const& -> decltype(transform_error_impl(*this, std::forward<F>(f)))
+  { return transform_error_impl(*this, std::forward<F>(f)); }
+  template <class F> auto transform_error(F&& f) && -> decltype(transform_error_impl(std::move(*this), std::forward<F>(f)))
+  { return transform_error_impl(std::move(*this), std::forward<F>(f)); }
+
+# else
+
+  constexpr const T& operator*() const { return TR2_OPTIONAL_ASSERTED_EXPRESSION(has_value(), base::val_.value_); }
+  T& operator*() { assert(has_value()); return base::val_.value_; }
+
+  constexpr const E& error() const { return TR2_OPTIONAL_ASSERTED_EXPRESSION(!has_value(), base::err_.value_); }
+  E& error() { assert(!has_value()); return base::err_.value_; }
+
+  constexpr const T& value() const {
+    return accessible() ? base::val_.value_ : (check::fail(base::err_.value_), base::val_.value_);
+  }
+
+  T& value() {
+    if (!accessible()) check::fail(base::err_.value_);
+    return base::val_.value_;
+  }
+
+  template <class V>
+  constexpr T value_or(V&& v) const { return has_value() ? **this : detail_::convert<T>(constexpr_forward<V>(v)); }
+
+  optional<T> to_optional() const { return has_value() ? optional<T>(**this) : optional<T>(); }
+
+  template <class F> auto and_then(F&& f) const -> decltype(and_then_impl(*this, std::forward<F>(f)))
+  { return and_then_impl(*this, std::forward<F>(f)); }
+
+  template <class F> auto transform(F&& f) const -> decltype(transform_impl(*this, std::forward<F>(f)))
+  { return transform_impl(*this, std::forward<F>(f)); }
+
+  template <class F> auto or_else(F&& f) const -> decltype(or_else_impl(*this, std::forward<F>(f)))
+  { return or_else_impl(*this, std::forward<F>(f)); }
+
+  template <class F> auto transform_error(F&& f) const -> decltype(transform_error_impl(*this, std::forward<F>(f)))
+  { return transform_error_impl(*this, std::forward<F>(f)); }
+
+# endif
+};
+
+
+// conversion from optional<T>: a disengaged optional becomes the error e
+template <class T, class G>
+expected<T, typename decay<G>::type> to_expected(const optional<T>& o, G&& e)
+{
+  typedef expected<T, typename decay<G>::type> R;
+  return o ? R(in_place, *o) : R(unexpect, std::forward<G>(e));
+}
+
+template <class T, class G>
+expected<T, typename decay<G>::type> to_expected(optional<T>&& o, G&& e)
+{
+  typedef expected<T, typename decay<G>::type> R;
+  return o ? R(in_place, std::move(*o)) : R(unexpect, std::forward<G>(e));
+}
+
+
+// relational operators
+template <class T, class E> constexpr bool operator==(const expected<T, E>& x, const expected<T, E>& y)
+{
+  return x.has_value() != y.has_value() ? false : x.has_value() ? *x == *y : x.error() == y.error();
+}
+
+template <class T, class E> constexpr bool operator!=(const expected<T, E>& x, const expected<T, E>& y)
+{
+  return !(x == y);
+}
+
+template <class T, class E> constexpr bool operator==(const expected<T, E>& x, const T& v)
+{
+  return x.has_value() ? *x == v : false;
+}
+
+template <class T, class E> constexpr bool operator==(const T& v, const expected<T, E>& x)
+{
+  return x.has_value() ? v == *x : false;
+}
+
+template <class T, class E> constexpr bool operator!=(const expected<T, E>& x, const T& v)
+{
+  return x.has_value() ? *x != v : true;
+}
+
+template <class T, class E> constexpr bool operator!=(const T& v, const expected<T, E>& x)
+{
+  return x.has_value() ? v != *x : true;
+}
+
+template <class T, class E> constexpr bool operator==(const expected<T, E>& x, const unexpected<E>& e)
+{
+  return x.has_value() ? false : x.error() == e.error();
+}
+
+template <class T, class E> constexpr bool operator==(const unexpected<E>& e, const expected<T, E>& x)
+{
+  return x.has_value() ? false : e.error() == x.error();
+}
+
+template <class T, class E> constexpr bool operator!=(const expected<T, E>& x, const unexpected<E>& e)
+{
+  return !(x == e);
+}
+
+template <class T, class E> constexpr bool operator!=(const unexpected<E>& e, const expected<T, E>& x)
+{
+  return !(e == x);
+}
+
+
+template <class T, class E>
+void swap(expected<T, E>& x, expected<T, E>& y)
+{
+  x.swap(y);
+}
+
+
+} // namespace experimental
+} // namespace std
+
+# undef TR2_OPTIONAL_ASSERTED_EXPRESSION
+
+# endif //___EXPECTED_HPP___
@@ -0,0 +1,113 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___ONCE_OPTIONAL_HPP___
+# define ___ONCE_OPTIONAL_HPP___
+
+# include "optional.hpp"
+# include "optional_wait.hpp"
+
+namespace std{
+
+namespace experimental{
+
+// once_optional<T>: a value that is built at most once, by whichever thread asks for it first.
+// Once engaged, get_or_init() is a single acquire load. Threads that arrive while the value
+// is being built block until it is ready. If the initializer throws, the object stays
+// disengaged and the next caller (possibly one that was blocked) runs its own initializer.
+template <class T>
+class once_optional
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, nullopt_t>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, in_place_t>::value, "bad T" );
+
+  enum : uint32_t { empty, busy, busy_with_waiters, ready };
+
+  std::atomic<uint32_t> state_;
+  storage_t<typename std::remove_const<T>::type> storage_;
+
+  T* dataptr() noexcept { return std::addressof(storage_.value_); }
+  const T* dataptr() const noexcept { return std::addressof(storage_.value_); }
+
+  template <class F>
+  T& init_slow(F&& f)
+  {
+    uint32_t s = state_.load(memory_order_acquire);
+    for (;;) {
+      if (s == ready)
+        return *dataptr();
+
+      if (s == empty) {
+        if (!state_.compare_exchange_weak(s, busy, memory_order_acquire, memory_order_acquire))
+          continue;
+        try {
+          ::new (static_cast<void*>(dataptr())) T(std::forward<F>(f)());
+        }
+        catch (...) {
+          if (state_.exchange(empty, memory_order_release) == busy_with_waiters)
+            detail_::atomic_notify_all(state_);
+          throw;
+        }
+        if (state_.exchange(ready, memory_order_release) == busy_with_waiters)
+          detail_::atomic_notify_all(state_);
+        return *dataptr();
+      }
+
+      if (s == busy && !state_.compare_exchange_weak(s, busy_with_waiters, memory_order_acquire, memory_order_acquire))
+        continue;
+      detail_::atomic_wait(state_, busy_with_waiters);
+      s = state_.load(memory_order_acquire);
+    }
+  }
+
+public:
+  typedef T value_type;
+
+  constexpr once_optional() noexcept : state_(empty), storage_(trivial_init) {}
+  constexpr once_optional(nullopt_t) noexcept : state_(empty), storage_(trivial_init) {}
+
+  once_optional(const once_optional&) = delete;
+  once_optional& operator=(const once_optional&) = delete;
+
+  ~once_optional() { if (state_.load(memory_order_relaxed) == ready) dataptr()->T::~T(); }
+
+  // returns the contained value, first initializing it with f() if there is none
+  template <class F>
+  T& get_or_init(F&& f)
+  {
+    if (state_.load(memory_order_acquire) == ready)
+      return *dataptr();
+    return init_slow(std::forward<F>(f));
+  }
+
+  // the contained value if it has been built, never blocks
+  optional<T&> get() noexcept
+  {
+    return state_.load(memory_order_acquire) == ready ? optional<T&>(*dataptr()) : optional<T&>();
+  }
+
+  optional<const T&> get() const noexcept
+  {
+    return state_.load(memory_order_acquire) == ready ? optional<const T&>(*dataptr()) : optional<const T&>();
+  }
+
+  bool has_value() const noexcept { return state_.load(memory_order_acquire) == ready; }
+  explicit operator bool() const noexcept { return has_value(); }
+
+  // destroys the contained value; must not run concurrently with any other member function
+  void reset() noexcept
+  {
+    if (state_.load(memory_order_relaxed) == ready) dataptr()->T::~T();
+    state_.store(empty, memory_order_relaxed);
+  }
+};
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___ONCE_OPTIONAL_HPP___
@@ -0,0 +1,52 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_BAD_ACCESS_HPP___
+# define ___OPTIONAL_BAD_ACCESS_HPP___
+
+// bad_optional_access and the function that throws it for the throwing check policy, kept
+// out of optional_core.hpp for the sake of <stdexcept>, which brings <string> with it.
+
+# include "optional_core.hpp"
+# include <stdexcept>
+# include <string>
+
+namespace std{
+
+namespace experimental{
+
+// 20.5.8, class bad_optional_access
+class bad_optional_access : public logic_error {
+public:
+  explicit bad_optional_access(const string& what_arg) : logic_error{what_arg} {}
+  explicit bad_optional_access(const char* what_arg) : logic_error{what_arg} {}
+};
+
+
+namespace detail_
+{
+
+# if OPTIONAL_HAS_EXCEPTIONS
+// throws copies of one exception object; the message is allocated by the first failure
+// only, and the copies share it. Always emitted, so that the translation units that include
+// only optional_core.hpp find it at link time
+#   if defined __GNUC__
+__attribute__((used))
+#   endif
+[[noreturn]] OPTIONAL_COLD_PATH inline void throw_bad_optional_access()
+{
+  static const bad_optional_access e("bad optional access");
+  throw e;
+}
+# endif
+
+} // namespace detail_
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_BAD_ACCESS_HPP___
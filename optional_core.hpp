@@ -0,0 +1,1097 @@
+// Copyright (C) 2011 - 2012 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+// The idea and interface is based on Boost.Optional library
+// authored by Fernando Luis Cacciola Carballal
+
+# ifndef ___OPTIONAL_CORE_HPP___
+# define ___OPTIONAL_CORE_HPP___
+
+// optional<T> and optional<T&> with the headers they cannot do without. The relational
+// operators are in optional_relops.hpp, std::hash in optional_hash.hpp, and
+// bad_optional_access with the throwing check policy in optional_bad_access.hpp, which
+// value() needs under that policy, the default; optional.hpp includes them all.
+
+# include "optional_fwd.hpp"
+# include <utility>
+# include <type_traits>
+# include <initializer_list>
+# include <cassert>
+# include <exception>
+# include <cstdlib>
+
+// uses_allocator, allocator_arg and reference_wrapper come from <memory> and <functional>.
+// Defining OPTIONAL_LIBSTDCXX_INTERNAL_HEADERS opts in to libstdc++'s much smaller internal
+// headers for them instead; these are not a stable interface, so the standard headers are
+// used wherever the internal ones are not found (other libraries, libstdc++ before 7).
+# if (defined OPTIONAL_LIBSTDCXX_INTERNAL_HEADERS) && (defined __GLIBCXX__) && (defined _GLIBCXX_RELEASE) && (defined __has_include)
+#   if (_GLIBCXX_RELEASE >= 7) && __has_include(<bits/uses_allocator.h>) && __has_include(<bits/refwrap.h>)
+#     define OPTIONAL_USES_LIBSTDCXX_INTERNAL_HEADERS 1
+#   endif
+# endif
+
+# if defined OPTIONAL_USES_LIBSTDCXX_INTERNAL_HEADERS
+#   include <bits/uses_allocator.h>
+#   include <bits/refwrap.h>
+# else
+#   include <memory>
+#   include <functional>
+# endif
+
+# define TR2_OPTIONAL_REQUIRES(...) typename enable_if<__VA_ARGS__::value, bool>::type = false
+
+# if defined __GNUC__ // NOTE: GNUC is also defined for Clang
+#   if (__GNUC__ == 4) && (__GNUC_MINOR__ >= 8)
+#     define TR2_OPTIONAL_GCC_4_8_AND_HIGHER___
+#   elif (__GNUC__ > 4)
+#     define TR2_OPTIONAL_GCC_4_8_AND_HIGHER___
+#   endif
+
+#   if (__GNUC__ == 4) && (__GNUC_MINOR__ >= 7)
+#     define TR2_OPTIONAL_GCC_4_7_AND_HIGHER___
+#   elif (__GNUC__ > 4)
+#     define TR2_OPTIONAL_GCC_4_7_AND_HIGHER___
+#   endif
+
+#   if (__GNUC__ == 4) && (__GNUC_MINOR__ == 8) && (__GNUC_PATCHLEVEL__ >= 1)
+#     define TR2_OPTIONAL_GCC_4_8_1_AND_HIGHER___
+#   elif (__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)
+#     define TR2_OPTIONAL_GCC_4_8_1_AND_HIGHER___
+#   elif (__GNUC__ > 4)
+#     define TR2_OPTIONAL_GCC_4_8_1_AND_HIGHER___
+#   endif
+# endif
+
+# if defined __clang_major__
+#   if (__clang_major__ == 3 && __clang_minor__ >= 5)
+#     define TR2_OPTIONAL_CLANG_3_5_AND_HIGHTER_
+#   elif (__clang_major__ > 3)
+#     define TR2_OPTIONAL_CLANG_3_5_AND_HIGHTER_
+#   endif
+#   if defined TR2_OPTIONAL_CLANG_3_5_AND_HIGHTER_
+#     define TR2_OPTIONAL_CLANG_3_4_2_AND_HIGHER_
+#   elif (__clang_major__ == 3 && __clang_minor__ == 4 && __clang_patchlevel__ >= 2)
+#     define TR2_OPTIONAL_CLANG_3_4_2_AND_HIGHER_
+#   endif
+# endif
+
+# if defined _MSC_VER
+#   if (_MSC_VER >= 1900)
+#     define TR2_OPTIONAL_MSVC_2015_AND_HIGHER___
+#   endif
+# endif
+
+# if defined __clang__
+#   if (__clang_major__ > 2) || (__clang_major__ == 2) && (__clang_minor__ >= 9)
+#     define OPTIONAL_HAS_THIS_RVALUE_REFS 1
+#   else
+#     define OPTIONAL_HAS_THIS_RVALUE_REFS 0
+#   endif
+# elif defined TR2_OPTIONAL_GCC_4_8_1_AND_HIGHER___
+#   define OPTIONAL_HAS_THIS_RVALUE_REFS 1
+# elif defined TR2_OPTIONAL_MSVC_2015_AND_HIGHER___
+#   define OPTIONAL_HAS_THIS_RVALUE_REFS 1
+# else
+#   define OPTIONAL_HAS_THIS_RVALUE_REFS 0
+# endif
+
+
+# if defined TR2_OPTIONAL_GCC_4_8_1_AND_HIGHER___
+#   define OPTIONAL_HAS_CONSTEXPR_INIT_LIST 1
+#   define OPTIONAL_CONSTEXPR_INIT_LIST constexpr
+# else
+#   define OPTIONAL_HAS_CONSTEXPR_INIT_LIST 0
+#   define OPTIONAL_CONSTEXPR_INIT_LIST
+# endif
+
+# if defined TR2_OPTIONAL_CLANG_3_5_AND_HIGHTER_ && (defined __cplusplus) && (__cplusplus != 201103L)
+#   define OPTIONAL_HAS_MOVE_ACCESSORS 1
+# else
+#   define OPTIONAL_HAS_MOVE_ACCESSORS 0
+# endif
+
+// In C++11 constexpr implies const, so we need to make non-const members also non-constexpr
+# if (defined __cplusplus) && (__cplusplus == 201103L)
+#   define OPTIONAL_MUTABLE_CONSTEXPR
+# else
+#   define OPTIONAL_MUTABLE_CONSTEXPR constexpr
+# endif
+
+# if defined __cpp_exceptions || defined __EXCEPTIONS || defined _CPPUNWIND
+#   define OPTIONAL_HAS_EXCEPTIONS 1
+# else
+#   define OPTIONAL_HAS_EXCEPTIONS 0
+# endif
+
+// C++20 coroutines: a function returning optional<T> may be a coroutine (optional_coroutine.hpp)
+# if !defined OPTIONAL_HAS_COROUTINES
+#   if (defined __cpp_impl_coroutine) && (defined __has_include)
+#     if __has_include(<coroutine>)
+#       define OPTIONAL_HAS_COROUTINES 1
+#     endif
+#   endif
+# endif
+
+# if !defined OPTIONAL_HAS_COROUTINES
+#   define OPTIONAL_HAS_COROUTINES 0
+# endif
+
+// keeps a failure path out of line and out of the hot code around its callers
+# if defined __GNUC__
+#   define OPTIONAL_COLD_PATH __attribute__((noinline, cold))
+# elif defined _MSC_VER
+#   define OPTIONAL_COLD_PATH __declspec(noinline)
+# else
+#   define OPTIONAL_COLD_PATH
+# endif
+
+// Opt-in USDT probes (define OPTIONAL_USDT), for perf, bpftrace or SystemTap:
+//   optional:value_failure  value() called on a disengaged optional
+//   optional:emplace        emplace()
+//   optional:reset          reset()
+//   optional:disengage      an assignment of nullopt or of a disengaged optional empties an engaged one
+// Each probe passes the hash of T's name, sizeof(T) and T's name as a C string. The notes have
+// the layout written by SystemTap's <sys/sdt.h>, which this does not need. Without OPTIONAL_USDT
+// a probe expands to nothing.
+# if defined OPTIONAL_USDT && defined __ELF__ && (defined __x86_64__ || defined __aarch64__)
+#   define OPTIONAL_HAS_USDT 1
+# else
+#   define OPTIONAL_HAS_USDT 0
+# endif
+
+# if OPTIONAL_HAS_USDT
+#   include "optional_type_name.hpp"
+#   define OPTIONAL_USDT_PROBE3(NAME, A0, A1, A2)                                          \
+  __asm__ __volatile__ (                                                                    \
+    "990: nop\n"                                                                            \
+    ".pushsection .note.stapsdt, \"?\", \"note\"\n"                                         \
+    ".balign 4\n"                                                                           \
+    ".4byte 992f-991f, 994f-993f, 3\n"                                                      \
+    "991: .asciz \"stapsdt\"\n"                                                             \
+    "992: .balign 4\n"                                                                      \
+    "993: .8byte 990b\n"                                                                    \
+    ".8byte _.stapsdt.base\n"                                                               \
+    ".8byte 0\n"                                                                            \
+    ".asciz \"optional\"\n"                                                                 \
+    ".asciz \"" #NAME "\"\n"                                                                \
+    ".asciz \"8@%0 8@%1 8@%2\"\n"                                                           \
+    "994: .balign 4\n"                                                                      \
+    ".popsection\n"                                                                         \
+    ".ifndef _.stapsdt.base\n"                                                              \
+    ".pushsection .stapsdt.base, \"aG\", \"progbits\", .stapsdt.base, comdat\n"             \
+    ".weak _.stapsdt.base\n"                                                                \
+    ".hidden _.stapsdt.base\n"                                                              \
+    "_.stapsdt.base: .space 1\n"                                                            \
+    ".size _.stapsdt.base, 1\n"                                                             \
+    ".popsection\n"                                                                         \
+    ".endif\n"                                                                              \
+    :: "r"(A0), "r"(A1), "r"(A2))
+#   define OPTIONAL_PROBE(NAME, T)                                                         \
+  OPTIONAL_USDT_PROBE3(NAME, ::std::experimental::detail_::probe_type<T>::hash(),           \
+                       static_cast<unsigned long long>(sizeof(T)),                          \
+                       ::std::experimental::detail_::probe_type<T>::name())
+# else
+#   define OPTIONAL_PROBE(NAME, T) ((void)0)
+# endif
+
+// OPTIONAL_INSTRUMENT: count copies, moves, emplaces, resets and failed accesses per payload
+// type; see optional_instrument.hpp for the report
+# if defined OPTIONAL_INSTRUMENT
+#   include "optional_instrument.hpp"
+#   define OPTIONAL_COUNT(T, EVENT) ((void)::std::experimental::detail_::optional_count<T>(EVENT))
+# else
+#   define OPTIONAL_COUNT(T, EVENT) ((void)0)
+# endif
+
+namespace std{
+
+namespace experimental{
+
+// BEGIN workaround for missing is_trivially_destructible
+# if defined TR2_OPTIONAL_GCC_4_8_AND_HIGHER___
+    // leave it: it is already there
+# elif defined TR2_OPTIONAL_CLANG_3_4_2_AND_HIGHER_
+    // leave it: it is already there
+# elif defined TR2_OPTIONAL_MSVC_2015_AND_HIGHER___
+    // leave it: it is already there
+# elif defined TR2_OPTIONAL_DISABLE_EMULATION_OF_TYPE_TRAITS
+    // leave it: the user doesn't want it
+# else
+	template <typename T>
+	using is_trivially_destructible = std::has_trivial_destructor<T>;
+# endif
+// END workaround for missing is_trivially_destructible
+
+# if (defined TR2_OPTIONAL_GCC_4_7_AND_HIGHER___)
+    // leave it; our metafunctions are already defined.
+# elif defined TR2_OPTIONAL_CLANG_3_4_2_AND_HIGHER_
+    // leave it; our metafunctions are already defined.
+# elif defined TR2_OPTIONAL_MSVC_2015_AND_HIGHER___
+    // leave it: it is already there
+# elif defined TR2_OPTIONAL_DISABLE_EMULATION_OF_TYPE_TRAITS
+    // leave it: the user doesn't want it
+# else
+
+
+// workaround for missing traits in GCC and CLANG
+template <class T>
+struct is_nothrow_move_constructible
+{
+  constexpr static bool value = std::is_nothrow_constructible<T, T&&>::value;
+};
+
+
+template <class T, class U>
+struct is_assignable
+{
+  template <class X, class Y>
+  constexpr static bool has_assign(...) { return false; }
+
+  template <class X, class Y, size_t S = sizeof((std::declval<X>() = std::declval<Y>(), true)) >
+  // the comma operator is necessary for the cases where operator= returns void
+  constexpr static bool has_assign(bool) { return true; }
+
+  constexpr static bool value = has_assign<T, U>(true);
+};
+
+
+template <class T>
+struct is_nothrow_move_assignable
+{
+  template <class X, bool has_any_move_assign>
+  struct has_nothrow_move_assign {
+    constexpr static bool value = false;
+  };
+
+  template <class X>
+  struct has_nothrow_move_assign<X, true> {
+    constexpr static bool value = noexcept( std::declval<X&>() = std::declval<X&&>() );
+  };
+
+  constexpr static bool value = has_nothrow_move_assign<T, is_assignable<T&, T&&>::value>::value;
+};
+// end workaround
+
+
+# endif
+
+
+// workaround: std utility functions aren't constexpr yet
+template <class T> inline constexpr T&& constexpr_forward(typename std::remove_reference<T>::type& t) noexcept
+{
+  return static_cast<T&&>(t);
+}
+
+template <class T> inline constexpr T&& constexpr_forward(typename std::remove_reference<T>::type&& t) noexcept
+{
+    static_assert(!std::is_lvalue_reference<T>::value, "!!");
+    return static_cast<T&&>(t);
+}
+
+template <class T> inline constexpr typename std::remove_reference<T>::type&& constexpr_move(T&& t) noexcept
+{
+    return static_cast<typename std::remove_reference<T>::type&&>(t);
+}
+
+
+#if defined NDEBUG
+# define TR2_OPTIONAL_ASSERTED_EXPRESSION(CHECK, EXPR) (EXPR)
+#else
+# define TR2_OPTIONAL_ASSERTED_EXPRESSION(CHECK, EXPR) ((CHECK) ? (EXPR) : ([]{assert(!#CHECK);}(), (EXPR)))
+#endif
+
+
+namespace detail_
+{
+
+// static_addressof: a constexpr version of addressof
+template <typename T>
+struct has_overloaded_addressof
+{
+  template <class X>
+  constexpr static bool has_overload(...) { return false; }
+  
+  template <class X, size_t S = sizeof(std::declval<X&>().operator&()) >
+  constexpr static bool has_overload(bool) { return true; }
+
+  constexpr static bool value = has_overload<T>(true);
+};
+
+template <typename T, TR2_OPTIONAL_REQUIRES(!has_overloaded_addressof<T>)>
+constexpr T* static_addressof(T& ref)
+{
+  return &ref;
+}
+
+template <typename T, TR2_OPTIONAL_REQUIRES(has_overloaded_addressof<T>)>
+T* static_addressof(T& ref)
+{
+  return std::addressof(ref);
+}
+
+
+// the call to convert<A>(b) has return type A and converts b to type A iff b decltype(b) is implicitly convertible to A  
+template <class U>
+constexpr U convert(U v) { return v; }
+  
+
+namespace swap_ns
+{
+  using std::swap;
+    
+  template <class T>
+  void adl_swap(T& t, T& u) noexcept(noexcept(swap(t, u)))
+  {
+    swap(t, u);
+  }
+
+} // namespace swap_ns
+
+
+// uses-allocator construction of a T at p: a is passed to T's constructor, leading
+// (allocator_arg_t) or trailing, if T uses allocators of type Alloc, and dropped otherwise
+template <class T, class Alloc, class... Args>
+struct uses_allocator_convention : integral_constant<int,
+  !uses_allocator<T, Alloc>::value ? 0 :
+  is_constructible<T, allocator_arg_t, const Alloc&, Args&&...>::value ? 1 : 2> {};
+
+template <class T, class Alloc, class... Args>
+void uses_allocator_construct(integral_constant<int, 0>, T* p, const Alloc&, Args&&... args)
+{
+  ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+}
+
+template <class T, class Alloc, class... Args>
+void uses_allocator_construct(integral_constant<int, 1>, T* p, const Alloc& a, Args&&... args)
+{
+  ::new (static_cast<void*>(p)) T(allocator_arg, a, std::forward<Args>(args)...);
+}
+
+template <class T, class Alloc, class... Args>
+void uses_allocator_construct(integral_constant<int, 2>, T* p, const Alloc& a, Args&&... args)
+{
+  ::new (static_cast<void*>(p)) T(std::forward<Args>(args)..., a);
+}
+
+# if defined OPTIONAL_INSTRUMENT
+// what constructing or assigning a T from Args counts as
+template <class T, class... Args>
+struct construction_event : integral_constant<int, optional_emplaced> {};
+
+template <class T, class U>
+struct construction_event<T, U> : integral_constant<int,
+  !is_same<typename decay<U>::type, typename remove_const<T>::type>::value ? optional_emplaced :
+  is_lvalue_reference<U>::value || is_const<typename remove_reference<U>::type>::value ? optional_copied :
+  optional_moved> {};
+# endif
+
+} // namespace detail
+
+
+constexpr struct trivial_init_t{} trivial_init{};
+
+
+// Checked access policies: what value() does on a disengaged optional. `checks` is false
+// when value() does not test at all; otherwise a failed test calls the [[noreturn]] fail(),
+// which hands over to one cold, non-inlined function, so that each call site of value()
+// carries only a compare and a call.
+namespace detail_
+{
+
+[[noreturn]] OPTIONAL_COLD_PATH inline void terminate_bad_optional_access() noexcept
+{
+  std::terminate();
+}
+
+[[noreturn]] OPTIONAL_COLD_PATH inline void trap_bad_optional_access() noexcept
+{
+# if defined __GNUC__
+  __builtin_trap();
+# else
+  std::abort();
+# endif
+}
+
+[[noreturn]] OPTIONAL_COLD_PATH inline void assert_bad_optional_access() noexcept
+{
+  assert(!"value() called on a disengaged optional");
+  std::abort();
+}
+
+# if OPTIONAL_HAS_EXCEPTIONS
+// throws bad_optional_access. Defined in optional_bad_access.hpp, so that this header does not
+// need <stdexcept>: a program calling value() under the throwing policy includes that header,
+// or optional.hpp, in at least one of its translation units
+[[noreturn]] void throw_bad_optional_access();
+# endif
+
+} // namespace detail_
+
+// throws bad_optional_access; terminates in builds without exceptions
+struct optional_check_throw
+{
+  constexpr static bool checks = true;
+# if OPTIONAL_HAS_EXCEPTIONS
+  [[noreturn]] static void fail() { detail_::throw_bad_optional_access(); }
+# else
+  [[noreturn]] static void fail() noexcept { detail_::terminate_bad_optional_access(); }
+# endif
+};
+
+struct optional_check_terminate
+{
+  constexpr static bool checks = true;
+  [[noreturn]] static void fail() noexcept { detail_::terminate_bad_optional_access(); }
+};
+
+// a single trap instruction
+struct optional_check_trap
+{
+  constexpr static bool checks = true;
+  [[noreturn]] static void fail() noexcept { detail_::trap_bad_optional_access(); }
+};
+
+// checks in debug builds only, like operator*
+struct optional_check_assert
+{
+# if defined NDEBUG
+  constexpr static bool checks = false;
+# else
+  constexpr static bool checks = true;
+# endif
+  [[noreturn]] static void fail() noexcept { detail_::assert_bad_optional_access(); }
+};
+
+// value() behaves as operator*
+struct optional_check_unchecked
+{
+  constexpr static bool checks = false;
+  static void fail() noexcept {}
+};
+
+# if !defined OPTIONAL_CHECK_POLICY
+#   define OPTIONAL_CHECK_POLICY optional_check_throw
+# endif
+
+// the policy of optional<T> and optional<T&>; specialize it for a T to override OPTIONAL_CHECK_POLICY
+template <class T>
+struct optional_check_policy { typedef OPTIONAL_CHECK_POLICY type; };
+
+
+# if OPTIONAL_HAS_USDT
+namespace detail_
+{
+
+inline unsigned long long fnv1a(const char* s) noexcept
+{
+  unsigned long long h = 14695981039346656037ull;
+  for (; *s; ++s) h = (h ^ static_cast<unsigned char>(*s)) * 1099511628211ull;
+  return h;
+}
+
+// what the probes report about T
+template <class T>
+struct probe_type
+{
+  static const char* name() noexcept { return optional_type_name<T>().c_str(); }
+
+  static unsigned long long hash() noexcept
+  {
+    static const unsigned long long h = fnv1a(name());
+    return h;
+  }
+};
+
+} // namespace detail_
+# endif
+
+
+template <class T>
+union storage_t
+{
+  unsigned char dummy_;
+  T value_;
+
+  constexpr storage_t( trivial_init_t ) noexcept : dummy_() {};
+
+  template <class... Args>
+  constexpr storage_t( Args&&... args ) : value_(constexpr_forward<Args>(args)...) {}
+
+  ~storage_t(){}
+};
+
+
+template <class T>
+union constexpr_storage_t
+{
+    unsigned char dummy_;
+    T value_;
+
+    constexpr constexpr_storage_t( trivial_init_t ) noexcept : dummy_() {};
+
+    template <class... Args>
+    constexpr constexpr_storage_t( Args&&... args ) : value_(constexpr_forward<Args>(args)...) {}
+
+    ~constexpr_storage_t() = default;
+};
+
+
+template <class T>
+struct optional_base
+{
+    bool init_;
+    storage_t<T> storage_;
+
+    constexpr optional_base() noexcept : init_(false), storage_(trivial_init) {};
+
+    explicit constexpr optional_base(const T& v) : init_(true), storage_(v) {}
+
+    explicit constexpr optional_base(T&& v) : init_(true), storage_(constexpr_move(v)) {}
+
+    template <class... Args> explicit optional_base(in_place_t, Args&&... args)
+        : init_(true), storage_(constexpr_forward<Args>(args)...) {}
+
+    template <class U, class... Args, TR2_OPTIONAL_REQUIRES(is_constructible<T, std::initializer_list<U>>)>
+    explicit optional_base(in_place_t, std::initializer_list<U> il, Args&&... args)
+        : init_(true), storage_(il, std::forward<Args>(args)...) {}
+
+    ~optional_base() { if (init_) storage_.value_.T::~T(); }
+};
+
+
+template <class T>
+struct constexpr_optional_base
+{
+    bool init_;
+    constexpr_storage_t<T> storage_;
+
+    constexpr constexpr_optional_base() noexcept : init_(false), storage_(trivial_init) {};
+
+    explicit constexpr constexpr_optional_base(const T& v) : init_(true), storage_(v) {}
+
+    explicit constexpr constexpr_optional_base(T&& v) : init_(true), storage_(constexpr_move(v)) {}
+
+    template <class... Args> explicit constexpr constexpr_optional_base(in_place_t, Args&&... args)
+      : init_(true), storage_(constexpr_forward<Args>(args)...) {}
+
+    template <class U, class... Args, TR2_OPTIONAL_REQUIRES(is_constructible<T, std::initializer_list<U>>)>
+    OPTIONAL_CONSTEXPR_INIT_LIST explicit constexpr_optional_base(in_place_t, std::initializer_list<U> il, Args&&... args)
+      : init_(true), storage_(il, std::forward<Args>(args)...) {}
+
+    ~constexpr_optional_base() = default;
+};
+
+template <class T>
+using OptionalBase = typename std::conditional<
+    is_trivially_destructible<T>::value,                          // if possible
+    constexpr_optional_base<typename std::remove_const<T>::type>, // use base with trivial destructor
+    optional_base<typename std::remove_const<T>::type>
+>::type;
+
+
+# if OPTIONAL_HAS_COROUTINES
+namespace detail_
+{
+template <class T> class optional_coroutine_result; // defined in optional_coroutine.hpp
+} // namespace detail_
+# endif
+
+
+template <class T>
+class optional : private OptionalBase<T>
+{
+  static_assert( !std::is_same<typename std::decay<T>::type, nullopt_t>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, in_place_t>::value, "bad T" );
+  
+  typedef typename optional_check_policy<T>::type check_policy;
+
+  constexpr bool initialized() const noexcept { return OptionalBase<T>::init_; }
+  constexpr bool accessible() const noexcept { return !check_policy::checks || initialized(); }
+  void failed_access() const
+  {
+    OPTIONAL_PROBE(value_failure, T);
+    OPTIONAL_COUNT(T, detail_::optional_failed_access);
+    check_policy::fail();
+  }
+  typename std::remove_const<T>::type* dataptr() {  return std::addressof(OptionalBase<T>::storage_.value_); }
+  constexpr const T* dataptr() const { return detail_::static_addressof(OptionalBase<T>::storage_.value_); }
+  
+# if OPTIONAL_HAS_THIS_RVALUE_REFS == 1
+  constexpr const T& contained_val() const& { return OptionalBase<T>::storage_.value_; }
+#   if OPTIONAL_HAS_MOVE_ACCESSORS == 1
+  OPTIONAL_MUTABLE_CONSTEXPR T&& contained_val() && { return std::move(OptionalBase<T>::storage_.value_); }
+  OPTIONAL_MUTABLE_CONSTEXPR T& contained_val() & { return OptionalBase<T>::storage_.value_; }
+#   else
+  T& contained_val() & { return OptionalBase<T>::storage_.value_; }
+  T&& contained_val() && { return std::move(OptionalBase<T>::storage_.value_); }
+#   endif
+# else
+  constexpr const T& contained_val() const { return OptionalBase<T>::storage_.value_; }
+  T& contained_val() { return OptionalBase<T>::storage_.value_; }
+# endif
+
+  void clear() noexcept {
+    if (initialized()) { OPTIONAL_COUNT(T, detail_::optional_reset); dataptr()->T::~T(); }
+    OptionalBase<T>::init_ = false;
+  }
+  
+  template <class... Args>
+  void initialize(Args&&... args) noexcept(noexcept(T(std::forward<Args>(args)...)))
+  {
+    assert(!OptionalBase<T>::init_);
+    OPTIONAL_COUNT(T, (detail_::construction_event<T, Args...>::value));
+    ::new (static_cast<void*>(dataptr())) T(std::forward<Args>(args)...);
+    OptionalBase<T>::init_ = true;
+  }
+
+  template <class U, class... Args>
+  void initialize(std::initializer_list<U> il, Args&&... args) noexcept(noexcept(T(il, std::forward<Args>(args)...)))
+  {
+    assert(!OptionalBase<T>::init_);
+    OPTIONAL_COUNT(T, detail_::optional_emplaced);
+    ::new (static_cast<void*>(dataptr())) T(il, std::forward<Args>(args)...);
+    OptionalBase<T>::init_ = true;
+  }
+
+  // uses-allocator construction, reached only from the allocator-extended constructors: a
+  // leading allocator_arg elsewhere (emplace, in_place) is an argument for T's own constructor
+  struct uses_allocator_tag {};
+
+  template <class Alloc, class... Args>
+  void initialize(uses_allocator_tag, const Alloc& a, Args&&... args)
+  {
+    assert(!OptionalBase<T>::init_);
+    typedef detail_::uses_allocator_convention<typename std::remove_const<T>::type, Alloc, Args...> convention;
+    OPTIONAL_COUNT(T, (detail_::construction_event<T, Args...>::value));
+    detail_::uses_allocator_construct(convention(), dataptr(), a, std::forward<Args>(args)...);
+    OptionalBase<T>::init_ = true;
+  }
+
+public:
+  typedef T value_type;
+
+  // 20.5.5.1, constructors
+  constexpr optional() noexcept : OptionalBase<T>()  {};
+  constexpr optional(nullopt_t) noexcept : OptionalBase<T>() {};
+
+  optional(const optional& rhs)
+  : OptionalBase<T>()
+  {
+    if (rhs.initialized()) {
+        OPTIONAL_COUNT(T, detail_::optional_copied);
+        ::new (static_cast<void*>(dataptr())) T(*rhs);
+        OptionalBase<T>::init_ = true;
+    }
+  }
+
+  optional(optional&& rhs) noexcept(is_nothrow_move_constructible<T>::value)
+  : OptionalBase<T>()
+  {
+    if (rhs.initialized()) {
+        OPTIONAL_COUNT(T, detail_::optional_moved);
+        ::new (static_cast<void*>(dataptr())) T(std::move(*rhs));
+        OptionalBase<T>::init_ = true;
+    }
+  }
+
+  constexpr optional(const T& v) : OptionalBase<T>((OPTIONAL_COUNT(T, detail_::optional_copied), v)) {}
+
+  constexpr optional(T&& v) : OptionalBase<T>((OPTIONAL_COUNT(T, detail_::optional_moved), constexpr_move(v))) {}
+
+# if OPTIONAL_HAS_COROUTINES
+  // the return object of an optional coroutine (optional_coroutine.hpp) becomes an optional by
+  // handing its result over and learning where later results go
+  optional(detail_::optional_coroutine_result<T>&& r) : OptionalBase<T>() { r.bind(*this); }
+# endif
+
+  template <class... Args>
+  explicit constexpr optional(in_place_t, Args&&... args)
+  : OptionalBase<T>((OPTIONAL_COUNT(T, detail_::optional_emplaced), in_place_t{}), constexpr_forward<Args>(args)...) {}
+
+  template <class U, class... Args, TR2_OPTIONAL_REQUIRES(is_constructible<T, std::initializer_list<U>>)>
+  OPTIONAL_CONSTEXPR_INIT_LIST explicit optional(in_place_t, std::initializer_list<U> il, Args&&... args)
+  : OptionalBase<T>((OPTIONAL_COUNT(T, detail_::optional_emplaced), in_place_t{}), il, constexpr_forward<Args>(args)...) {}
+
+  // allocator-extended constructors: the contained value, if any, is built by uses-allocator
+  // construction with a, so that containers with scoped allocators pass theirs on to it
+  template <class Alloc>
+  optional(allocator_arg_t, const Alloc&) noexcept : OptionalBase<T>() {}
+
+  template <class Alloc>
+  optional(allocator_arg_t, const Alloc&, nullopt_t) noexcept : OptionalBase<T>() {}
+
+  template <class Alloc>
+  optional(allocator_arg_t, const Alloc& a, const optional& rhs)
+  : OptionalBase<T>()
+  {
+    if (rhs.initialized()) initialize(uses_allocator_tag(), a, *rhs);
+  }
+
+  template <class Alloc>
+  optional(allocator_arg_t, const Alloc& a, optional&& rhs)
+  : OptionalBase<T>()
+  {
+    if (rhs.initialized()) initialize(uses_allocator_tag(), a, std::move(*rhs));
+  }
+
+  template <class Alloc>
+  optional(allocator_arg_t, const Alloc& a, const T& v)
+  : OptionalBase<T>()
+  {
+    initialize(uses_allocator_tag(), a, v);
+  }
+
+  template <class Alloc>
+  optional(allocator_arg_t, const Alloc& a, T&& v)
+  : OptionalBase<T>()
+  {
+    initialize(uses_allocator_tag(), a, std::move(v));
+  }
+
+  template <class Alloc, class... Args>
+  optional(allocator_arg_t, const Alloc& a, in_place_t, Args&&... args)
+  : OptionalBase<T>()
+  {
+    initialize(uses_allocator_tag(), a, std::forward<Args>(args)...);
+  }
+
+  // 20.5.4.2, Destructor
+  ~optional() = default;
+
+  // 20.5.4.3, assignment
+  optional& operator=(nullopt_t) noexcept
+  {
+    if (initialized()) OPTIONAL_PROBE(disengage, T);
+    clear();
+    return *this;
+  }
+  
+  optional& operator=(const optional& rhs)
+  {
+    if      (initialized() == true  && rhs.initialized() == false) { OPTIONAL_PROBE(disengage, T); clear(); }
+    else if (initialized() == false && rhs.initialized() == true)  initialize(*rhs);
+    else if (initialized() == true  && rhs.initialized() == true)  { OPTIONAL_COUNT(T, detail_::optional_copied); contained_val() = *rhs; }
+    return *this;
+  }
+  
+  optional& operator=(optional&& rhs)
+  noexcept(is_nothrow_move_assignable<T>::value && is_nothrow_move_constructible<T>::value)
+  {
+    if      (initialized() == true  && rhs.initialized() == false) { OPTIONAL_PROBE(disengage, T); clear(); }
+    else if (initialized() == false && rhs.initialized() == true)  initialize(std::move(*rhs));
+    else if (initialized() == true  && rhs.initialized() == true)  { OPTIONAL_COUNT(T, detail_::optional_moved); contained_val() = std::move(*rhs); }
+    return *this;
+  }
+
+  template <class U>
+  auto operator=(U&& v)
+  -> typename enable_if
+  <
+    is_same<typename decay<U>::type, T>::value,
+    optional&
+  >::type
+  {
+    if (initialized()) { OPTIONAL_COUNT(T, (detail_::construction_event<T, U>::value)); contained_val() = std::forward<U>(v); }
+    else               { initialize(std::forward<U>(v));  }
+    return *this;
+  }
+  
+  
+  template <class... Args>
+  void emplace(Args&&... args)
+  {
+    OPTIONAL_PROBE(emplace, T);
+    clear();
+    initialize(std::forward<Args>(args)...);
+  }
+  
+  template <class U, class... Args>
+  void emplace(initializer_list<U> il, Args&&... args)
+  {
+    OPTIONAL_PROBE(emplace, T);
+    clear();
+    initialize<U, Args...>(il, std::forward<Args>(args)...);
+  }
+  
+  // 20.5.4.4, Swap
+  void swap(optional<T>& rhs) noexcept(is_nothrow_move_constructible<T>::value
+                                       && noexcept(detail_::swap_ns::adl_swap(declval<T&>(), declval<T&>())))
+  {
+    if      (initialized() == true  && rhs.initialized() == false) { rhs.initialize(std::move(**this)); clear(); }
+    else if (initialized() == false && rhs.initialized() == true)  { initialize(std::move(*rhs)); rhs.clear(); }
+    else if (initialized() == true  && rhs.initialized() == true)  {
+      OPTIONAL_COUNT(T, detail_::optional_swapped);
+      using std::swap;
+      swap(**this, *rhs);
+    }
+  }
+
+  // 20.5.4.5, Observers
+  
+  explicit constexpr operator bool() const noexcept { return initialized(); }
+  constexpr bool has_value() const noexcept { return initialized(); }
+  
+  constexpr T const* operator ->() const {
+    return TR2_OPTIONAL_ASSERTED_EXPRESSION(initialized(), dataptr());
+  }
+  
+# if OPTIONAL_HAS_MOVE_ACCESSORS == 1
+
+  OPTIONAL_MUTABLE_CONSTEXPR T* operator ->() {
+    assert (initialized());
+    return dataptr();
+  }
+  
+  constexpr T const& operator *() const& {
+    return TR2_OPTIONAL_ASSERTED_EXPRESSION(initialized(), contained_val());
+  }
+  
+  OPTIONAL_MUTABLE_CONSTEXPR T& operator *() & {
+    assert (initialized());
+    return contained_val();
+  }
+  
+  OPTIONAL_MUTABLE_CONSTEXPR T&& operator *() && {
+    assert (initialized());
+    return constexpr_move(contained_val());
+  }
+
+  constexpr T const& value() const& {
+    return accessible() ? contained_val() : (failed_access(), contained_val());
+  }
+  
+  OPTIONAL_MUTABLE_CONSTEXPR T& value() & {
+    return accessible() ? contained_val() : (failed_access(), contained_val());
+  }
+  
+  OPTIONAL_MUTABLE_CONSTEXPR T&& value() && {
+    if (!accessible()) failed_access();
+    return std::move(contained_val());
+  }
+  
+# else
+
+  T* operator ->() {
+    assert (initialized());
+    return dataptr();
+  }
+  
+  constexpr T const& operator *() const {
+    return TR2_OPTIONAL_ASSERTED_EXPRESSION(initialized(), contained_val());
+  }
+  
+  T& operator *() {
+    assert (initialized());
+    return contained_val();
+  }
+  
+  constexpr T const& value() const {
+    return accessible() ? contained_val() : (failed_access(), contained_val());
+  }
+  
+  T& value() {
+    return accessible() ? contained_val() : (failed_access(), contained_val());
+  }
+  
+# endif
+  
+# if OPTIONAL_HAS_THIS_RVALUE_REFS == 1
+
+  template <class V>
+  constexpr T value_or(V&& v) const&
+  {
+    return *this ? (OPTIONAL_COUNT(T, detail_::optional_copied), **this) : detail_::convert<T>(constexpr_forward<V>(v));
+  }
+  
+#   if OPTIONAL_HAS_MOVE_ACCESSORS == 1
+
+  template <class V>
+  OPTIONAL_MUTABLE_CONSTEXPR T value_or(V&& v) &&
+  {
+    return *this ? (OPTIONAL_COUNT(T, detail_::optional_moved), constexpr_move(const_cast<optional<T>&>(*this).contained_val())) : detail_::convert<T>(constexpr_forward<V>(v));
+  }
+
+#   else
+ 
+  template <class V>
+  T value_or(V&& v) &&
+  {
+    return *this ? (OPTIONAL_COUNT(T, detail_::optional_moved), constexpr_move(const_cast<optional<T>&>(*this).contained_val())) : detail_::convert<T>(constexpr_forward<V>(v));
+  }
+  
+#   endif
+  
+# else
+  
+  template <class V>
+  constexpr T value_or(V&& v) const
+  {
+    return *this ? (OPTIONAL_COUNT(T, detail_::optional_copied), **this) : detail_::convert<T>(constexpr_forward<V>(v));
+  }
+
+# endif
+
+  // 20.6.3.6, modifiers
+  void reset() noexcept { OPTIONAL_PROBE(reset, T); clear(); }
+};
+
+
+template <class T>
+class optional<T&>
+{
+  static_assert( !std::is_same<T, nullopt_t>::value, "bad T" );
+  static_assert( !std::is_same<T, in_place_t>::value, "bad T" );
+  T* ref;
+
+  typedef typename optional_check_policy<T&>::type check_policy;
+
+  void failed_access() const { OPTIONAL_PROBE(value_failure, T&); check_policy::fail(); }
+  
+public:
+
+  // 20.5.5.1, construction/destruction
+  constexpr optional() noexcept : ref(nullptr) {}
+  
+  constexpr optional(nullopt_t) noexcept : ref(nullptr) {}
+   
+  constexpr optional(T& v) noexcept : ref(detail_::static_addressof(v)) {}
+  
+  optional(T&&) = delete;
+  
+  constexpr optional(const optional& rhs) noexcept : ref(rhs.ref) {}
+  
+  explicit constexpr optional(in_place_t, T& v) noexcept : ref(detail_::static_addressof(v)) {}
+  
+  explicit optional(in_place_t, T&&) = delete;
+  
+  ~optional() = default;
+  
+  // 20.5.5.2, mutation
+  optional& operator=(nullopt_t) noexcept {
+    if (ref) OPTIONAL_PROBE(disengage, T&);
+    ref = nullptr;
+    return *this;
+  }
+  
+  // optional& operator=(const optional& rhs) noexcept {
+    // ref = rhs.ref;
+    // return *this;
+  // }
+  
+  // optional& operator=(optional&& rhs) noexcept {
+    // ref = rhs.ref;
+    // return *this;
+  // }
+  
+  template <typename U>
+  auto operator=(U&& rhs) noexcept
+  -> typename enable_if
+  <
+    is_same<typename decay<U>::type, optional<T&>>::value,
+    optional&
+  >::type
+  {
+    ref = rhs.ref;
+    return *this;
+  }
+  
+  template <typename U>
+  auto operator=(U&& rhs) noexcept
+  -> typename enable_if
+  <
+    !is_same<typename decay<U>::type, optional<T&>>::value,
+    optional&
+  >::type
+  = delete;
+  
+  void emplace(T& v) noexcept {
+    OPTIONAL_PROBE(emplace, T&);
+    ref = detail_::static_addressof(v);
+  }
+  
+  void emplace(T&&) = delete;
+  
+  
+  void swap(optional<T&>& rhs) noexcept
+  {
+    std::swap(ref, rhs.ref);
+  }
+    
+  // 20.5.5.3, observers
+  constexpr T* operator->() const {
+    return TR2_OPTIONAL_ASSERTED_EXPRESSION(ref, ref);
+  }
+  
+  constexpr T& operator*() const {
+    return TR2_OPTIONAL_ASSERTED_EXPRESSION(ref, *ref);
+  }
+  
+  constexpr T& value() const {
+    return (!check_policy::checks || ref) ? *ref : (failed_access(), *ref);
+  }
+  
+  explicit constexpr operator bool() const noexcept {
+    return ref != nullptr;
+  }
+ 
+  constexpr bool has_value() const noexcept {
+    return ref != nullptr;
+  }
+  
+  template <class V>
+  constexpr typename decay<T>::type value_or(V&& v) const
+  {
+    return *this ? **this : detail_::convert<typename decay<T>::type>(constexpr_forward<V>(v));
+  }
+
+  // x.x.x.x, modifiers
+  void reset() noexcept { OPTIONAL_PROBE(reset, T&); ref = nullptr; }
+};
+
+
+template <class T>
+class optional<T&&>
+{
+  static_assert( sizeof(T) == 0, "optional rvalue references disallowed" );
+};
+
+
+
+// 20.5.12, Specialized algorithms
+template <class T>
+void swap(optional<T>& x, optional<T>& y) noexcept(noexcept(x.swap(y)))
+{
+  x.swap(y);
+}
+
+
+template <class T>
+constexpr optional<typename decay<T>::type> make_optional(T&& v)
+{
+  return optional<typename decay<T>::type>(constexpr_forward<T>(v));
+}
+
+template <class X>
+constexpr optional<X&> make_optional(reference_wrapper<X> v)
+{
+  return optional<X&>(v.get());
+}
+
+
+} // namespace experimental
+} // namespace std
+
+namespace std
+{
+  // optional<T> takes an allocator wherever T does
+  template <typename T, typename Alloc>
+  struct uses_allocator<std::experimental::optional<T>, Alloc> : uses_allocator<T, Alloc> {};
+}
+
+# undef TR2_OPTIONAL_REQUIRES
+# undef TR2_OPTIONAL_ASSERTED_EXPRESSION
+
+# endif //___OPTIONAL_CORE_HPP___
@@ -0,0 +1,183 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_COROUTINE_HPP___
+# define ___OPTIONAL_COROUTINE_HPP___
+
+# include "optional.hpp"
+
+// In C++20 a function returning optional<T> may be a coroutine: `co_await o` yields *o
+// if o is engaged and otherwise makes the function return nullopt at once; `co_return v`
+// returns v. Before C++20 (OPTIONAL_HAS_COROUTINES, see optional_core.hpp) this header
+// adds nothing.
+# if OPTIONAL_HAS_COROUTINES
+
+# include <coroutine>
+# include <cstddef>
+# include <cstdint>
+# include <new>
+
+# if !defined OPTIONAL_COROUTINE_ARENA_SIZE
+#   define OPTIONAL_COROUTINE_ARENA_SIZE 8192
+# endif
+
+namespace std{
+
+namespace experimental{
+
+namespace detail_
+{
+
+// Per-thread stack of coroutine frames. An optional coroutine runs to completion (or to
+// its first failed co_await) before its caller continues, so frames are always freed in
+// the reverse order of their allocation. Frames that do not fit go to operator new.
+class coroutine_arena
+{
+  constexpr static size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+  alignas(align) unsigned char buf_[OPTIONAL_COROUTINE_ARENA_SIZE];
+  size_t top_ = 0;
+
+  bool owns(void* p) const noexcept
+  {
+    uintptr_t a = reinterpret_cast<uintptr_t>(p), b = reinterpret_cast<uintptr_t>(buf_);
+    return a >= b && a < b + sizeof(buf_);
+  }
+
+public:
+  static coroutine_arena& local() noexcept
+  {
+    static thread_local coroutine_arena a;
+    return a;
+  }
+
+  void* allocate(size_t n)
+  {
+    n = (n + align - 1) & ~(align - 1);
+    if (sizeof(buf_) - top_ < n)
+      return ::operator new(n);
+    void* p = buf_ + top_;
+    top_ += n;
+    return p;
+  }
+
+  void deallocate(void* p) noexcept
+  {
+    if (owns(p)) top_ = static_cast<unsigned char*>(p) - buf_;
+    else ::operator delete(p);
+  }
+
+  size_t used() const noexcept { return top_; }
+};
+
+template <class T> class optional_promise;
+
+// What optional_promise<T>::get_return_object() hands to the compiler, which converts it to
+// the optional<T> returned either at once (eagerly, as MSVC does) or when the coroutine first
+// returns to its caller (as GCC and Clang do). Until the conversion the result is written into
+// value_; an eager conversion points out_ at the optional<T> it constructs, a late one takes
+// value_ after the promise is gone.
+template <class T>
+class optional_coroutine_result
+{
+  optional<T> value_;
+  optional_promise<T>* promise_;
+
+  explicit optional_coroutine_result(optional_promise<T>& p) noexcept : promise_(&p) { p.out_ = &value_; p.result_ = this; }
+
+  // called by the converting constructor of optional<T>
+  void bind(optional<T>& o)
+  {
+    if (value_) o.emplace(std::move(*value_));
+    if (promise_) promise_->out_ = &o;
+  }
+
+  friend class optional_promise<T>;
+  friend class optional<T>;
+
+public:
+  optional_coroutine_result(const optional_coroutine_result&) = delete;
+  optional_coroutine_result& operator=(const optional_coroutine_result&) = delete;
+  ~optional_coroutine_result() { if (promise_) promise_->result_ = nullptr; }
+};
+
+template <class T>
+class optional_promise
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+
+  optional<T>* out_ = nullptr;                   // where co_return writes
+  optional_coroutine_result<T>* result_ = nullptr; // the return object, while both it and the promise live
+
+  friend class optional_coroutine_result<T>;
+
+  template <class O> // a reference to optional
+  struct awaiter
+  {
+    typename std::remove_reference<O>::type& o;
+
+    bool await_ready() const noexcept { return bool(o); }
+
+    // disengaged: the result is still nullopt, so abandon the coroutine
+    void await_suspend(std::coroutine_handle<> h) const noexcept { h.destroy(); }
+
+    decltype(auto) await_resume() const
+    {
+      if constexpr (std::is_lvalue_reference<O>::value)
+        return *o;
+      else // by value: the operand may be a temporary
+        return typename std::remove_reference<O>::type::value_type(std::move(*o));
+    }
+  };
+
+public:
+  optional_promise() = default;
+  optional_promise(const optional_promise&) = delete;
+  ~optional_promise() { if (result_) result_->promise_ = nullptr; }
+
+  optional_coroutine_result<T> get_return_object() noexcept { return optional_coroutine_result<T>(*this); }
+
+  std::suspend_never initial_suspend() const noexcept { return {}; }
+  std::suspend_never final_suspend() const noexcept { return {}; }
+
+  void return_value(nullopt_t) noexcept {}
+  void return_value(const optional<T>& v) { *out_ = v; }
+  void return_value(optional<T>&& v) { *out_ = std::move(v); }
+
+  template <class U = T>
+  typename enable_if<is_constructible<T, U&&>::value>::type return_value(U&& v) { out_->emplace(std::forward<U>(v)); }
+
+  void unhandled_exception() { throw; }
+
+  // only optionals can be awaited in an optional coroutine
+  template <class U>
+  awaiter<optional<U>&> await_transform(optional<U>& o) const noexcept { return {o}; }
+
+  template <class U>
+  awaiter<const optional<U>&> await_transform(const optional<U>& o) const noexcept { return {o}; }
+
+  template <class U>
+  awaiter<optional<U>&&> await_transform(optional<U>&& o) const noexcept { return {o}; }
+
+  static void* operator new(size_t n) { return coroutine_arena::local().allocate(n); }
+  static void operator delete(void* p) noexcept { coroutine_arena::local().deallocate(p); }
+};
+
+} // namespace detail_
+
+} // namespace experimental
+
+template <class T, class... Args>
+struct coroutine_traits<experimental::optional<T>, Args...>
+{
+  typedef experimental::detail_::optional_promise<T> promise_type;
+};
+
+} // namespace std
+
+# endif // OPTIONAL_HAS_COROUTINES
+
+# endif //___OPTIONAL_COROUTINE_HPP___
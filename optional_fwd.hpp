@@ -0,0 +1,45 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_FWD_HPP___
+# define ___OPTIONAL_FWD_HPP___
+
+// Declarations only, for headers that name optional in signatures and members held by
+// pointer or reference; includes no standard headers. nullopt and in_place are defined
+// here, so that passing them needs nothing more.
+
+namespace std{
+
+namespace experimental{
+
+// 20.5.4, optional for object types
+template <class T> class optional;
+
+// 20.5.5, optional for lvalue reference types
+template <class T> class optional<T&>;
+
+
+// 20.5.6, In-place construction
+constexpr struct in_place_t{} in_place{};
+
+
+// 20.5.7, Disengaged state indicator
+struct nullopt_t
+{
+  struct init{};
+  constexpr explicit nullopt_t(init){}
+};
+constexpr nullopt_t nullopt{nullopt_t::init()};
+
+
+// 20.5.8, class bad_optional_access
+class bad_optional_access;
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_FWD_HPP___
@@ -0,0 +1,281 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_GENERATOR_HPP___
+# define ___OPTIONAL_GENERATOR_HPP___
+
+# include "optional.hpp"
+# include "optional_coroutine.hpp"
+# include <iterator>
+
+# if OPTIONAL_HAS_COROUTINES
+#   include <exception>
+# endif
+
+namespace std{
+
+namespace experimental{
+
+// Pull-based generators that write each element into an optional<T> owned by the caller.
+// A generator G provides `bool next(optional<T>& out)`: it returns true with the next element
+// in out, or false with out disengaged at the end. When out is already engaged the element is
+// assigned to *out, so a loop over one buffer reuses its storage instead of destroying and
+// constructing an element per step.
+
+namespace detail_
+{
+
+// assigns to an engaged optional if T can be assigned from v, constructs into it otherwise
+template <class T, class U>
+void assign_or_emplace(optional<T>& out, U&& v, true_type)
+{
+  if (out) *out = std::forward<U>(v);
+  else     out.emplace(std::forward<U>(v));
+}
+
+template <class T, class U>
+void assign_or_emplace(optional<T>& out, U&& v, false_type)
+{
+  out.reset();
+  out.emplace(std::forward<U>(v));
+}
+
+template <class T, class U>
+void assign_or_emplace(optional<T>& out, U&& v)
+{
+  assign_or_emplace(out, std::forward<U>(v), is_assignable<T&, U&&>());
+}
+
+} // namespace detail_
+
+
+// range adaptor over a generator and a buffer, for range-for:
+//   for (const Record& r : generator_range(gen, buf)) ...
+template <class G, class T>
+class optional_generator_range
+{
+  G* gen_;
+  optional<T>* buf_;
+
+public:
+  class iterator
+  {
+    G* gen_;
+    optional<T>* buf_;
+
+    bool done() const noexcept { return !gen_ || !*buf_; }
+
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T* pointer;
+    typedef T& reference;
+
+    iterator() noexcept : gen_(nullptr), buf_(nullptr) {}
+    iterator(G* g, optional<T>* buf) noexcept : gen_(g), buf_(buf) {}
+
+    T& operator*() const { return **buf_; }
+    T* operator->() const { return buf_->operator->(); }
+
+    iterator& operator++() { gen_->next(*buf_); return *this; }
+    void operator++(int) { ++*this; }
+
+    // only the end of the range is distinguished
+    friend bool operator==(const iterator& x, const iterator& y) noexcept { return x.done() == y.done(); }
+    friend bool operator!=(const iterator& x, const iterator& y) noexcept { return x.done() != y.done(); }
+  };
+
+  optional_generator_range(G& g, optional<T>& buf) noexcept : gen_(&g), buf_(&buf) {}
+
+  iterator begin() { gen_->next(*buf_); return iterator(gen_, buf_); }
+  iterator end() noexcept { return iterator(); }
+};
+
+template <class G, class T>
+optional_generator_range<G, T> generator_range(G& g, optional<T>& buf) noexcept
+{
+  return optional_generator_range<G, T>(g, buf);
+}
+
+
+// step_generator<T, F>: the generator for any mode. F is a callable `bool(optional<T>& out)`
+// that keeps the iteration state in its captures, puts the next element into out and returns
+// true, or returns false at the end. Nothing is allocated.
+template <class T, class F>
+class step_generator
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+
+  F step_;
+  optional<T> buf_;
+
+public:
+  typedef T value_type;
+  typedef typename optional_generator_range<step_generator, T>::iterator iterator;
+
+  explicit step_generator(F step) : step_(std::move(step)) {}
+
+  bool next(optional<T>& out)
+  {
+    if (step_(out)) return true;
+    out = nullopt;
+    return false;
+  }
+
+  // iteration through a buffer owned by the generator
+  iterator begin() { return generator_range(*this, buf_).begin(); }
+  iterator end() noexcept { return iterator(); }
+};
+
+template <class T, class F>
+step_generator<T, typename decay<F>::type> make_step_generator(F&& step)
+{
+  return step_generator<T, typename decay<F>::type>(std::forward<F>(step));
+}
+
+
+# if OPTIONAL_HAS_COROUTINES
+
+namespace detail_
+{
+
+// Per-thread cache of freed generator frames. Generator frames do not nest like those of
+// optional coroutines, so they cannot share the stack arena; instead a frame freed by a
+// finished generator is handed to the next one of no greater size, and a steady stream of
+// generators stops allocating after the first.
+class frame_cache
+{
+  constexpr static size_t slots = 4;
+  constexpr static size_t header = __STDCPP_DEFAULT_NEW_ALIGNMENT__; // holds the block size
+
+  void* free_[slots] = {};
+
+  static size_t& size_of(void* block) noexcept { return *static_cast<size_t*>(block); }
+
+public:
+  static frame_cache& local() noexcept
+  {
+    static thread_local frame_cache c;
+    return c;
+  }
+
+  ~frame_cache()
+  {
+    for (void* b : free_) ::operator delete(b);
+  }
+
+  void* allocate(size_t n)
+  {
+    for (void*& b : free_)
+      if (b && size_of(b) >= n) {
+        void* r = b;
+        b = nullptr;
+        return static_cast<unsigned char*>(r) + header;
+      }
+    void* b = ::operator new(n + header);
+    size_of(b) = n;
+    return static_cast<unsigned char*>(b) + header;
+  }
+
+  void deallocate(void* p) noexcept
+  {
+    void* b = static_cast<unsigned char*>(p) - header;
+    for (void*& f : free_)
+      if (!f) { f = b; return; }
+    ::operator delete(b);
+  }
+};
+
+} // namespace detail_
+
+
+// optional_generator<T>: a C++20 coroutine generator. `co_yield v` writes v into the buffer
+// passed to next() and suspends; falling off the end finishes the sequence.
+//
+//   optional_generator<Record> read(Stream& s) { while (...) co_yield Record(...); }
+template <class T>
+class optional_generator
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+
+public:
+  class promise_type
+  {
+    optional<T>* out_ = nullptr;
+    std::exception_ptr error_;
+
+    friend class optional_generator;
+
+  public:
+    optional_generator get_return_object() noexcept
+    {
+      return optional_generator(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    std::suspend_always final_suspend() const noexcept { return {}; }
+
+    template <class U = T>
+    typename enable_if<is_constructible<T, U&&>::value, std::suspend_always>::type yield_value(U&& v)
+    {
+      detail_::assign_or_emplace(*out_, std::forward<U>(v));
+      return {};
+    }
+
+    void return_void() const noexcept {}
+    void unhandled_exception() noexcept { error_ = std::current_exception(); }
+
+    template <class U>
+    void await_transform(U&&) = delete; // a generator cannot await
+
+    static void* operator new(size_t n) { return detail_::frame_cache::local().allocate(n); }
+    static void operator delete(void* p) noexcept { detail_::frame_cache::local().deallocate(p); }
+  };
+
+  typedef T value_type;
+  typedef typename optional_generator_range<optional_generator, T>::iterator iterator;
+
+  optional_generator(optional_generator&& rhs) noexcept : h_(rhs.h_), buf_(std::move(rhs.buf_)) { rhs.h_ = nullptr; }
+  optional_generator& operator=(optional_generator&& rhs) noexcept
+  {
+    std::swap(h_, rhs.h_);
+    buf_ = std::move(rhs.buf_);
+    return *this;
+  }
+
+  ~optional_generator() { if (h_) h_.destroy(); }
+
+  bool next(optional<T>& out)
+  {
+    if (h_ && !h_.done()) {
+      h_.promise().out_ = &out;
+      h_.resume();
+      if (h_.promise().error_)
+        std::rethrow_exception(std::exchange(h_.promise().error_, nullptr));
+      if (!h_.done()) return true;
+    }
+    out = nullopt;
+    return false;
+  }
+
+  iterator begin() { return generator_range(*this, buf_).begin(); }
+  iterator end() noexcept { return iterator(); }
+
+private:
+  std::coroutine_handle<promise_type> h_;
+  optional<T> buf_;
+
+  explicit optional_generator(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+};
+
+# endif // OPTIONAL_HAS_COROUTINES
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_GENERATOR_HPP___
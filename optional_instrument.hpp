@@ -0,0 +1,218 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_INSTRUMENT_HPP___
+# define ___OPTIONAL_INSTRUMENT_HPP___
+
+// The counters of the OPTIONAL_INSTRUMENT mode; included by optional.hpp in that mode.
+// Every optional<T> event below bumps a counter of T in the calling thread. The counters
+// of a thread are relaxed atomics that only that thread writes, so counting costs a
+// thread_local lookup and a store; the report sums them over all threads, those that
+// have exited included.
+//
+//   copies           a payload copy-constructed or copy-assigned (also by value_or)
+//   moves            a payload move-constructed or move-assigned (also by value_or, and by
+//                    swap with one optional engaged)
+//   emplaces         a payload constructed from other arguments (in_place, emplace)
+//   resets           a payload destroyed by reset(), emplace(), an assignment or swap
+//   swaps            two engaged payloads swapped; what that costs is up to the swap of T
+//   failed_accesses  value() called on a disengaged optional
+
+# include <atomic>
+# include <algorithm>
+# include <iomanip>
+# include <mutex>
+# include <ostream>
+# include <string>
+# include <vector>
+# include "optional_type_name.hpp"
+
+# if defined __has_builtin
+#   if __has_builtin(__builtin_is_constant_evaluated)
+#     define OPTIONAL_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#   endif
+# endif
+# if !defined OPTIONAL_IS_CONSTANT_EVALUATED && defined __GNUC__ && !defined __clang__ && __GNUC__ >= 9
+#   define OPTIONAL_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+# endif
+# if !defined OPTIONAL_IS_CONSTANT_EVALUATED && defined _MSC_VER && _MSC_VER >= 1925
+#   define OPTIONAL_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+# endif
+# if !defined OPTIONAL_IS_CONSTANT_EVALUATED
+#   define OPTIONAL_IS_CONSTANT_EVALUATED() false // constexpr optionals are then not usable in this mode
+# endif
+
+namespace std{
+
+namespace experimental{
+
+// the counters of one payload type
+struct optional_instrument_row
+{
+  std::string type;
+  size_t size;
+  unsigned long long copies;
+  unsigned long long moves;
+  unsigned long long emplaces;
+  unsigned long long resets;
+  unsigned long long swaps;
+  unsigned long long failed_accesses;
+};
+
+namespace detail_
+{
+
+enum optional_event { optional_copied, optional_moved, optional_emplaced, optional_reset, optional_swapped,
+                      optional_failed_access, optional_events };
+
+struct optional_thread_tally;
+
+// the counters of one type: a list of live threads' counters and the sums of exited ones
+struct optional_tally
+{
+  std::string type;
+  size_t size;
+  unsigned long long retired[optional_events];
+  unsigned long long baseline[optional_events]; // the totals at the last optional_instrument_reset()
+  optional_thread_tally* threads;
+  optional_tally* next;
+
+  static std::mutex& mutex() { static std::mutex m; return m; }
+  static optional_tally*& all() { static optional_tally* head = nullptr; return head; }
+
+  optional_tally(std::string t, size_t s) : type(std::move(t)), size(s), retired(), baseline(), threads(nullptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex());
+    next = all();
+    all() = this;
+  }
+
+  inline void totals(unsigned long long (&n)[optional_events]) const; // under mutex()
+};
+
+// the counters of one type in one thread
+struct optional_thread_tally
+{
+  optional_tally& owner;
+  std::atomic<unsigned long long> n[optional_events];
+  optional_thread_tally* next;
+
+  explicit optional_thread_tally(optional_tally& t) : owner(t)
+  {
+    for (auto& c : n) c.store(0, memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(optional_tally::mutex());
+    next = owner.threads;
+    owner.threads = this;
+  }
+
+  ~optional_thread_tally()
+  {
+    std::lock_guard<std::mutex> lock(optional_tally::mutex());
+    for (int e = 0; e != optional_events; ++e) owner.retired[e] += n[e].load(memory_order_relaxed);
+    optional_thread_tally** p = &owner.threads;
+    while (*p != this) p = &(*p)->next;
+    *p = next;
+  }
+
+  // only the owning thread writes, so no read-modify-write is needed
+  void bump(int e) noexcept { n[e].store(n[e].load(memory_order_relaxed) + 1, memory_order_relaxed); }
+};
+
+inline void optional_tally::totals(unsigned long long (&n)[optional_events]) const
+{
+  for (int e = 0; e != optional_events; ++e) n[e] = retired[e];
+  for (optional_thread_tally* t = threads; t; t = t->next)
+    for (int e = 0; e != optional_events; ++e) n[e] += t->n[e].load(memory_order_relaxed);
+}
+
+template <class T>
+struct optional_type_tally
+{
+  static optional_tally& get()
+  {
+    static optional_tally t(optional_type_name<T>(), sizeof(T));
+    return t;
+  }
+};
+
+template <class T>
+void optional_bump(int e)
+{
+  static thread_local optional_thread_tally t(optional_type_tally<T>::get());
+  t.bump(e);
+}
+
+// counts an event of T at run time; a no-op in constant evaluation
+template <class T>
+constexpr bool optional_count(int e)
+{
+  return OPTIONAL_IS_CONSTANT_EVALUATED() || (optional_bump<T>(e), true);
+}
+
+} // namespace detail_
+
+
+// the counters of every payload type seen so far, summed over all threads, by type name
+inline std::vector<optional_instrument_row> optional_instrument_snapshot()
+{
+  std::vector<optional_instrument_row> ans;
+  {
+    std::lock_guard<std::mutex> lock(detail_::optional_tally::mutex());
+    for (detail_::optional_tally* t = detail_::optional_tally::all(); t; t = t->next) {
+      unsigned long long n[detail_::optional_events];
+      t->totals(n);
+      for (int e = 0; e != detail_::optional_events; ++e) n[e] -= t->baseline[e];
+      optional_instrument_row r = { t->type, t->size, n[detail_::optional_copied], n[detail_::optional_moved],
+                                    n[detail_::optional_emplaced], n[detail_::optional_reset],
+                                    n[detail_::optional_swapped], n[detail_::optional_failed_access] };
+      ans.push_back(r);
+    }
+  }
+  std::sort(ans.begin(), ans.end(), [](const optional_instrument_row& x, const optional_instrument_row& y) {
+    return x.type < y.type;
+  });
+  return ans;
+}
+
+// the counters of one type
+template <class T>
+optional_instrument_row optional_instrument_counts()
+{
+  const std::string name = detail_::optional_type_tally<T>::get().type;
+  for (optional_instrument_row& r : optional_instrument_snapshot())
+    if (r.type == name) return r;
+  return optional_instrument_row{ name, sizeof(T), 0, 0, 0, 0, 0, 0 };
+}
+
+// starts all counters again from zero
+inline void optional_instrument_reset()
+{
+  std::lock_guard<std::mutex> lock(detail_::optional_tally::mutex());
+  for (detail_::optional_tally* t = detail_::optional_tally::all(); t; t = t->next)
+    t->totals(t->baseline);
+}
+
+// prints the snapshot as a table
+inline void optional_instrument_report(std::ostream& os)
+{
+  std::vector<optional_instrument_row> rows = optional_instrument_snapshot();
+  size_t w = 4;
+  for (const optional_instrument_row& r : rows) w = (std::max)(w, r.type.size());
+
+  os << std::left << std::setw(w) << "type" << std::right << std::setw(8) << "size"
+     << std::setw(12) << "copies" << std::setw(12) << "moves" << std::setw(12) << "emplaces"
+     << std::setw(12) << "resets" << std::setw(12) << "swaps" << std::setw(12) << "failed" << '\n';
+  for (const optional_instrument_row& r : rows)
+    os << std::left << std::setw(w) << r.type << std::right << std::setw(8) << r.size
+       << std::setw(12) << r.copies << std::setw(12) << r.moves << std::setw(12) << r.emplaces
+       << std::setw(12) << r.resets << std::setw(12) << r.swaps << std::setw(12) << r.failed_accesses << '\n';
+}
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_INSTRUMENT_HPP___
@@ -0,0 +1,82 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_LAYOUT_HPP___
+# define ___OPTIONAL_LAYOUT_HPP___
+
+# include "optional.hpp"
+# include <cstddef>
+
+namespace std{
+
+namespace experimental{
+
+// optional_niche<T>: true if some object representations of T are never valid values, so
+// that one of them could stand for "disengaged" instead of a separate flag. Specialize it
+// for your own types (e.g. an enumeration with a known range or a type with a sentinel).
+template <class T> struct optional_niche : false_type {};
+template <> struct optional_niche<bool> : true_type {}; // only 0 and 1 are valid
+template <class T> struct optional_niche<const T> : optional_niche<T> {};
+
+namespace detail_
+{
+
+// a class derived from T places its first member in T's tail padding if the ABI allows it
+template <class T, bool = is_class<T>::value && !__is_final(T)>
+struct tail_padding_reusable : false_type {};
+
+template <class T>
+struct tail_padding_reusable<T, true>
+{
+  struct probe : T { unsigned char flag; };
+  constexpr static bool value = sizeof(probe) == sizeof(T);
+};
+
+} // namespace detail_
+
+
+// optional_layout<T>: where the bytes of optional<T> go, for finding payload types that
+// waste space on the padding after the engaged flag.
+//   size            sizeof(optional<T>)
+//   payload_size    sizeof(T)
+//   flag_size       the engaged flag
+//   padding_bytes   size - payload_size - flag_size, the alignment padding around the flag
+//   overhead_bytes  size - payload_size
+//   has_niche       optional_niche<T>: the flag could be encoded in an invalid T
+//   tail_padding    the flag would fit in the tail padding of T if T were a base class
+//   best_size       the size with either of these placements, size if neither applies
+template <class T>
+struct optional_layout
+{
+  constexpr static size_t size = sizeof(optional<T>);
+  constexpr static size_t payload_size = sizeof(T);
+  constexpr static size_t flag_size = sizeof(bool);
+  constexpr static size_t padding_bytes = size - payload_size - flag_size;
+  constexpr static size_t overhead_bytes = size - payload_size;
+  constexpr static bool has_niche = optional_niche<T>::value;
+  constexpr static bool tail_padding = detail_::tail_padding_reusable<typename remove_cv<T>::type>::value;
+  constexpr static size_t best_size = has_niche || tail_padding ? payload_size : size;
+};
+
+// optional<T&> is a pointer whose null value is the niche
+template <class T>
+struct optional_layout<T&>
+{
+  constexpr static size_t size = sizeof(optional<T&>);
+  constexpr static size_t payload_size = sizeof(T*);
+  constexpr static size_t flag_size = 0;
+  constexpr static size_t padding_bytes = size - payload_size - flag_size;
+  constexpr static size_t overhead_bytes = size - payload_size;
+  constexpr static bool has_niche = true;
+  constexpr static bool tail_padding = false;
+  constexpr static size_t best_size = size;
+};
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_LAYOUT_HPP___
@@ -0,0 +1,57 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Prints optional_layout<T> for a list of types. To report on your own types, write a header
+// that includes them and defines OPTIONAL_LAYOUT_TYPE_LIST(ROW) as a sequence of ROW(type),
+// and configure with -DOPTIONAL_LAYOUT_TYPES=/path/to/that/header.hpp.
+
+# include "optional_layout.hpp"
+# include <cstdint>
+# include <iomanip>
+# include <iostream>
+# include <string>
+# include <utility>
+
+# if defined OPTIONAL_LAYOUT_TYPES
+#   include OPTIONAL_LAYOUT_TYPES
+# else
+
+// a non-POD class: its tail padding can hold the flag
+struct Account
+{
+  Account() : id(), open() {}
+  std::int64_t id;
+  bool open;
+};
+
+# define OPTIONAL_LAYOUT_TYPE_LIST(ROW) \
+  ROW(char) ROW(bool) ROW(int) ROW(long long) ROW(double) ROW(void*) ROW(int&) \
+  ROW(std::pair<int, char>) ROW(std::pair<double, int>) ROW(std::string) ROW(Account)
+
+# endif
+
+namespace tr2 = std::experimental;
+
+template <class T>
+void print_row(const char* type, std::ostream& os)
+{
+  typedef tr2::optional_layout<T> L;
+  os << std::left << std::setw(28) << type << std::right
+     << std::setw(6) << L::size << std::setw(9) << L::payload_size << std::setw(6) << L::flag_size
+     << std::setw(9) << L::padding_bytes << std::setw(7) << (L::has_niche ? "yes" : "no")
+     << std::setw(7) << (L::tail_padding ? "yes" : "no") << std::setw(6) << L::best_size << '\n';
+}
+
+# define OPTIONAL_LAYOUT_ROW(...) print_row<__VA_ARGS__>(#__VA_ARGS__, std::cout);
+
+int main()
+{
+  std::cout << std::left << std::setw(28) << "type" << std::right
+            << std::setw(6) << "size" << std::setw(9) << "payload" << std::setw(6) << "flag"
+            << std::setw(9) << "padding" << std::setw(7) << "niche"
+            << std::setw(7) << "tail" << std::setw(6) << "best" << '\n';
+  OPTIONAL_LAYOUT_TYPE_LIST(OPTIONAL_LAYOUT_ROW)
+}
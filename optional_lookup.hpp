@@ -0,0 +1,141 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_LOOKUP_HPP___
+# define ___OPTIONAL_LOOKUP_HPP___
+
+# include "optional.hpp"
+# include <tuple>
+
+// the address of an element a lookup found is never null, but the optimizer cannot tell when
+// it is computed from the data of a vector that could be empty, and would test the pointer in
+// the optional again after the range check; it has to be told where the address is taken
+# if defined __GNUC__
+#   define OPTIONAL_LOOKUP_NONNULL(P) do { if ((P) == nullptr) __builtin_unreachable(); } while (false)
+# elif defined _MSC_VER
+#   define OPTIONAL_LOOKUP_NONNULL(P) __assume((P) != nullptr)
+# else
+#   define OPTIONAL_LOOKUP_NONNULL(P) ((void)0)
+# endif
+
+namespace std{
+
+namespace experimental{
+
+namespace detail_
+{
+
+// has_mapped_type: tells associative containers (map, unordered_map) from sequences
+template <typename C>
+struct has_mapped_type
+{
+  template <class X>
+  constexpr static bool has_member(...) { return false; }
+
+  template <class X, class M = typename X::mapped_type>
+  constexpr static bool has_member(bool) { return true; }
+
+  constexpr static bool value = has_member<C>(true);
+};
+
+// like_const: V, or const V if C is const
+template <class C, class V> struct like_const { typedef V type; };
+template <class C, class V> struct like_const<const C, V> { typedef const V type; };
+
+template <class Map>
+using mapped_ref_t = typename like_const<Map, typename remove_const<Map>::type::mapped_type>::type&;
+
+template <class Seq>
+using element_ref_t = typename like_const<Seq, typename remove_const<Seq>::type::value_type>::type&;
+
+
+// try_emplace is a single hash/tree walk for both the find and the insert. Without it (a
+// C++11 library) an ordered map still takes one walk, lower_bound and then an insertion at
+// that hint; an unordered map hashes the key twice, once in find and once in emplace, since
+// a single emplace would build a node, and the mapped value, even when the key is there
+template <class Map, class K, class... Args>
+auto lookup_or_emplace_impl(bool, Map& m, K&& k, Args&&... args)
+-> decltype((void)m.try_emplace(std::forward<K>(k), std::forward<Args>(args)...), declval<typename Map::mapped_type&>())
+{
+  return m.try_emplace(std::forward<K>(k), std::forward<Args>(args)...).first->second;
+}
+
+template <class Map, class K, class... Args>
+auto lookup_or_emplace_hinted(bool, Map& m, K&& k, Args&&... args)
+-> decltype((void)m.key_comp(), declval<typename Map::mapped_type&>())
+{
+  auto it = m.lower_bound(k);
+  if (it == m.end() || m.key_comp()(k, it->first))
+    it = m.emplace_hint(it, piecewise_construct,
+                        std::forward_as_tuple(std::forward<K>(k)),
+                        std::forward_as_tuple(std::forward<Args>(args)...));
+  return it->second;
+}
+
+template <class Map, class K, class... Args>
+typename Map::mapped_type& lookup_or_emplace_hinted(int, Map& m, K&& k, Args&&... args)
+{
+  auto it = m.find(k);
+  if (it == m.end())
+    it = m.emplace(piecewise_construct,
+                   std::forward_as_tuple(std::forward<K>(k)),
+                   std::forward_as_tuple(std::forward<Args>(args)...)).first;
+  return it->second;
+}
+
+template <class Map, class K, class... Args>
+typename Map::mapped_type& lookup_or_emplace_impl(int, Map& m, K&& k, Args&&... args)
+{
+  return lookup_or_emplace_hinted(true, m, std::forward<K>(k), std::forward<Args>(args)...);
+}
+
+} // namespace detail_
+
+
+// lookup in associative containers: the mapped value under key k, if any
+// K can be any type the container's find() accepts, so heterogeneous lookup
+// works whenever the container's comparator/hasher is transparent
+template <class Map, class K,
+          typename enable_if<detail_::has_mapped_type<typename remove_const<Map>::type>::value, bool>::type = false>
+optional<detail_::mapped_ref_t<Map>> lookup(Map& m, const K& k)
+{
+  auto it = m.find(k);
+  if (it == m.end()) return optional<detail_::mapped_ref_t<Map>>();
+  auto* p = std::addressof(it->second);
+  OPTIONAL_LOOKUP_NONNULL(p);
+  return optional<detail_::mapped_ref_t<Map>>(*p);
+}
+
+// lookup in random-access sequences: the element at index i, if i is in range
+template <class Seq,
+          typename enable_if<!detail_::has_mapped_type<typename remove_const<Seq>::type>::value, bool>::type = false>
+optional<detail_::element_ref_t<Seq>> lookup(Seq& s, typename remove_const<Seq>::type::size_type i)
+{
+  if (i >= s.size()) return optional<detail_::element_ref_t<Seq>>();
+  auto* p = std::addressof(s[i]);
+  OPTIONAL_LOOKUP_NONNULL(p);
+  return optional<detail_::element_ref_t<Seq>>(*p);
+}
+
+// lookup into a temporary container would return a dangling reference
+template <class C, class K, typename enable_if<!is_lvalue_reference<C>::value, bool>::type = false>
+void lookup(C&&, const K&) = delete;
+
+
+// the mapped value under key k; if there is none it is first constructed from args
+template <class Map, class K, class... Args>
+typename Map::mapped_type& lookup_or_emplace(Map& m, K&& k, Args&&... args)
+{
+  return detail_::lookup_or_emplace_impl(true, m, std::forward<K>(k), std::forward<Args>(args)...);
+}
+
+
+} // namespace experimental
+} // namespace std
+
+# undef OPTIONAL_LOOKUP_NONNULL
+
+# endif //___OPTIONAL_LOOKUP_HPP___
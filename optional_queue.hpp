@@ -0,0 +1,187 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_QUEUE_HPP___
+# define ___OPTIONAL_QUEUE_HPP___
+
+# include "optional.hpp"
+# include <atomic>
+# include <cstddef>
+# include <memory>
+
+# if (defined __cplusplus) && (__cplusplus > 201703L) && (defined __has_include)
+#   if __has_include(<span>)
+#     include <span>
+#   endif
+# endif
+
+# if !defined OPTIONAL_CACHE_LINE_SIZE
+#   define OPTIONAL_CACHE_LINE_SIZE 64
+# endif
+
+namespace std{
+
+namespace experimental{
+
+// optional_queue<T>: a bounded multi-producer/multi-consumer queue (D. Vyukov's array queue).
+// Each cell holds a sequence number and raw storage for one T. try_pop() moves the element
+// from its cell straight into the returned optional<T>: one move construction, no copies
+// and no moves of a disengaged optional. The cells are allocated once, by the constructor.
+// If constructing an element throws, nothing is pushed; if moving one out throws, that element
+// is lost. Either way the queue stays usable.
+template <class T>
+class optional_queue
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+
+  struct cell
+  {
+    std::atomic<size_t> seq;
+    bool full;   // false if the construction of the element threw; consumers skip the cell
+    storage_t<typename std::remove_const<T>::type> storage;
+
+    cell() noexcept : seq(0), full(false), storage(trivial_init) {}
+    T* dataptr() noexcept { return std::addressof(storage.value_); }
+  };
+
+  // cell i is ready for the producer at position p when seq == p, for the consumer when seq == p + 1
+  std::unique_ptr<cell[]> cells_;
+  size_t mask_;
+  char pad0_[OPTIONAL_CACHE_LINE_SIZE];
+  std::atomic<size_t> enqueue_pos_;
+  char pad1_[OPTIONAL_CACHE_LINE_SIZE];
+  std::atomic<size_t> dequeue_pos_;
+  char pad2_[OPTIONAL_CACHE_LINE_SIZE];
+
+  static size_t round_up(size_t n) noexcept
+  {
+    size_t c = 2;
+    while (c < n) c *= 2;
+    return c;
+  }
+
+  // claims up to n consecutive cells in state `ready` (relative to position) with one CAS on pos
+  size_t claim(std::atomic<size_t>& pos_var, size_t ready, size_t n, size_t& pos) noexcept
+  {
+    pos = pos_var.load(memory_order_relaxed);
+    for (;;) {
+      size_t k = 0;
+      bool stale = false;
+      for (; k != n; ++k) {
+        size_t seq = cells_[(pos + k) & mask_].seq.load(memory_order_acquire);
+        std::ptrdiff_t dif = std::ptrdiff_t(seq) - std::ptrdiff_t(pos + k + ready);
+        if (dif == 0) continue;
+        stale = (k == 0 && dif > 0);  // another thread took this position: reload
+        break;                        // otherwise the queue is full (or empty) from here on
+      }
+      if (stale) { pos = pos_var.load(memory_order_relaxed); continue; }
+      if (k == 0) return 0;
+      if (pos_var.compare_exchange_weak(pos, pos + k, memory_order_relaxed, memory_order_relaxed))
+        return k;
+    }
+  }
+
+  // hands a claimed cell on when it goes out of scope, also when constructing or moving the
+  // element threw, so that no cell is left to be waited for forever
+  struct cell_release
+  {
+    std::atomic<size_t>& seq;
+    size_t next;
+    ~cell_release() { seq.store(next, memory_order_release); }
+  };
+
+  template <class... Args>
+  bool push_impl(Args&&... args)
+  {
+    size_t pos;
+    if (!claim(enqueue_pos_, 0, 1, pos)) return false;
+    cell& c = cells_[pos & mask_];
+    cell_release done = { c.seq, pos + 1 };
+    c.full = false;
+    ::new (static_cast<void*>(c.dataptr())) T(std::forward<Args>(args)...);
+    c.full = true;
+    return true;
+  }
+
+  // passes the element of a claimed cell to move, destroys it and hands the cell back to the
+  // producers, whether or not move throws; false if the cell is empty
+  template <class Move>
+  bool take_cell(size_t pos, Move move)
+  {
+    cell& c = cells_[pos & mask_];
+    cell_release done = { c.seq, pos + mask_ + 1 };
+    if (!c.full) return false;
+    struct destroy { T* p; ~destroy() { p->T::~T(); } } d = { c.dataptr() };
+    move(*c.dataptr());
+    return true;
+  }
+
+public:
+  typedef T value_type;
+
+  // capacity is rounded up to a power of two, at least 2
+  explicit optional_queue(size_t capacity)
+  : cells_(new cell[round_up(capacity)]), mask_(round_up(capacity) - 1), enqueue_pos_(0), dequeue_pos_(0)
+  {
+    for (size_t i = 0; i <= mask_; ++i)
+      cells_[i].seq.store(i, memory_order_relaxed);
+  }
+
+  optional_queue(const optional_queue&) = delete;
+  optional_queue& operator=(const optional_queue&) = delete;
+
+  ~optional_queue() { while (try_pop()) {} }
+
+  size_t capacity() const noexcept { return mask_ + 1; }
+
+  bool try_push(const T& v) { return push_impl(v); }
+  bool try_push(T&& v) { return push_impl(std::move(v)); }
+
+  template <class... Args>
+  bool try_emplace(Args&&... args) { return push_impl(std::forward<Args>(args)...); }
+
+  // the oldest element, or nullopt if the queue is empty
+  optional<T> try_pop()
+  {
+    optional<T> r; // the only object returned, so that it is constructed in the caller's storage
+    size_t pos;
+    while (claim(dequeue_pos_, 1, 1, pos))
+      if (take_cell(pos, [&](T& v) { r.emplace(std::move(v)); })) break;
+    return r;
+  }
+
+  // pops up to n elements into out[0..n) with a single claim; returns how many were popped.
+  // Elements are assigned to the optionals, reusing their storage where they are engaged. If
+  // an assignment throws, the elements claimed but not yet popped are destroyed.
+  size_t try_pop_bulk(optional<T>* out, size_t n)
+  {
+    size_t pos;
+    size_t k = claim(dequeue_pos_, 1, n, pos), popped = 0;
+
+    struct remaining
+    {
+      optional_queue& q;
+      size_t pos, next, end;
+      ~remaining() { for (; next != end; ++next) q.take_cell(pos + next, [](T&) {}); }
+    } rest = { *this, pos, 0, k };
+
+    while (rest.next != k) {
+      size_t i = rest.next++;
+      if (take_cell(pos + i, [&](T& v) { out[popped] = std::move(v); })) ++popped;
+    }
+    return popped;
+  }
+
+# if defined __cpp_lib_span
+  size_t try_pop_bulk(std::span<optional<T>> out) { return try_pop_bulk(out.data(), out.size()); }
+# endif
+};
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_QUEUE_HPP___
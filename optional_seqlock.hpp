@@ -0,0 +1,97 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Implementation detail of seqlock_optional and shm_optional: the sequence-counter protocol.
+// A writer makes the counter odd, stores the flag and the value words, and makes the counter
+// even again; a reader copies the flag and the words between two loads of the counter and
+// retries if the counter was odd or changed. All the state is in lock-free atomics, which may
+// live in memory shared between processes.
+
+# ifndef ___OPTIONAL_SEQLOCK_HPP___
+# define ___OPTIONAL_SEQLOCK_HPP___
+
+# include "optional.hpp"
+# include <atomic>
+# include <cstdint>
+# include <cstring>
+# include <thread>
+
+namespace std{
+
+namespace experimental{
+
+namespace detail_
+{
+
+// waits for the counter to be even and makes it odd; returns the even value
+inline uint32_t seqlock_begin_write(std::atomic<uint32_t>& seq) noexcept
+{
+  uint32_t s = seq.load(memory_order_relaxed);
+  for (;;) {
+    if (s & 1) {
+      std::this_thread::yield();
+      s = seq.load(memory_order_relaxed);
+    }
+    else if (seq.compare_exchange_weak(s, s + 1, memory_order_acquire, memory_order_relaxed))
+      break;
+  }
+  atomic_thread_fence(memory_order_release);
+  return s;
+}
+
+// publishes the value v points to, or disengages if v is null; writers are serialized
+template <class T, class F, class W, size_t N>
+void seqlock_write(std::atomic<uint32_t>& seq, std::atomic<F>& engaged, std::atomic<W> (&words)[N], const T* v) noexcept
+{
+  static_assert( sizeof(T) <= N * sizeof(W), "the value does not fit the words" );
+  uint32_t s = seqlock_begin_write(seq);
+  if (v) {
+    W buf[N] = {};
+    std::memcpy(buf, v, sizeof(T));
+    for (size_t i = 0; i != N; ++i)
+      words[i].store(buf[i], memory_order_relaxed);
+  }
+  engaged.store(F(v != nullptr), memory_order_relaxed);
+  seq.store(s + 2, memory_order_release);
+}
+
+// a consistent copy of the flag and the value into out; returns false, leaving out alone,
+// if the counter stays odd for max_spins loads in a row: a write that does not finish
+template <class T, class F, class W, size_t N>
+bool seqlock_read(const std::atomic<uint32_t>& seq, const std::atomic<F>& engaged, const std::atomic<W> (&words)[N],
+                  optional<T>& out, size_t max_spins = size_t(-1)) noexcept
+{
+  W buf[N];
+  bool e;
+  for (size_t spins = 0;;) {
+    uint32_t s = seq.load(memory_order_acquire);
+    if (s & 1) {
+      if (++spins == max_spins) return false;
+      std::this_thread::yield();
+      continue;
+    }
+    spins = 0;
+    e = engaged.load(memory_order_relaxed) != F();
+    if (e)
+      for (size_t i = 0; i != N; ++i)
+        buf[i] = words[i].load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (seq.load(memory_order_relaxed) == s)
+      break;
+  }
+  if (!e) { out = nullopt; return true; }
+  typename aligned_storage<sizeof(T), alignof(T)>::type v;
+  std::memcpy(&v, buf, sizeof(T));
+  out.emplace(*reinterpret_cast<const T*>(&v));
+  return true;
+}
+
+} // namespace detail_
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_SEQLOCK_HPP___
@@ -0,0 +1,154 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_SLOT_HPP___
+# define ___OPTIONAL_SLOT_HPP___
+
+# include "optional.hpp"
+# include "optional_wait.hpp"
+
+namespace std{
+
+namespace experimental{
+
+// optional_slot<T>: hands one value at a time from a single producer thread to a
+// single consumer thread. The value lives inside the slot; nothing is allocated.
+// After the consumer takes a value the slot is empty and can be filled again.
+template <class T>
+class optional_slot
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, nullopt_t>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, in_place_t>::value, "bad T" );
+
+  // bit 0: a value is present; bit 1: the other side sleeps until bit 0 changes.
+  // With one producer and one consumer at most one side can be sleeping.
+  enum : uint32_t { empty = 0, full = 1, waiting = 2 };
+
+  std::atomic<uint32_t> state_;
+  storage_t<typename std::remove_const<T>::type> storage_;
+
+  T* dataptr() noexcept { return std::addressof(storage_.value_); }
+
+  // marks the caller as sleeping if the slot is still in state s, returns false if it changed
+  bool announce_wait(uint32_t& s) noexcept
+  {
+    return (s & waiting) || state_.compare_exchange_weak(s, s | waiting, memory_order_acquire, memory_order_acquire);
+  }
+
+  void publish(uint32_t s) noexcept
+  {
+    if (state_.exchange(s, memory_order_acq_rel) & waiting)
+      detail_::atomic_notify_one(state_);
+  }
+
+  optional<T> take_value()
+  {
+    optional<T> r (std::move(*dataptr()));
+    dataptr()->T::~T();
+    publish(empty);
+    return r;
+  }
+
+  template <class... Args>
+  void put_value(Args&&... args)
+  {
+    ::new (static_cast<void*>(dataptr())) T(std::forward<Args>(args)...);
+    publish(full);
+  }
+
+public:
+  typedef T value_type;
+
+  constexpr optional_slot() noexcept : state_(empty), storage_(trivial_init) {}
+
+  optional_slot(const optional_slot&) = delete;
+  optional_slot& operator=(const optional_slot&) = delete;
+
+  ~optional_slot() { if (state_.load(memory_order_acquire) & full) dataptr()->T::~T(); }
+
+  // producer: constructs the value from args, first waiting for the previous one to be taken
+  template <class... Args>
+  void emplace(Args&&... args)
+  {
+    uint32_t s = state_.load(memory_order_acquire);
+    while (s & full) {
+      if (announce_wait(s)) {
+        detail_::atomic_wait(state_, full | waiting);
+        s = state_.load(memory_order_acquire);
+      }
+    }
+    put_value(std::forward<Args>(args)...);
+  }
+
+  // producer: constructs the value from args if the slot is empty
+  template <class... Args>
+  bool try_emplace(Args&&... args)
+  {
+    if (state_.load(memory_order_acquire) & full)
+      return false;
+    put_value(std::forward<Args>(args)...);
+    return true;
+  }
+
+  // consumer: the value, if one is present
+  optional<T> try_take()
+  {
+    if (!(state_.load(memory_order_acquire) & full))
+      return nullopt;
+    return take_value();
+  }
+
+  // consumer: blocks until a value is present
+  optional<T> wait()
+  {
+    uint32_t s = state_.load(memory_order_acquire);
+    while (!(s & full)) {
+      if (announce_wait(s)) {
+        detail_::atomic_wait(state_, empty | waiting);
+        s = state_.load(memory_order_acquire);
+      }
+    }
+    return take_value();
+  }
+
+  // consumer: blocks until a value is present or the deadline passes
+  template <class Clock, class Duration>
+  optional<T> wait_until(const std::chrono::time_point<Clock, Duration>& deadline)
+  {
+    uint32_t s = state_.load(memory_order_acquire);
+    while (!(s & full)) {
+      auto now = Clock::now();
+      if (now >= deadline) {
+        s = empty | waiting;
+        state_.compare_exchange_strong(s, empty, memory_order_acquire); // not sleeping anymore
+        if (s & full) break;
+        return nullopt;
+      }
+      if (announce_wait(s)) {
+        detail_::atomic_wait_for(state_, empty | waiting, deadline - now);
+        s = state_.load(memory_order_acquire);
+      }
+    }
+    return take_value();
+  }
+
+  // consumer: blocks until a value is present or the timeout elapses
+  template <class Rep, class Period>
+  optional<T> wait_for(const std::chrono::duration<Rep, Period>& timeout)
+  {
+    return wait_until(std::chrono::steady_clock::now() + timeout);
+  }
+
+  // true if a value is waiting to be taken; only a hint to any thread but the consumer
+  bool has_value() const noexcept { return state_.load(memory_order_acquire) & full; }
+};
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_SLOT_HPP___
@@ -0,0 +1,48 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_TYPE_NAME_HPP___
+# define ___OPTIONAL_TYPE_NAME_HPP___
+
+// The name of a payload type, as the OPTIONAL_INSTRUMENT report and the OPTIONAL_USDT probes
+// show it; included by optional.hpp in those modes.
+
+# include <string>
+
+namespace std{
+
+namespace experimental{
+
+namespace detail_
+{
+
+// T out of the signature of optional_type_name<T>: "... [with T = X; ...]" or "... [T = X]"
+inline std::string type_name_from_signature(const std::string& f)
+{
+  size_t b = f.find("T = ");
+  if (b == std::string::npos) return f;
+  b += 4;
+  size_t e = f.find(';', b);
+  return f.substr(b, (e == std::string::npos ? f.rfind(']') : e) - b);
+}
+
+template <class T>
+const std::string& optional_type_name()
+{
+# if defined _MSC_VER
+  static const std::string name = __FUNCSIG__;
+# else
+  static const std::string name = type_name_from_signature(__PRETTY_FUNCTION__);
+# endif
+  return name;
+}
+
+} // namespace detail_
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_TYPE_NAME_HPP___
@@ -0,0 +1,100 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Implementation detail of the concurrent optional types: blocking on a 32-bit atomic.
+// Uses the futex system call on Linux, std::atomic<>::wait where the library has it,
+// and yields the CPU in a loop elsewhere.
+
+# ifndef ___OPTIONAL_WAIT_HPP___
+# define ___OPTIONAL_WAIT_HPP___
+
+# include <atomic>
+# include <chrono>
+# include <cstdint>
+# include <thread>
+
+# if defined __linux__
+#   include <ctime>
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   define OPTIONAL_HAS_FUTEX 1
+# else
+#   define OPTIONAL_HAS_FUTEX 0
+# endif
+
+namespace std{
+
+namespace experimental{
+
+namespace detail_
+{
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic<uint32_t> cannot be a futex word");
+
+// blocks while a == old; may return spuriously
+inline void atomic_wait(const std::atomic<uint32_t>& a, uint32_t old) noexcept
+{
+# if OPTIONAL_HAS_FUTEX
+  if (a.load(memory_order_acquire) == old)
+    syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&a), FUTEX_WAIT_PRIVATE, old, nullptr, nullptr, 0);
+# elif defined __cpp_lib_atomic_wait
+  a.wait(old, memory_order_acquire);
+# else
+  if (a.load(memory_order_acquire) == old)
+    std::this_thread::yield();
+# endif
+}
+
+// blocks while a == old, but not much longer than d; may return spuriously
+template <class Rep, class Period>
+void atomic_wait_for(const std::atomic<uint32_t>& a, uint32_t old, std::chrono::duration<Rep, Period> d) noexcept
+{
+  if (d <= d.zero())
+    return;
+# if OPTIONAL_HAS_FUTEX
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+  if (ns <= 0) ns = 1;
+  timespec ts;
+  ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+  ts.tv_nsec = static_cast<long>(ns % 1000000000);
+  if (a.load(memory_order_acquire) == old)
+    syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&a), FUTEX_WAIT_PRIVATE, old, &ts, nullptr, 0);
+# else
+  // no portable timed wait on an atomic: poll
+  if (a.load(memory_order_acquire) == old)
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+# endif
+}
+
+inline void atomic_notify_one(std::atomic<uint32_t>& a) noexcept
+{
+# if OPTIONAL_HAS_FUTEX
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&a), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+# elif defined __cpp_lib_atomic_wait
+  a.notify_one();
+# else
+  (void)a;
+# endif
+}
+
+inline void atomic_notify_all(std::atomic<uint32_t>& a) noexcept
+{
+# if OPTIONAL_HAS_FUTEX
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&a), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+# elif defined __cpp_lib_atomic_wait
+  a.notify_all();
+# else
+  (void)a;
+# endif
+}
+
+} // namespace detail_
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_WAIT_HPP___
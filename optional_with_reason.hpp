@@ -0,0 +1,340 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___OPTIONAL_WITH_REASON_HPP___
+# define ___OPTIONAL_WITH_REASON_HPP___
+
+# include "optional.hpp"
+
+namespace std{
+
+namespace experimental{
+
+// optional_with_reason<T, Reason>: an optional<T> that also says why it is empty.
+// Reason is an enumeration whose values lie in [0, 254]. The byte that optional<T>
+// spends on its bool flag holds either `engaged` (255) or the reason, so the object
+// is exactly as big as optional<T>. Observers match optional; a disengaged object
+// compares equal to nullopt whatever its reason.
+
+namespace detail_
+{
+
+constexpr unsigned char engaged_state = 255;
+
+template <class T>
+struct reason_optional_base
+{
+  unsigned char state_;
+  storage_t<T> storage_;
+
+  explicit constexpr reason_optional_base(unsigned char r) noexcept : state_(r), storage_(trivial_init) {}
+
+  template <class... Args> explicit constexpr reason_optional_base(in_place_t, Args&&... args)
+    : state_(engaged_state), storage_(constexpr_forward<Args>(args)...) {}
+
+  ~reason_optional_base() { if (state_ == engaged_state) storage_.value_.T::~T(); }
+};
+
+template <class T>
+struct constexpr_reason_optional_base
+{
+  unsigned char state_;
+  constexpr_storage_t<T> storage_;
+
+  explicit constexpr constexpr_reason_optional_base(unsigned char r) noexcept : state_(r), storage_(trivial_init) {}
+
+  template <class... Args> explicit constexpr constexpr_reason_optional_base(in_place_t, Args&&... args)
+    : state_(engaged_state), storage_(constexpr_forward<Args>(args)...) {}
+
+  ~constexpr_reason_optional_base() = default;
+};
+
+template <class T>
+using ReasonOptionalBase = typename std::conditional<
+    is_trivially_destructible<T>::value,
+    constexpr_reason_optional_base<typename std::remove_const<T>::type>,
+    reason_optional_base<typename std::remove_const<T>::type>
+>::type;
+
+template <class Reason>
+constexpr unsigned char reason_state(Reason r)
+{
+  return static_cast<unsigned long long>(r) >= engaged_state
+    ? (assert(!"a Reason must lie in [0, 254]"), static_cast<unsigned char>(r))
+    : static_cast<unsigned char>(r);
+}
+
+} // namespace detail_
+
+
+template <class T, class Reason>
+class optional_with_reason : private detail_::ReasonOptionalBase<T>
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, nullopt_t>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, in_place_t>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, Reason>::value, "bad T" );
+  static_assert( std::is_enum<Reason>::value, "bad Reason" );
+
+  typedef detail_::ReasonOptionalBase<T> base;
+  typedef typename optional_check_policy<T>::type check_policy;
+
+  constexpr bool initialized() const noexcept { return base::state_ == detail_::engaged_state; }
+  constexpr bool accessible() const noexcept { return !check_policy::checks || initialized(); }
+  typename std::remove_const<T>::type* dataptr() { return std::addressof(base::storage_.value_); }
+  constexpr const T* dataptr() const { return detail_::static_addressof(base::storage_.value_); }
+
+  void clear(unsigned char r) noexcept
+  {
+    if (initialized()) dataptr()->T::~T();
+    base::state_ = r;
+  }
+
+  template <class... Args>
+  void initialize(Args&&... args) noexcept(noexcept(T(std::forward<Args>(args)...)))
+  {
+    assert(!initialized());
+    ::new (static_cast<void*>(dataptr())) T(std::forward<Args>(args)...);
+    base::state_ = detail_::engaged_state;
+  }
+
+public:
+  typedef T value_type;
+  typedef Reason reason_type;
+
+  // constructors; disengaged objects without an explicit reason get Reason()
+  constexpr optional_with_reason() noexcept : base(0) {}
+  constexpr optional_with_reason(nullopt_t) noexcept : base(0) {}
+  constexpr optional_with_reason(Reason r) noexcept : base(detail_::reason_state(r)) {}
+
+  optional_with_reason(const optional_with_reason& rhs) : base(rhs.base::state_)
+  {
+    if (rhs.initialized()) {
+      base::state_ = 0;
+      initialize(*rhs);
+    }
+  }
+
+  optional_with_reason(optional_with_reason&& rhs) noexcept(is_nothrow_move_constructible<T>::value)
+  : base(rhs.base::state_)
+  {
+    if (rhs.initialized()) {
+      base::state_ = 0;
+      initialize(std::move(*rhs));
+    }
+  }
+
+  constexpr optional_with_reason(const T& v) : base(in_place_t{}, v) {}
+  constexpr optional_with_reason(T&& v) : base(in_place_t{}, constexpr_move(v)) {}
+
+  template <class... Args>
+  explicit constexpr optional_with_reason(in_place_t, Args&&... args)
+  : base(in_place_t{}, constexpr_forward<Args>(args)...) {}
+
+  // from optional<T>: a disengaged optional becomes reason r
+  optional_with_reason(const optional<T>& o, Reason r) : base(detail_::reason_state(r))
+  {
+    if (o) initialize(*o);
+  }
+
+  optional_with_reason(optional<T>&& o, Reason r) : base(detail_::reason_state(r))
+  {
+    if (o) initialize(std::move(*o));
+  }
+
+  ~optional_with_reason() = default;
+
+  // assignment
+  optional_with_reason& operator=(nullopt_t) noexcept { clear(0); return *this; }
+  optional_with_reason& operator=(Reason r) noexcept { clear(detail_::reason_state(r)); return *this; }
+
+  optional_with_reason& operator=(const optional_with_reason& rhs)
+  {
+    if      (initialized() && rhs.initialized()) **this = *rhs;
+    else if (rhs.initialized())                  initialize(*rhs);
+    else                                         clear(rhs.base::state_);
+    return *this;
+  }
+
+  optional_with_reason& operator=(optional_with_reason&& rhs)
+  noexcept(is_nothrow_move_assignable<T>::value && is_nothrow_move_constructible<T>::value)
+  {
+    if      (initialized() && rhs.initialized()) **this = std::move(*rhs);
+    else if (rhs.initialized())                  initialize(std::move(*rhs));
+    else                                         clear(rhs.base::state_);
+    return *this;
+  }
+
+  template <class U>
+  auto operator=(U&& v)
+  -> typename enable_if
+  <
+    is_same<typename decay<U>::type, T>::value,
+    optional_with_reason&
+  >::type
+  {
+    if (initialized()) { **this = std::forward<U>(v); }
+    else               { initialize(std::forward<U>(v)); }
+    return *this;
+  }
+
+  template <class... Args>
+  void emplace(Args&&... args)
+  {
+    clear(0);
+    initialize(std::forward<Args>(args)...);
+  }
+
+  void reset(Reason r = Reason()) noexcept { clear(detail_::reason_state(r)); }
+
+  void swap(optional_with_reason& rhs) noexcept(is_nothrow_move_constructible<T>::value
+                                                && noexcept(detail_::swap_ns::adl_swap(declval<T&>(), declval<T&>())))
+  {
+    if (initialized() && rhs.initialized()) {
+      using std::swap;
+      swap(**this, *rhs);
+    }
+    else if (initialized()) {
+      unsigned char r = rhs.base::state_;
+      rhs.initialize(std::move(**this));
+      clear(r);
+    }
+    else if (rhs.initialized()) {
+      rhs.swap(*this);
+    }
+    else {
+      std::swap(base::state_, rhs.base::state_);
+    }
+  }
+
+  // observers
+  explicit constexpr operator bool() const noexcept { return initialized(); }
+  constexpr bool has_value() const noexcept { return initialized(); }
+
+  // why the object is empty; Reason() if it was emptied without a reason
+  constexpr Reason reason() const noexcept
+  {
+    return assert(!initialized()), static_cast<Reason>(base::state_);
+  }
+
+  constexpr T const* operator->() const { return assert(initialized()), dataptr(); }
+  T* operator->() { assert(initialized()); return dataptr(); }
+
+# if OPTIONAL_HAS_THIS_RVALUE_REFS == 1
+
+  constexpr T const& operator*() const& { return assert(initialized()), base::storage_.value_; }
+  T& operator*() & { assert(initialized()); return base::storage_.value_; }
+  T&& operator*() && { assert(initialized()); return std::move(base::storage_.value_); }
+
+  constexpr T const& value() const& {
+    return accessible() ? base::storage_.value_ : (check_policy::fail(), base::storage_.value_);
+  }
+
+  T& value() & {
+    if (!accessible()) check_policy::fail();
+    return base::storage_.value_;
+  }
+
+  T&& value() && {
+    if (!accessible()) check_policy::fail();
+    return std::move(base::storage_.value_);
+  }
+
+  template <class V>
+  constexpr T value_or(V&& v) const& { return *this ? **this : detail_::convert<T>(constexpr_forward<V>(v)); }
+
+  template <class V>
+  T value_or(V&& v) && { return *this ? std::move(**this) : detail_::convert<T>(std::forward<V>(v)); }
+
+  optional<T> to_optional() const& { return *this ? optional<T>(**this) : optional<T>(); }
+  optional<T> to_optional() && { return *this ? optional<T>(std::move(**this)) : optional<T>(); }
+
+# else
+
+  constexpr T const& operator*() const { return assert(initialized()), base::storage_.value_; }
+  T& operator*() { assert(initialized()); return base::storage_.value_; }
+
+  constexpr T const& value() const {
+    return accessible() ? base::storage_.value_ : (check_policy::fail(), base::storage_.value_);
+  }
+
+  T& value() {
+    if (!accessible()) check_policy::fail();
+    return base::storage_.value_;
+  }
+
+  template <class V>
+  constexpr T value_or(V&& v) const { return *this ? **this : detail_::convert<T>(constexpr_forward<V>(v)); }
+
+  optional<T> to_optional() const { return *this ? optional<T>(**this) : optional<T>(); }
+
+# endif
+};
+
+
+// comparisons: as for optional<T>, reasons are not compared
+template <class T, class R> constexpr bool operator==(const optional_with_reason<T, R>& x, const optional_with_reason<T, R>& y)
+{
+  return bool(x) != bool(y) ? false : bool(x) == false ? true : *x == *y;
+}
+
+template <class T, class R> constexpr bool operator!=(const optional_with_reason<T, R>& x, const optional_with_reason<T, R>& y)
+{
+  return !(x == y);
+}
+
+template <class T, class R> constexpr bool operator==(const optional_with_reason<T, R>& x, nullopt_t) noexcept
+{
+  return !x;
+}
+
+template <class T, class R> constexpr bool operator==(nullopt_t, const optional_with_reason<T, R>& x) noexcept
+{
+  return !x;
+}
+
+template <class T, class R> constexpr bool operator!=(const optional_with_reason<T, R>& x, nullopt_t) noexcept
+{
+  return bool(x);
+}
+
+template <class T, class R> constexpr bool operator!=(nullopt_t, const optional_with_reason<T, R>& x) noexcept
+{
+  return bool(x);
+}
+
+template <class T, class R> constexpr bool operator==(const optional_with_reason<T, R>& x, const T& v)
+{
+  return bool(x) ? *x == v : false;
+}
+
+template <class T, class R> constexpr bool operator==(const T& v, const optional_with_reason<T, R>& x)
+{
+  return bool(x) ? v == *x : false;
+}
+
+template <class T, class R> constexpr bool operator!=(const optional_with_reason<T, R>& x, const T& v)
+{
+  return bool(x) ? *x != v : true;
+}
+
+template <class T, class R> constexpr bool operator!=(const T& v, const optional_with_reason<T, R>& x)
+{
+  return bool(x) ? v != *x : true;
+}
+
+
+template <class T, class R>
+void swap(optional_with_reason<T, R>& x, optional_with_reason<T, R>& y) noexcept(noexcept(x.swap(y)))
+{
+  x.swap(y);
+}
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___OPTIONAL_WITH_REASON_HPP___
@@ -0,0 +1,192 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___POLY_OPTIONAL_HPP___
+# define ___POLY_OPTIONAL_HPP___
+
+# include "optional.hpp"
+# include <cstddef>
+
+namespace std{
+
+namespace experimental{
+
+namespace detail_
+{
+
+// what poly_optional needs to know about the dynamic type of its object
+template <class Base>
+struct poly_ops
+{
+  Base* (*relocate)(void* dst, void* src) noexcept; // move-constructs at dst, destroys src; returns the Base at dst
+  void (*destroy)(void* p) noexcept;
+};
+
+template <class Base, class D>
+struct poly_ops_for
+{
+  static Base* relocate(void* dst, void* src) noexcept
+  {
+    D* s = static_cast<D*>(src);
+    D* d = ::new (dst) D(std::move(*s));
+    s->D::~D();
+    return d;
+  }
+
+  static void destroy(void* p) noexcept { static_cast<D*>(p)->D::~D(); }
+
+  static const poly_ops<Base> table;
+};
+
+template <class Base, class D>
+const poly_ops<Base> poly_ops_for<Base, D>::table = { &relocate, &destroy };
+
+} // namespace detail_
+
+
+// poly_optional<Base, Capacity, Align>: an optional object of any type derived from Base
+// that fits in Capacity bytes aligned to Align, stored inline. It replaces a nullable
+// unique_ptr<Base> without the allocation: operator-> returns the Base* of the contained
+// object, kept next to the storage, so a virtual call goes through the object's own vptr
+// only. Moves relocate the object through a two-entry table of its dynamic type; the object
+// must be nothrow move constructible. poly_optional is not copyable.
+template <class Base, size_t Capacity = 4 * sizeof(void*), size_t Align = alignof(void*)>
+class poly_optional
+{
+  static_assert( !std::is_reference<Base>::value, "bad Base" );
+  static_assert( Capacity > 0, "bad Capacity" );
+
+  alignas(Align) unsigned char storage_[Capacity];
+  Base* ptr_;                                 // into storage_, or nullptr when disengaged
+  const detail_::poly_ops<Base>* ops_;
+
+  void clear() noexcept
+  {
+    if (ops_) {
+      ops_->destroy(storage_);
+      ptr_ = nullptr;
+      ops_ = nullptr;
+    }
+  }
+
+  void take(poly_optional& rhs) noexcept
+  {
+    if (rhs.ops_) {
+      ptr_ = rhs.ops_->relocate(storage_, rhs.storage_);
+      ops_ = rhs.ops_;
+      rhs.ptr_ = nullptr;
+      rhs.ops_ = nullptr;
+    }
+  }
+
+public:
+  typedef Base base_type;
+
+  // true if a D can be stored
+  template <class D>
+  constexpr static bool can_hold() noexcept
+  {
+    return is_base_of<Base, D>::value && sizeof(D) <= Capacity && Align % alignof(D) == 0
+        && is_nothrow_move_constructible<D>::value;
+  }
+
+  poly_optional() noexcept : ptr_(nullptr), ops_(nullptr) {}
+  poly_optional(nullopt_t) noexcept : ptr_(nullptr), ops_(nullptr) {}
+
+  template <class D, class DD = typename decay<D>::type, typename enable_if<is_base_of<Base, DD>::value, bool>::type = false>
+  poly_optional(D&& d) : ptr_(nullptr), ops_(nullptr)
+  {
+    emplace<DD>(std::forward<D>(d));
+  }
+
+  poly_optional(poly_optional&& rhs) noexcept : ptr_(nullptr), ops_(nullptr) { take(rhs); }
+
+  poly_optional& operator=(poly_optional&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      clear();
+      take(rhs);
+    }
+    return *this;
+  }
+
+  poly_optional& operator=(nullopt_t) noexcept { clear(); return *this; }
+
+  poly_optional(const poly_optional&) = delete;
+  poly_optional& operator=(const poly_optional&) = delete;
+
+  ~poly_optional() { clear(); }
+
+  // destroys the current object, if any, and constructs a D from args
+  template <class D, class... Args>
+  D& emplace(Args&&... args)
+  {
+    static_assert( is_base_of<Base, D>::value, "D must derive from Base" );
+    static_assert( sizeof(D) <= Capacity, "D does not fit in Capacity" );
+    static_assert( Align % alignof(D) == 0, "D needs a stricter alignment than Align" );
+    static_assert( is_nothrow_move_constructible<D>::value, "D must be nothrow move constructible" );
+    clear();
+    D* d = ::new (static_cast<void*>(storage_)) D(std::forward<Args>(args)...);
+    ptr_ = d;
+    ops_ = &detail_::poly_ops_for<Base, D>::table;
+    return *d;
+  }
+
+  void reset() noexcept { clear(); }
+
+  void swap(poly_optional& rhs) noexcept
+  {
+    poly_optional tmp(std::move(rhs));
+    rhs = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // observers
+  explicit operator bool() const noexcept { return ptr_ != nullptr; }
+  bool has_value() const noexcept { return ptr_ != nullptr; }
+
+  Base* get() noexcept { return ptr_; }
+  const Base* get() const noexcept { return ptr_; }
+
+  Base* operator->() { assert (ptr_); return ptr_; }
+  const Base* operator->() const { assert (ptr_); return ptr_; }
+
+  Base& operator*() { assert (ptr_); return *ptr_; }
+  const Base& operator*() const { assert (ptr_); return *ptr_; }
+};
+
+
+template <class B, size_t C, size_t A> bool operator==(const poly_optional<B, C, A>& x, nullopt_t) noexcept
+{
+  return !x;
+}
+
+template <class B, size_t C, size_t A> bool operator==(nullopt_t, const poly_optional<B, C, A>& x) noexcept
+{
+  return !x;
+}
+
+template <class B, size_t C, size_t A> bool operator!=(const poly_optional<B, C, A>& x, nullopt_t) noexcept
+{
+  return bool(x);
+}
+
+template <class B, size_t C, size_t A> bool operator!=(nullopt_t, const poly_optional<B, C, A>& x) noexcept
+{
+  return bool(x);
+}
+
+template <class B, size_t C, size_t A>
+void swap(poly_optional<B, C, A>& x, poly_optional<B, C, A>& y) noexcept
+{
+  x.swap(y);
+}
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___POLY_OPTIONAL_HPP___
@@ -0,0 +1,251 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___RCU_OPTIONAL_HPP___
+# define ___RCU_OPTIONAL_HPP___
+
+# include "optional.hpp"
+# include <atomic>
+# include <cstdint>
+# include <mutex>
+# include <vector>
+
+namespace std{
+
+namespace experimental{
+
+namespace detail_
+{
+
+// Epoch-based reclamation shared by all rcu_optional objects.
+//
+// A reader announces the global epoch it saw when it enters its outermost read-side
+// section, and announces 0 (quiescent) when it leaves. A writer first unlinks the old
+// version, then bumps the global epoch and tags the old version with the epoch it
+// replaced. A reader that announced a later epoch started after the unlink and cannot
+// see the old version, so a version tagged r is freed once every active reader has
+// announced an epoch greater than r.
+struct rcu_thread_record
+{
+  std::atomic<uint64_t> epoch;  // 0 while outside any read-side section
+  unsigned nesting;             // touched only by the owning thread
+  rcu_thread_record* next;
+
+  rcu_thread_record() noexcept : epoch(0), nesting(0), next(nullptr) {}
+};
+
+class rcu_domain
+{
+  struct retired
+  {
+    uint64_t epoch;
+    void* ptr;
+    void (*deleter)(void*);
+  };
+
+  std::atomic<uint64_t> epoch_;
+  std::mutex mutex_;              // guards readers_ and retired_; taken by writers and at thread start/exit
+  rcu_thread_record* readers_;
+  std::vector<retired> retired_;
+
+  rcu_domain() : epoch_(1), readers_(nullptr) {}
+
+  // this thread's record, registered on first use and unregistered at thread exit
+  struct thread_handle
+  {
+    rcu_thread_record* rec;
+
+    thread_handle() : rec(new rcu_thread_record)
+    {
+      rcu_domain& d = get();
+      std::lock_guard<std::mutex> lock(d.mutex_);
+      rec->next = d.readers_;
+      d.readers_ = rec;
+    }
+
+    ~thread_handle()
+    {
+      rcu_domain& d = get();
+      {
+        std::lock_guard<std::mutex> lock(d.mutex_);
+        for (rcu_thread_record** p = &d.readers_; *p; p = &(*p)->next)
+          if (*p == rec) { *p = rec->next; break; }
+      }
+      delete rec;
+    }
+  };
+
+  // frees what no reader can see anymore; returns the retired objects, to be deleted outside the lock
+  std::vector<retired> collect_locked()
+  {
+    uint64_t oldest = UINT64_MAX;
+    for (rcu_thread_record* r = readers_; r; r = r->next) {
+      uint64_t e = r->epoch.load(memory_order_seq_cst);
+      if (e != 0 && e < oldest) oldest = e;
+    }
+    std::vector<retired> dead;
+    size_t kept = 0;
+    for (size_t i = 0; i != retired_.size(); ++i) {
+      if (retired_[i].epoch < oldest) dead.push_back(retired_[i]);
+      else retired_[kept++] = retired_[i];
+    }
+    retired_.resize(kept);
+    return dead;
+  }
+
+  static void destroy(const std::vector<retired>& dead)
+  {
+    for (const retired& r : dead) r.deleter(r.ptr);
+  }
+
+public:
+  // leaked, so that it outlives the thread_local handles and any static rcu_optional
+  static rcu_domain& get()
+  {
+    static rcu_domain& d = *new rcu_domain;
+    return d;
+  }
+
+  static rcu_thread_record& this_thread()
+  {
+    static thread_local thread_handle h;
+    return *h.rec;
+  }
+
+  static void read_lock() noexcept
+  {
+    rcu_thread_record& r = this_thread();
+    // seq_cst, like the writer's side: either the writer sees this announcement, or this reader sees the unlink
+    if (r.nesting++ == 0)
+      r.epoch.exchange(get().epoch_.load(memory_order_seq_cst), memory_order_seq_cst);
+  }
+
+  static void read_unlock() noexcept
+  {
+    rcu_thread_record& r = this_thread();
+    if (--r.nesting == 0)
+      r.epoch.store(0, memory_order_release);
+  }
+
+  // called after p has been unlinked; p is deleted once no reader can hold it
+  void retire(void* p, void (*deleter)(void*))
+  {
+    std::vector<retired> dead;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      retired_.push_back(retired{epoch_.fetch_add(1, memory_order_seq_cst), p, deleter});
+      dead = collect_locked();
+    }
+    destroy(dead);
+  }
+
+  // frees the retired objects that have become unreachable; returns how many remain
+  size_t reclaim()
+  {
+    std::vector<retired> dead;
+    size_t left;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      epoch_.fetch_add(1, memory_order_seq_cst);
+      dead = collect_locked();
+      left = retired_.size();
+    }
+    destroy(dead);
+    return left;
+  }
+};
+
+} // namespace detail_
+
+
+template <class T> class rcu_optional;
+
+// a read-side critical section over one rcu_optional: the version seen on entry stays alive
+// until the snapshot is destroyed. Must be destroyed by the thread that created it.
+template <class T>
+class rcu_snapshot
+{
+  optional<const T&> value_;
+  bool active_;
+
+  friend class rcu_optional<T>;
+  explicit rcu_snapshot(const std::atomic<const T*>& p) noexcept : active_(true)
+  {
+    detail_::rcu_domain::read_lock();
+    if (const T* v = p.load(memory_order_seq_cst)) value_.emplace(*v);
+  }
+
+public:
+  rcu_snapshot(rcu_snapshot&& rhs) noexcept : value_(rhs.value_), active_(rhs.active_) { rhs.active_ = false; }
+  rcu_snapshot(const rcu_snapshot&) = delete;
+  rcu_snapshot& operator=(const rcu_snapshot&) = delete;
+
+  ~rcu_snapshot() { if (active_) detail_::rcu_domain::read_unlock(); }
+
+  const optional<const T&>& get() const noexcept { return value_; }
+
+  explicit operator bool() const noexcept { return bool(value_); }
+  bool has_value() const noexcept { return value_.has_value(); }
+  const T& operator*() const { return *value_; }
+  const T* operator->() const { return value_.operator->(); }
+  const T& value() const { return value_.value(); }
+};
+
+
+// rcu_optional<T>: an optional<T> shared between threads, for payloads too large or
+// non-trivial to copy. Readers take a snapshot without locking and without touching
+// reference counts; writers publish a new version (or nullopt) and the old one is
+// destroyed after every reader that could have seen it has finished.
+template <class T>
+class rcu_optional
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, nullopt_t>::value, "bad T" );
+  static_assert( !std::is_same<typename std::decay<T>::type, in_place_t>::value, "bad T" );
+
+  std::atomic<const T*> ptr_;
+
+  static void deleter(void* p) { delete static_cast<const T*>(p); }
+
+  void publish(const T* p)
+  {
+    if (const T* old = ptr_.exchange(p, memory_order_seq_cst))
+      detail_::rcu_domain::get().retire(const_cast<T*>(old), &deleter);
+  }
+
+public:
+  typedef T value_type;
+
+  rcu_optional() noexcept : ptr_(nullptr) {}
+  rcu_optional(nullopt_t) noexcept : ptr_(nullptr) {}
+
+  template <class... Args>
+  explicit rcu_optional(in_place_t, Args&&... args) : ptr_(new T(std::forward<Args>(args)...)) {}
+
+  rcu_optional(const rcu_optional&) = delete;
+  rcu_optional& operator=(const rcu_optional&) = delete;
+
+  // the caller guarantees that there are no snapshots left
+  ~rcu_optional() { delete ptr_.load(memory_order_relaxed); }
+
+  rcu_snapshot<T> read() const noexcept { return rcu_snapshot<T>(ptr_); }
+
+  template <class... Args>
+  void emplace(Args&&... args) { publish(new T(std::forward<Args>(args)...)); }
+
+  void reset() { publish(nullptr); }
+
+  rcu_optional& operator=(nullopt_t) { reset(); return *this; }
+
+  // tries to free the versions that have become unreachable; returns the number still waiting
+  static size_t reclaim() { return detail_::rcu_domain::get().reclaim(); }
+};
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___RCU_OPTIONAL_HPP___
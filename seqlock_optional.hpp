@@ -0,0 +1,79 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___SEQLOCK_OPTIONAL_HPP___
+# define ___SEQLOCK_OPTIONAL_HPP___
+
+# include "optional.hpp"
+# include "optional_seqlock.hpp"
+# include <atomic>
+# include <cstdint>
+
+namespace std{
+
+namespace experimental{
+
+// seqlock_optional<T>: an optional<T> for values that are read far more often than written.
+// Readers never write shared memory: they copy the flag and the value and retry if a writer
+// overlapped, so they do not contend on a lock's cache line (bench_optional's readers_one_writer
+// runs 1 to 64 of them against a shared_mutex). Writers are serialized among themselves.
+// T must be trivially copyable.
+template <class T>
+class seqlock_optional
+{
+  static_assert( is_trivially_copyable<T>::value, "seqlock_optional requires a trivially copyable T" );
+  static_assert( !is_const<T>::value && !is_volatile<T>::value, "bad T" );
+
+  // the value is kept in relaxed atomic words so that racing reads are not data races
+  typedef uintptr_t word;
+  constexpr static size_t words = (sizeof(T) + sizeof(word) - 1) / sizeof(word);
+
+  std::atomic<uint32_t> seq_;        // odd while a write is in progress
+  std::atomic<bool> engaged_;
+  std::atomic<word> value_[words];
+
+  void write(const T* v) noexcept { detail_::seqlock_write(seq_, engaged_, value_, v); }
+
+public:
+  typedef T value_type;
+
+  seqlock_optional() noexcept : seq_(0), engaged_(false) {}
+  seqlock_optional(nullopt_t) noexcept : seqlock_optional() {}
+  seqlock_optional(const T& v) noexcept : seqlock_optional() { write(std::addressof(v)); }
+
+  seqlock_optional(const seqlock_optional&) = delete;
+  seqlock_optional& operator=(const seqlock_optional&) = delete;
+
+  // a consistent copy of the flag and the value
+  optional<T> load() const noexcept
+  {
+    optional<T> ans;
+    detail_::seqlock_read(seq_, engaged_, value_, ans);
+    return ans;
+  }
+
+  bool has_value() const noexcept { return engaged_.load(memory_order_acquire); }
+
+  void store(const optional<T>& o) noexcept { write(o ? std::addressof(*o) : nullptr); }
+
+  template <class... Args>
+  void emplace(Args&&... args) noexcept(noexcept(T(std::forward<Args>(args)...)))
+  {
+    const T v(std::forward<Args>(args)...);
+    write(std::addressof(v));
+  }
+
+  void reset() noexcept { write(nullptr); }
+};
+
+template <class T>
+constexpr size_t seqlock_optional<T>::words;
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___SEQLOCK_OPTIONAL_HPP___
@@ -0,0 +1,181 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___SHM_OPTIONAL_HPP___
+# define ___SHM_OPTIONAL_HPP___
+
+# include "optional.hpp"
+# include "optional_seqlock.hpp"
+# include <atomic>
+# include <cstdint>
+# include <thread>
+
+namespace std{
+
+namespace experimental{
+
+// Optional values in memory shared between processes (mmap, shm_open, memfd).
+//
+// shm_optional<T> has a fixed layout, independent of the compiler and of optional<T>:
+//
+//   offset 0   uint32  version   even: stable, odd: a write is in progress; bumped by 2 per write
+//   offset 4   uint32  engaged   0 or 1
+//   offset 8   T       payload   padded to a multiple of 8 bytes
+//
+// aligned to 8 bytes. All words are accessed through lock-free (hence address-free) atomics,
+// so readers and writers may live in different processes. Readers copy the payload and retry
+// if the version changed (a seqlock, optional_seqlock.hpp); writers serialize on the version
+// word. All-zero memory is a valid disengaged cell, so freshly mapped memory needs no
+// initialization beyond attach(). T must be trivially copyable and must not contain pointers
+// into either process.
+//
+// A process that dies in the middle of a write leaves the version odd, and the cell wedged:
+// load() and every later writer, in every process, then wait forever. Nothing in the cell can
+// tell a dead writer from a slow one, so it is not repaired; try_load() reports it instead, and
+// the processes have to zero-fill the region again (or map a new one) before using it.
+template <class T>
+class shm_optional
+{
+  static_assert( is_trivially_copyable<T>::value, "shm_optional requires a trivially copyable T" );
+  static_assert( alignof(T) <= 8, "shm_optional supports alignment up to 8" );
+  static_assert( ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "process-shared atomics must be lock-free" );
+
+  constexpr static size_t words = (sizeof(T) + 7) / 8;
+
+  std::atomic<uint32_t> version_;
+  std::atomic<uint32_t> engaged_;
+  std::atomic<uint64_t> payload_[words];
+
+  void write(const T* v) noexcept { detail_::seqlock_write(version_, engaged_, payload_, v); }
+
+public:
+  typedef T value_type;
+
+  shm_optional() = delete; // only ever placed over shared memory, see attach()
+  shm_optional(const shm_optional&) = delete;
+  shm_optional& operator=(const shm_optional&) = delete;
+
+  constexpr static size_t required_bytes() noexcept { return 8 + 8 * words; }
+  constexpr static size_t required_alignment() noexcept { return 8; }
+
+  // the cell at mem, which is either zero-filled or was attached to by another process;
+  // writes nothing
+  static shm_optional* attach(void* mem) noexcept
+  {
+    assert (reinterpret_cast<uintptr_t>(mem) % required_alignment() == 0);
+    return static_cast<shm_optional*>(mem);
+  }
+
+  // waits while a write is in progress, forever if its writer died in it
+  optional<T> load() const noexcept
+  {
+    optional<T> ans;
+    detail_::seqlock_read(version_, engaged_, payload_, ans);
+    return ans;
+  }
+
+  // load() that gives up after max_spins checks of a write in progress in a row, returning
+  // false: the cell may be wedged by a writer that died mid-write
+  bool try_load(optional<T>& out, size_t max_spins) const noexcept
+  {
+    return detail_::seqlock_read(version_, engaged_, payload_, out, max_spins);
+  }
+
+  bool has_value() const noexcept { return engaged_.load(memory_order_acquire) != 0; }
+
+  // changes with every completed write; lets a reader tell whether anything was published
+  uint32_t version() const noexcept { return version_.load(memory_order_acquire) & ~uint32_t(1); }
+
+  void store(const optional<T>& o) noexcept { write(o ? std::addressof(*o) : nullptr); }
+
+  template <class... Args>
+  void emplace(Args&&... args) noexcept(noexcept(T(std::forward<Args>(args)...)))
+  {
+    const T v(std::forward<Args>(args)...);
+    write(std::addressof(v));
+  }
+
+  void reset() noexcept { write(nullptr); }
+};
+
+template <class T>
+constexpr size_t shm_optional<T>::words;
+
+
+// shm_optional_array<T>: a fixed number of shm_optional<T> cells behind a 16-byte header:
+//
+//   offset 0   uint32  magic         0 in fresh memory, 1 while being initialized, then 'OPTA'
+//   offset 4   uint32  element_size  shm_optional<T>::required_bytes()
+//   offset 8   uint64  size          number of cells
+//   offset 16  cells
+//
+// The first process to call init() on zero-filled memory writes the header; the others wait
+// for it and check that it describes the same T and size. If the first one dies while the
+// magic is 'initializing', the others wait forever unless they pass max_spins, after which
+// init() gives up and returns nullptr; the region then has to be zero-filled again.
+template <class T>
+class shm_optional_array
+{
+  enum : uint32_t { fresh = 0, initializing = 1, magic = 0x4f505441 }; // 'OPTA'
+
+  std::atomic<uint32_t> magic_;
+  std::atomic<uint32_t> element_size_;
+  std::atomic<uint64_t> size_;
+
+  shm_optional<T>* cells() noexcept
+  {
+    return reinterpret_cast<shm_optional<T>*>(reinterpret_cast<unsigned char*>(this) + 16);
+  }
+
+  const shm_optional<T>* cells() const noexcept
+  {
+    return reinterpret_cast<const shm_optional<T>*>(reinterpret_cast<const unsigned char*>(this) + 16);
+  }
+
+public:
+  typedef T value_type;
+
+  shm_optional_array() = delete; // only ever placed over shared memory, see init()
+  shm_optional_array(const shm_optional_array&) = delete;
+  shm_optional_array& operator=(const shm_optional_array&) = delete;
+
+  constexpr static size_t required_bytes(size_t n) noexcept { return 16 + n * shm_optional<T>::required_bytes(); }
+  constexpr static size_t required_alignment() noexcept { return 8; }
+
+  // the array at mem, initializing the header if mem is fresh, zero-filled memory;
+  // returns nullptr if mem already holds an array of a different layout, or if another
+  // process was initializing it through max_spins checks
+  static shm_optional_array* init(void* mem, size_t n, size_t max_spins = size_t(-1)) noexcept
+  {
+    assert (reinterpret_cast<uintptr_t>(mem) % required_alignment() == 0);
+    shm_optional_array* a = static_cast<shm_optional_array*>(mem);
+    uint32_t m = fresh;
+    if (a->magic_.compare_exchange_strong(m, initializing, memory_order_acquire)) {
+      a->element_size_.store(uint32_t(shm_optional<T>::required_bytes()), memory_order_relaxed);
+      a->size_.store(n, memory_order_relaxed);
+      a->magic_.store(magic, memory_order_release);
+      return a;
+    }
+    for (size_t spins = 0; (m = a->magic_.load(memory_order_acquire)) == initializing; std::this_thread::yield())
+      if (++spins == max_spins) return nullptr;
+    if (m != magic
+        || a->element_size_.load(memory_order_relaxed) != shm_optional<T>::required_bytes()
+        || a->size_.load(memory_order_relaxed) != n)
+      return nullptr;
+    return a;
+  }
+
+  size_t size() const noexcept { return size_t(size_.load(memory_order_relaxed)); }
+
+  shm_optional<T>& operator[](size_t i) noexcept { assert (i < size()); return cells()[i]; }
+  const shm_optional<T>& operator[](size_t i) const noexcept { assert (i < size()); return cells()[i]; }
+};
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___SHM_OPTIONAL_HPP___
@@ -0,0 +1,82 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___TEST_ALLOC_HPP___
+# define ___TEST_ALLOC_HPP___
+
+// Support for the tests and benchmarks: replaces the global operator new and delete so that
+// a program can count its heap allocations. Include it in one translation unit of a program.
+// The counters are shared by all threads.
+
+# include <atomic>
+# include <cassert>
+# include <cstddef>
+# include <cstdlib>
+# include <new>
+# include <stdlib.h> // posix_memalign
+
+std::atomic<long> allocations(0);   // calls of operator new, of any form
+std::atomic<long> deallocations(0); // calls of operator delete with a non-null pointer
+
+namespace test_alloc_detail
+{
+  inline void* allocate(size_t n, size_t align)
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (align <= alignof(std::max_align_t)) p = std::malloc(n ? n : 1);
+    else if (posix_memalign(&p, align, n ? n : 1) != 0) p = nullptr;
+    if (p) return p;
+# if defined __cpp_exceptions || defined __EXCEPTIONS
+    throw std::bad_alloc();
+# else
+    std::abort();
+# endif
+  }
+
+  inline void deallocate(void* p) noexcept
+  {
+    if (p) deallocations.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+  }
+}
+
+void* operator new(size_t n) { return test_alloc_detail::allocate(n, 0); }
+void* operator new[](size_t n) { return test_alloc_detail::allocate(n, 0); }
+void operator delete(void* p) noexcept { test_alloc_detail::deallocate(p); }
+void operator delete[](void* p) noexcept { test_alloc_detail::deallocate(p); }
+void operator delete(void* p, size_t) noexcept { test_alloc_detail::deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { test_alloc_detail::deallocate(p); }
+
+# if defined __cpp_aligned_new
+void* operator new(size_t n, std::align_val_t a) { return test_alloc_detail::allocate(n, size_t(a)); }
+void* operator new[](size_t n, std::align_val_t a) { return test_alloc_detail::allocate(n, size_t(a)); }
+void operator delete(void* p, std::align_val_t) noexcept { test_alloc_detail::deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { test_alloc_detail::deallocate(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { test_alloc_detail::deallocate(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { test_alloc_detail::deallocate(p); }
+# endif
+
+
+// the number of allocations made while f runs
+template <class F>
+long count_allocations(F&& f)
+{
+  long before = allocations.load();
+  f();
+  return allocations.load() - before;
+}
+
+// asserts that f does not allocate
+template <class F>
+void expect_no_alloc(F&& f)
+{
+  long n = count_allocations(f);
+  assert (n == 0);
+  (void)n;
+}
+
+# endif //___TEST_ALLOC_HPP___
@@ -0,0 +1,204 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "atomic_optional.hpp"
+# include <thread>
+# include <vector>
+# include <cstring>
+# include <iostream>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Pair { int a, b; };                         // 9 bytes with the flag: double word or spinlock
+struct Big { long long v[4]; };                    // never fits: spinlock
+struct Ticket { unsigned long long id; };          // 8 bytes, but id ~0 is never issued: niche word
+
+namespace std { namespace experimental {
+  template <> struct atomic_optional_niche<Ticket> : true_type { static Ticket niche() noexcept { return Ticket{~0ull}; } };
+}}
+
+typedef tr2::atomic_optional_implementation impl;
+
+static_assert(tr2::atomic_optional<int>::is_always_lock_free, "int must be packed in a word");
+static_assert(tr2::atomic_optional<short>::is_always_lock_free, "short must be packed in a word");
+static_assert(tr2::atomic_optional<int>::implementation == impl::packed_word, "int must be packed in a word");
+static_assert(!tr2::atomic_optional<Big>::is_always_lock_free, "Big cannot be lock-free");
+static_assert(tr2::atomic_optional<Big>::implementation == impl::spinlock, "Big cannot be lock-free");
+static_assert(tr2::atomic_optional<Ticket>::is_always_lock_free, "Ticket must use its niche");
+static_assert(tr2::atomic_optional<Ticket>::implementation == impl::niche_word, "Ticket must use its niche");
+static_assert(sizeof(tr2::atomic_optional<Ticket>) == sizeof(Ticket), "Ticket must use its niche");
+# if OPTIONAL_HAS_DOUBLE_WORD_CAS
+static_assert(tr2::atomic_optional<Pair>::is_always_lock_free, "Pair must use the double-word CAS");
+static_assert(tr2::atomic_optional<long long>::is_always_lock_free, "long long must use the double-word CAS");
+static_assert(tr2::atomic_optional<long long>::implementation == impl::double_word, "long long must use the double-word CAS");
+# else
+static_assert(tr2::atomic_optional<long long>::implementation == impl::spinlock, "long long needs the double-word CAS");
+# endif
+
+
+template <class T, class Make>
+void basic_semantics(Make make)
+{
+  tr2::atomic_optional<T> a;
+  assert (!a.load());
+
+  a.store(make(1));
+  assert (a.load());
+  assert (make(1) == *a.load());
+
+  tr2::optional<T> old = a.exchange(make(2));
+  assert (old && make(1) == *old);
+  assert (make(2) == *a.load());
+
+  tr2::optional<T> e = make(3);
+  assert (!a.compare_exchange_strong(e, make(4)));
+  assert (e && make(2) == *e);                      // expected is updated on failure
+  assert (a.compare_exchange_strong(e, make(4)));
+  assert (make(4) == *a.load());
+
+  assert (!a.emplace_if_empty(make(5)));
+  assert (make(4) == *a.load());
+
+  a.reset();
+  assert (!a.load());
+  assert (a.exchange(tr2::nullopt) == tr2::nullopt);
+
+  assert (a.emplace_if_empty(make(6)));
+  assert (make(6) == *a.load());
+
+  e = tr2::nullopt;
+  while (!a.compare_exchange_weak(e, tr2::nullopt)) {}
+  assert (!a.load());
+
+  tr2::atomic_optional<T> b {make(7)};
+  assert (make(7) == *b.load());
+}
+
+bool operator==(Pair x, Pair y) { return x.a == y.a && x.b == y.b; }
+bool operator==(const Big& x, const Big& y) { return x.v[0] == y.v[0] && x.v[3] == y.v[3]; }
+bool operator==(Ticket x, Ticket y) { return x.id == y.id; }
+
+TEST(atomic_optional_semantics)
+{
+  basic_semantics<int>([](int i) { return i; });
+  basic_semantics<char>([](int i) { return char(i); });
+  basic_semantics<long long>([](int i) { return (long long)i << 40; });
+  basic_semantics<Pair>([](int i) { return Pair{i, -i}; });
+  basic_semantics<Big>([](int i) { return Big{{i, 0, 0, i}}; });
+  basic_semantics<Ticket>([](int i) { return Ticket{(unsigned long long)i << 40}; });
+};
+
+
+TEST(atomic_optional_niche)
+{
+  tr2::atomic_optional<Ticket> a;
+  assert (a.is_lock_free());
+  assert (!a.load());
+  a.store(Ticket{0});                                      // all-zero is a value here
+  assert (a.load() && a.load()->id == 0);
+  a.store(Ticket{~0ull - 1});
+  assert (a.load()->id == ~0ull - 1);
+  a.reset();
+  assert (!a.load());
+};
+
+
+TEST(atomic_optional_zero_is_not_empty)
+{
+  tr2::atomic_optional<int> a {0};
+  assert (a.load());
+  assert (*a.load() == 0);
+  assert (!a.emplace_if_empty(1));
+};
+
+
+// equal values whose padding differs: compare_exchange must not see them as different
+struct Padded { char c; short s; };                // a padding byte after c
+struct PaddedBig { char c; long long v[3]; };      // seven after c: spinlock
+
+template <class T, class Fill>
+void padding_is_not_compared(Fill fill)
+{
+  tr2::optional<T> a(tr2::in_place), b(tr2::in_place);
+  std::memset(std::addressof(*a), 0x00, sizeof(T));
+  std::memset(std::addressof(*b), 0xff, sizeof(T));
+  fill(*a);                                               // member by member: the padding stays
+  fill(*b);
+
+  tr2::atomic_optional<T> ao(a);
+  tr2::optional<T> e = b;
+  assert (ao.compare_exchange_strong(e, tr2::nullopt));
+  assert (!ao.load());
+}
+
+# if OPTIONAL_HAS_CLEAR_PADDING
+TEST(atomic_optional_ignores_padding)
+{
+  padding_is_not_compared<Padded>([](Padded& p) { p.c = 'a'; p.s = 7; });
+  padding_is_not_compared<PaddedBig>([](PaddedBig& p) { p.c = 'b'; p.v[0] = 1; p.v[1] = 2; p.v[2] = 3; });
+};
+# endif
+
+
+template <class T>
+void contended_increments()
+{
+  const int threads = 4, iterations = 20000;
+  tr2::atomic_optional<T> a;
+  std::vector<std::thread> ts;
+
+  for (int t = 0; t < threads; ++t)
+    ts.emplace_back([&] {
+      for (int i = 0; i < iterations; ++i) {
+        tr2::optional<T> e = a.load(std::memory_order_relaxed);
+        while (!a.compare_exchange_weak(e, T(e ? *e + 1 : 1))) {}
+      }
+    });
+  for (auto& t : ts) t.join();
+
+  assert (a.load());
+  assert (*a.load() == T(threads * iterations));
+}
+
+TEST(atomic_optional_contention)
+{
+  contended_increments<int>();
+  contended_increments<long long>();
+};
+
+
+TEST(atomic_optional_emplace_if_empty_race)
+{
+  const int threads = 4;
+  tr2::atomic_optional<int> a;
+  std::atomic<int> winners{0};
+  std::vector<std::thread> ts;
+
+  for (int t = 0; t < threads; ++t)
+    ts.emplace_back([&, t] { if (a.emplace_if_empty(t)) ++winners; });
+  for (auto& t : ts) t.join();
+
+  assert (winners == 1);
+  assert (a.load());
+};
+
+
+int main()
+{
+  if (OPTIONAL_HAS_DOUBLE_WORD_CAS)
+    std::cout << "atomic_optional uses a double-word CAS for values up to 15 bytes" << std::endl;
+  else
+    std::cout << "atomic_optional uses a spinlock for values over 7 bytes without a niche" << std::endl;
+}
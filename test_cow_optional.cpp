@@ -0,0 +1,156 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "cow_optional.hpp"
+# include <string>
+# include <thread>
+# include <vector>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct BigConfig
+{
+  static int copies, alive;
+
+  std::vector<int> table;
+  std::string name;
+
+  BigConfig(size_t n, std::string s) : table(n, 1), name(std::move(s)) { ++alive; }
+  BigConfig(const BigConfig& r) : table(r.table), name(r.name) { ++copies; ++alive; }
+  BigConfig& operator=(const BigConfig&) = default;
+  ~BigConfig() { --alive; }
+
+  bool operator==(const BigConfig& r) const { return table == r.table && name == r.name; }
+  bool operator!=(const BigConfig& r) const { return !(*this == r); }
+};
+
+int BigConfig::copies = 0;
+int BigConfig::alive = 0;
+
+static_assert(sizeof(tr2::cow_optional<BigConfig>) == sizeof(void*), "bad size");
+static_assert(sizeof(tr2::cow_optional<BigConfig, tr2::cow_single_thread_policy>) == sizeof(void*), "bad size");
+
+typedef tr2::cow_optional<BigConfig, tr2::cow_single_thread_policy> Local;
+typedef tr2::cow_optional<BigConfig> Shared;
+
+size_t by_value(Local c, int depth)
+{
+  return depth == 0 ? c.cref().table.size() : by_value(c, depth - 1);
+}
+
+
+TEST(cow_empty)
+{
+  Local o;
+  assert (!o);
+  assert (o == tr2::nullopt);
+  assert (o.use_count() == 0);
+  assert (o.value_or(BigConfig(1, "d")).name == "d");
+  bool thrown = false;
+  try { (void)o.value(); }
+  catch (const tr2::bad_optional_access&) { thrown = true; }
+  assert (thrown);
+};
+
+
+TEST(cow_copies_share)
+{
+  BigConfig::copies = 0;
+  Local a {tr2::in_place, 1000, "cfg"};
+  assert (by_value(a, 20) == 1000);
+  assert (BigConfig::copies == 0);
+
+  Local b = a;
+  const Local& cb = b;
+  assert (shares_payload(a, b));
+  assert (a.use_count() == 2);
+  assert (cb->name == "cfg" && (*cb).table.size() == 1000 && cb.value().name == "cfg");
+  assert (a == b);
+  assert (BigConfig::copies == 0);
+};
+
+
+TEST(cow_clone_on_write)
+{
+  BigConfig::copies = 0;
+  Local a {tr2::in_place, 10, "a"};
+  Local b = a;
+
+  b->name = "b";                       // clones
+  assert (BigConfig::copies == 1);
+  assert (!shares_payload(a, b));
+  assert (a->name == "a" && b->name == "b"); // both now unique: no more clones
+  assert (a.use_count() == 1 && b.use_count() == 1);
+  (*b).table.push_back(2);
+  b.value().name = "b!";
+  assert (BigConfig::copies == 1);
+  assert (b.cref().name == "b!");
+  assert (a != b);
+};
+
+
+TEST(cow_emplace_and_assign)
+{
+  BigConfig::copies = 0;
+  BigConfig::alive = 0;
+  {
+    Local a {BigConfig(3, "x")};
+    Local b = a;
+    b.emplace(5, "y");                 // no clone of the old payload
+    assert (BigConfig::copies == 1);   // only the construction of a from a temporary
+    assert (a->name == "x" && b->name == "y");
+
+    b = a;
+    assert (shares_payload(a, b));
+    b = BigConfig(7, "z");             // shared: a new payload
+    assert (a->table.size() == 3 && b->table.size() == 7);
+    b = tr2::nullopt;
+    assert (!b && a);
+    a.reset();
+    assert (BigConfig::alive == 0);
+
+    tr2::optional<BigConfig> o = BigConfig(2, "o");
+    Local c {o};
+    assert (c == *o);
+    assert (c.to_optional() == o);
+    Local d = std::move(c);
+    assert (!c && d->name == "o");
+    swap(c, d);
+    assert (c && !d);
+  }
+  assert (BigConfig::alive == 0);
+};
+
+
+TEST(cow_atomic_policy_across_threads)
+{
+  BigConfig::copies = 0;
+  Shared s {tr2::in_place, 100, "shared"};
+  std::vector<std::thread> threads;
+  for (int t = 0; t != 4; ++t)
+    threads.emplace_back([s] {
+      for (int i = 0; i != 10000; ++i) {
+        Shared c = s;
+        const Shared& cc = c;
+        assert (cc->name == "shared");
+      }
+    });
+  for (std::thread& t : threads) t.join();
+  assert (s.use_count() == 1);
+  assert (BigConfig::copies == 0);
+};
+
+
+int main() { }
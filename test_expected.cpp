@@ -0,0 +1,238 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "expected.hpp"
+# include <string>
+# include <vector>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+enum class errc { none, empty, not_a_digit, overflow };
+
+// the layout and the triviality of optional
+static_assert(sizeof(tr2::expected<int, errc>) == sizeof(tr2::optional<int>), "bad layout");
+static_assert(sizeof(tr2::expected<double, int>) == sizeof(tr2::optional<double>), "bad layout");
+static_assert(std::is_trivially_destructible<tr2::expected<int, errc>>::value, "not trivial");
+static_assert(std::is_trivially_copy_constructible<tr2::expected<int, errc>>::value, "not trivial");
+static_assert(!std::is_trivially_destructible<tr2::expected<std::string, errc>>::value, "bad dtor");
+static_assert(!std::is_trivially_destructible<tr2::expected<int, std::string>>::value, "bad dtor");
+
+// constexpr construction and observation
+constexpr tr2::expected<int, errc> ce_val {7};
+constexpr tr2::expected<int, errc> ce_err {tr2::unexpect, errc::overflow};
+static_assert(ce_val.has_value() && *ce_val == 7 && ce_val.value() == 7, "bad constexpr");
+static_assert(!ce_err && ce_err.error() == errc::overflow, "bad constexpr");
+static_assert(ce_err.value_or(3) == 3, "bad constexpr");
+static_assert(ce_val == 7 && ce_err != 7, "bad constexpr");
+static_assert(ce_err == tr2::make_unexpected(errc::overflow), "bad constexpr");
+
+
+tr2::expected<int, errc> parse_digit(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  return tr2::make_unexpected(errc::not_a_digit);
+}
+
+tr2::expected<int, errc> parse(const std::string& s)
+{
+  if (s.empty()) return tr2::make_unexpected(errc::empty);
+  int r = 0;
+  for (char c : s) {
+    tr2::expected<int, errc> d = parse_digit(c);
+    if (!d) return tr2::make_unexpected(d.error());
+    if (r > 100000) return tr2::make_unexpected(errc::overflow);
+    r = r * 10 + *d;
+  }
+  return r;
+}
+
+
+TEST(expected_value_and_error)
+{
+  tr2::expected<int, errc> a = parse("123");
+  assert (a);
+  assert (a.has_value());
+  assert (*a == 123);
+  assert (a.value() == 123);
+
+  tr2::expected<int, errc> b = parse("1x3");
+  assert (!b);
+  assert (b.error() == errc::not_a_digit);
+  assert (b.value_or(-1) == -1);
+  assert (parse("").error() == errc::empty);
+  assert (parse("99999999").error() == errc::overflow);
+};
+
+
+TEST(expected_value_throws_with_the_error)
+{
+  tr2::expected<int, errc> e = parse("x");
+  bool caught = false;
+  try { (void)e.value(); }
+  catch (const tr2::bad_expected_access<errc>& ex) { caught = (ex.error() == errc::not_a_digit); }
+  assert (caught);
+};
+
+
+TEST(expected_nontrivial)
+{
+  typedef tr2::expected<std::string, std::string> X;
+  X v {"value"};
+  X e {tr2::unexpect, "error"};
+  X c = v;
+  assert (c == v);
+  c = e;
+  assert (!c && c.error() == "error");
+  c = std::string("back");
+  assert (c && *c == "back");
+  c = tr2::make_unexpected(std::string("again"));
+  assert (c.error() == "again");
+  assert (c.emplace(3, 'x') == "xxx");
+  assert (c == std::string("xxx"));
+
+  X m = std::move(c);
+  assert (*m == "xxx");
+  std::string s = std::move(m).value();
+  assert (s == "xxx");
+};
+
+
+// trivially destructible, but copied and moved by hand: expected must not take the
+// trivially copyable layout
+struct HandCopied
+{
+  static int copies;
+  int v;
+  explicit HandCopied(int v) : v(v) {}
+  HandCopied(const HandCopied& h) : v(h.v) { ++copies; }
+};
+int HandCopied::copies = 0;
+
+static_assert(std::is_copy_constructible<tr2::expected<HandCopied, int>>::value, "not copyable");
+
+TEST(expected_copies_non_trivially_copyable)
+{
+  HandCopied::copies = 0;
+  tr2::expected<HandCopied, int> a(tr2::in_place, 4);
+  tr2::expected<HandCopied, int> b(a);
+  assert (b.value().v == 4);
+  assert (HandCopied::copies == 1);
+  tr2::expected<HandCopied, int> c(std::move(b));
+  assert (c->v == 4);
+
+  tr2::expected<int, HandCopied> e(tr2::unexpect, 5);
+  tr2::expected<int, HandCopied> f(e);
+  assert (f.error().v == 5);
+};
+
+
+TEST(expected_swap)
+{
+  typedef tr2::expected<std::vector<int>, std::string> X;
+  X a {std::vector<int>{1, 2}};
+  X b {tr2::unexpect, "no"};
+  swap(a, b);
+  assert (!a && a.error() == "no");
+  assert (b && b->size() == 2);
+  X c {std::vector<int>{3}};
+  b.swap(c);
+  assert (b->front() == 3 && c->size() == 2);
+};
+
+
+struct ThrowingCopy
+{
+  static bool fail;
+  int v;
+  explicit ThrowingCopy(int v) : v(v) {}
+  ThrowingCopy(const ThrowingCopy& r) : v(r.v) { if (fail) throw 1; }
+  ThrowingCopy(ThrowingCopy&& r) : v(r.v) { if (fail) throw 1; }
+  ThrowingCopy& operator=(const ThrowingCopy&) = default;
+};
+
+bool ThrowingCopy::fail = false;
+
+TEST(expected_assignment_is_strongly_exception_safe)
+{
+  typedef tr2::expected<ThrowingCopy, std::string> X;
+  X v {ThrowingCopy(1)};
+  X e {tr2::unexpect, "kept"};
+  ThrowingCopy::fail = true;
+  bool caught = false;
+  try { e = v; }
+  catch (int) { caught = true; }
+  ThrowingCopy::fail = false;
+  assert (caught);
+  assert (!e && e.error() == "kept");
+};
+
+
+TEST(expected_combinators)
+{
+  auto twice = [](int i) { return i * 2; };
+  auto checked_half = [](int i) -> tr2::expected<int, errc> {
+    if (i % 2) return tr2::make_unexpected(errc::overflow);
+    return i / 2;
+  };
+
+  assert (parse("21").transform(twice) == 42);
+  assert (parse("x").transform(twice).error() == errc::not_a_digit);
+  assert (parse("42").and_then(checked_half) == 21);
+  assert (parse("43").and_then(checked_half).error() == errc::overflow);
+  assert (parse("x").and_then(checked_half).error() == errc::not_a_digit);
+
+  auto recover = [](errc e) -> tr2::expected<int, errc> {
+    if (e == errc::empty) return 0;
+    return tr2::make_unexpected(e);
+  };
+  assert (parse("").or_else(recover) == 0);
+  assert (parse("5").or_else(recover) == 5);
+  assert (parse("x").or_else(recover).error() == errc::not_a_digit);
+
+  tr2::expected<int, std::string> t = parse("x").transform_error([](errc e) {
+    return e == errc::not_a_digit ? std::string("not a digit") : std::string("other");
+  });
+  assert (t.error() == "not a digit");
+
+  // rvalues are moved into the function
+  tr2::expected<std::string, errc> s {std::string(100, 'a')};
+  tr2::expected<size_t, errc> n = std::move(s).transform([](std::string&& str) {
+    std::string mine = std::move(str);
+    return mine.size();
+  });
+  assert (n == size_t(100));
+  assert (s->empty());
+};
+
+
+TEST(expected_optional_conversions)
+{
+  tr2::optional<int> o = parse("12").to_optional();
+  assert (o == 12);
+  assert (!parse("x").to_optional());
+
+  tr2::expected<int, errc> e = tr2::to_expected(tr2::optional<int>(5), errc::empty);
+  assert (e == 5);
+  tr2::expected<int, errc> f = tr2::to_expected(tr2::optional<int>(), errc::empty);
+  assert (f.error() == errc::empty);
+
+  tr2::optional<std::string> os = std::string("moved");
+  tr2::expected<std::string, int> es = tr2::to_expected(std::move(os), 0);
+  assert (*es == "moved");
+  assert ((tr2::expected<std::string, int>(es).to_optional() == std::string("moved")));
+};
+
+
+int main() { }
@@ -0,0 +1,129 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "once_optional.hpp"
+# include <thread>
+# include <vector>
+# include <string>
+# include <chrono>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Tracked
+{
+  static int alive;
+  std::string s;
+  explicit Tracked(std::string s) : s(s) { ++alive; }
+  ~Tracked() { --alive; }
+};
+int Tracked::alive = 0;
+
+
+TEST(once_optional_basic)
+{
+  {
+    tr2::once_optional<Tracked> o;
+    assert (!o);
+    assert (!o.get());
+
+    int calls = 0;
+    Tracked& t = o.get_or_init([&] { ++calls; return Tracked("one"); });
+    assert (t.s == "one");
+    assert (o.has_value());
+    assert (&*o.get() == &t);
+
+    Tracked& u = o.get_or_init([&] { ++calls; return Tracked("two"); });
+    assert (&u == &t);
+    assert (u.s == "one");
+    assert (calls == 1);
+    assert (Tracked::alive == 1);
+
+    const tr2::once_optional<Tracked>& co = o;
+    assert (co.get()->s == "one");
+
+    o.reset();
+    assert (!o);
+    assert (Tracked::alive == 0);
+    assert (o.get_or_init([] { return Tracked("three"); }).s == "three");
+  }
+  assert (Tracked::alive == 0);
+};
+
+
+TEST(once_optional_exception)
+{
+  tr2::once_optional<int> o;
+  try {
+    o.get_or_init([]() -> int { throw 1; });
+    assert (false);
+  }
+  catch (int) {}
+
+  assert (!o);
+  assert (o.get_or_init([] { return 2; }) == 2);
+};
+
+
+TEST(once_optional_concurrent_init)
+{
+  const int threads = 8;
+  tr2::once_optional<std::vector<int>> o;
+  std::atomic<int> calls{0};
+  std::vector<std::thread> ts;
+  std::vector<const std::vector<int>*> seen(threads);
+
+  for (int t = 0; t < threads; ++t)
+    ts.emplace_back([&, t] {
+      seen[t] = &o.get_or_init([&] {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20)); // make the others block
+        return std::vector<int>(100, 7);
+      });
+    });
+  for (auto& t : ts) t.join();
+
+  assert (calls == 1);
+  for (auto p : seen) assert (p == &*o.get());
+  assert (o.get()->size() == 100);
+};
+
+
+TEST(once_optional_concurrent_init_failure)
+{
+  const int threads = 4;
+  tr2::once_optional<int> o;
+  std::atomic<int> calls{0};
+  std::vector<std::thread> ts;
+
+  // the first initializer throws, one of the blocked threads must take over
+  for (int t = 0; t < threads; ++t)
+    ts.emplace_back([&] {
+      try {
+        o.get_or_init([&] {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+          if (calls++ == 0) throw 0;
+          return 5;
+        });
+      }
+      catch (int) {}
+    });
+  for (auto& t : ts) t.join();
+
+  assert (calls == 2);
+  assert (o.get() == 5);
+};
+
+
+int main() { }
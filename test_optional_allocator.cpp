@@ -0,0 +1,210 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Built twice: in the default mode, with a hand-written arena allocator, and in C++17,
+// where the std::pmr tests run too.
+
+# include "optional.hpp"
+# include "test_alloc.hpp"
+# include <cstdlib>
+# include <new>
+# include <string>
+# include <vector>
+
+# if (defined __cplusplus) && (__cplusplus >= 201703L) && (defined __has_include)
+#   if __has_include(<memory_resource>)
+#     include <memory_resource>
+#     define OPTIONAL_TEST_PMR 1
+#   endif
+# endif
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+// a bump allocator over a fixed buffer; like a pmr allocator, a copy of a container
+// made without an explicit allocator does not inherit it
+struct arena
+{
+  alignas(16) char buf[4096];
+  size_t used = 0;
+};
+
+template <class T>
+struct arena_allocator
+{
+  typedef T value_type;
+  arena* a;
+
+  explicit arena_allocator(arena* a) noexcept : a(a) {}
+  template <class U> arena_allocator(const arena_allocator<U>& r) noexcept : a(r.a) {}
+
+  T* allocate(size_t n)
+  {
+    size_t bytes = (n * sizeof(T) + 15) & ~size_t(15);
+    if (!a) return static_cast<T*>(::operator new(bytes));
+    assert (a->used + bytes <= sizeof(a->buf));
+    void* p = a->buf + a->used;
+    a->used += bytes;
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t) noexcept { if (!a) ::operator delete(p); }
+
+  arena_allocator select_on_container_copy_construction() const { return arena_allocator(nullptr); }
+
+  template <class U> bool operator==(const arena_allocator<U>& r) const noexcept { return a == r.a; }
+  template <class U> bool operator!=(const arena_allocator<U>& r) const noexcept { return a != r.a; }
+};
+
+typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> astring;
+
+// takes its allocator after an allocator_arg_t tag
+struct Tagged
+{
+  typedef arena_allocator<char> allocator_type;
+  astring s;
+
+  Tagged(std::allocator_arg_t, const allocator_type& a, const char* v) : s(v, a) {}
+  Tagged(std::allocator_arg_t, const allocator_type& a, const Tagged& r) : s(r.s, a) {}
+};
+
+const char* long_text = "a string long enough not to fit in the small string buffer";
+
+// has an allocator_arg_t constructor but, without allocator_type, does not use allocators:
+// a leading allocator_arg given to emplace or in_place is just its first argument
+struct NotAware
+{
+  bool got_allocator;
+
+  NotAware(int) : got_allocator(false) {}
+  NotAware(std::allocator_arg_t, const arena_allocator<char>&, int) : got_allocator(true) {}
+};
+
+static_assert(std::uses_allocator<tr2::optional<astring>, arena_allocator<char>>::value, "");
+static_assert(std::uses_allocator<tr2::optional<Tagged>, arena_allocator<char>>::value, "");
+static_assert(!std::uses_allocator<tr2::optional<int>, arena_allocator<char>>::value, "");
+static_assert(!std::uses_allocator<tr2::optional<std::string>, arena_allocator<char>>::value, "");
+
+
+TEST(allocator_extended_construction)
+{
+  arena ar;
+  arena_allocator<char> al (&ar);
+  allocations = 0;
+
+  tr2::optional<astring> a (std::allocator_arg, al, tr2::in_place, long_text);
+  assert (a->get_allocator() == al);
+  tr2::optional<astring> b (std::allocator_arg, al, a);
+  assert (b->get_allocator() == al && *b == *a);
+  tr2::optional<astring> c (std::allocator_arg, al, std::move(b));
+  assert (c->get_allocator() == al && *c == *a);
+  tr2::optional<astring> d (std::allocator_arg, al, *a);
+  assert (d->get_allocator() == al);
+  tr2::optional<astring> e (std::allocator_arg, al);
+  assert (!e);
+  tr2::optional<astring> f (std::allocator_arg, al, tr2::nullopt);
+  assert (!f);
+  tr2::optional<astring> g (std::allocator_arg, al, e);
+  assert (!g);
+  e.emplace(long_text, al);                     // emplace passes its arguments on as they are
+  assert (e->get_allocator() == al);
+
+  tr2::optional<Tagged> t (std::allocator_arg, al, tr2::in_place, long_text);
+  assert (t->s.get_allocator() == al);
+  tr2::optional<Tagged> u (std::allocator_arg, al, t);
+  assert (u->s.get_allocator() == al && u->s == t->s);
+  u.emplace(std::allocator_arg, al, long_text);
+  assert (u->s.get_allocator() == al);
+
+  tr2::optional<int> i (std::allocator_arg, al, 3); // the allocator is not used
+  assert (i == 3);
+
+  assert (allocations == 0);
+  assert (ar.used > 0);
+
+  tr2::optional<astring> plain = a;             // a plain copy drops the allocator
+  assert (plain->get_allocator() != al);
+  assert (allocations == 1);
+};
+
+
+TEST(allocator_arg_is_forwarded_unless_allocator_extended)
+{
+  arena ar;
+  arena_allocator<char> al (&ar);
+  static_assert(!std::uses_allocator<NotAware, arena_allocator<char>>::value, "");
+
+  tr2::optional<NotAware> a;
+  a.emplace(std::allocator_arg, al, 1);
+  assert (a->got_allocator);
+
+  tr2::optional<NotAware> b (tr2::in_place, std::allocator_arg, al, 1);
+  assert (b->got_allocator);
+
+  tr2::optional<NotAware> c (std::allocator_arg, al, tr2::in_place, 1); // T does not use al
+  assert (!c->got_allocator);
+};
+
+
+TEST(scoped_allocator_reaches_the_payload)
+{
+  arena ar;
+  typedef std::vector<tr2::optional<astring>, arena_allocator<tr2::optional<astring>>> vec;
+  // std::allocator_traits::construct does not do uses-allocator construction, so build the elements explicitly
+  arena_allocator<char> al (&ar);
+  allocations = 0;
+  vec v (al);
+  v.reserve(4);
+  v.emplace_back(std::allocator_arg, al, tr2::in_place, long_text);
+  v.emplace_back(std::allocator_arg, al);
+  v.emplace_back(std::allocator_arg, al, v[0]);
+  assert (v[0]->get_allocator() == al && !v[1] && *v[2] == *v[0]);
+  assert (allocations == 0);
+};
+
+
+# if defined OPTIONAL_TEST_PMR
+
+TEST(pmr_monotonic_arena_without_global_allocations)
+{
+  alignas(16) char buffer[16384];
+  std::pmr::monotonic_buffer_resource arena (buffer, sizeof(buffer), std::pmr::null_memory_resource());
+  allocations = 0;
+  {
+    std::pmr::vector<tr2::optional<std::pmr::string>> v (&arena);
+    v.reserve(8);
+    v.emplace_back(tr2::in_place, long_text);   // polymorphic_allocator does uses-allocator construction
+    v.emplace_back();
+    v.emplace_back(tr2::nullopt);
+    v.push_back(v[0]);                          // allocator-extended copy
+    v.emplace_back(std::pmr::string(long_text, &arena));
+
+    assert (v[0]->get_allocator().resource() == &arena);
+    assert (!v[1] && !v[2]);
+    assert (v[3]->get_allocator().resource() == &arena && *v[3] == long_text);
+    assert (v[4]->get_allocator().resource() == &arena);
+
+    v[1].emplace(long_text, v.get_allocator());
+    assert (v[1]->get_allocator().resource() == &arena);
+
+    std::pmr::vector<tr2::optional<std::pmr::string>> w (v, &arena);
+    assert (w[3]->get_allocator().resource() == &arena);
+  }
+  assert (allocations == 0);
+};
+
+# endif // OPTIONAL_TEST_PMR
+
+
+int main() { }
@@ -0,0 +1,206 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Built twice: in the default mode and with -fno-exceptions, where the default policy
+// terminates. Policies that end the process are run in fork()ed children on POSIX.
+// expected<T, E>::value() follows the policy of T.
+
+# include "optional.hpp"
+# include "expected.hpp"
+# include "test_alloc.hpp"
+# include <cstdlib>
+# include <new>
+# include <string>
+
+# if defined __unix__
+#   include <sys/wait.h>
+#   include <unistd.h>
+#   define OPTIONAL_TEST_FORK 1
+# endif
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+// a type for each policy
+struct Trapped { int v; };
+struct Terminated { int v; };
+struct Asserted { int v; };
+struct Unchecked { int v; };
+struct Counted { int v; };
+
+// a user-defined policy
+struct exit_with_3
+{
+  constexpr static bool checks = true;
+  [[noreturn]] static void fail() noexcept { std::_Exit(3); }
+};
+
+namespace std { namespace experimental {
+  template <> struct optional_check_policy<Trapped> { typedef optional_check_trap type; };
+  template <> struct optional_check_policy<Terminated> { typedef optional_check_terminate type; };
+  template <> struct optional_check_policy<Asserted> { typedef optional_check_assert type; };
+  template <> struct optional_check_policy<Unchecked> { typedef optional_check_unchecked type; };
+  template <> struct optional_check_policy<Counted> { typedef exit_with_3 type; };
+  template <> struct optional_check_policy<Trapped&> { typedef optional_check_trap type; };
+}}
+
+static_assert(std::is_same<tr2::optional_check_policy<int>::type, tr2::optional_check_throw>::value, "default");
+static_assert(!tr2::optional_check_unchecked::checks, "unchecked");
+
+// value() stays usable in constant expressions
+constexpr tr2::optional<int> ci{7};
+static_assert(ci.value() == 7, "constexpr value()");
+constexpr tr2::optional<Unchecked> cu{Unchecked{8}};
+static_assert(cu.value().v == 8, "constexpr value()");
+constexpr tr2::expected<int, int> ce{9};
+static_assert(ce.value() == 9 && *ce == 9, "constexpr value()");
+
+
+# if OPTIONAL_TEST_FORK
+
+// the wait status of a child process running f
+template <class F>
+int run_in_child(F f)
+{
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(2); // keep the terminate/assert messages out of the test log
+    f();
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return status;
+}
+
+template <class F>
+int dies_with(F f) // the signal, 0 if f returns
+{
+  int status = run_in_child(f);
+  return WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+}
+
+# endif
+
+
+TEST(engaged_value_under_every_policy)
+{
+  tr2::optional<int> i{1};
+  tr2::optional<Trapped> t{Trapped{2}};
+  tr2::optional<Terminated> e{Terminated{3}};
+  tr2::optional<Asserted> a{Asserted{4}};
+  tr2::optional<Unchecked> u{Unchecked{5}};
+  assert (i.value() == 1);
+  assert (t.value().v == 2);
+  assert (e.value().v == 3);
+  assert (a.value().v == 4);
+  assert (u.value().v == 5);
+  assert (std::move(u).value().v == 5);
+
+  Trapped tr{6};
+  tr2::optional<Trapped&> r{tr};
+  assert (r.value().v == 6);
+
+  tr2::expected<int, int> ei{7};
+  tr2::expected<Trapped, int> et{Trapped{8}};
+  assert (ei.value() == 7);
+  assert (et.value().v == 8);
+  assert (std::move(et).value().v == 8);
+};
+
+
+# if OPTIONAL_HAS_EXCEPTIONS
+
+TEST(throw_policy_throws_bad_optional_access)
+{
+  tr2::optional<int> o;
+  bool caught = false;
+  try { o.value(); }
+  catch (const std::logic_error& ex) { caught = true; assert (std::string(ex.what()) == "bad optional access"); }
+  assert (caught);
+};
+
+TEST(throw_policy_does_not_allocate)
+{
+  tr2::optional<int> o;
+  try { o.value(); } catch (const tr2::bad_optional_access&) {} // the message is built once
+
+  int before = allocations;
+  for (int i = 0; i != 10; ++i) {
+    int caught = 0;
+    try { o.value(); } catch (const tr2::bad_optional_access&) { ++caught; }
+    try { std::move(o).value(); } catch (const tr2::bad_optional_access&) { ++caught; }
+    assert (caught == 2);
+  }
+  assert (allocations == before);
+};
+
+TEST(throw_policy_throws_bad_expected_access)
+{
+  tr2::expected<int, int> e{tr2::unexpect, 3};
+  int caught = 0;
+  try { e.value(); } catch (const tr2::bad_expected_access<int>& ex) { caught += ex.error(); }
+  try { std::move(e).value(); } catch (const tr2::bad_expected_access<int>& ex) { caught += ex.error(); }
+  assert (caught == 6);
+};
+
+# endif
+
+
+# if OPTIONAL_TEST_FORK
+
+TEST(failing_policies_end_the_process)
+{
+  tr2::optional<Trapped> t;
+  tr2::optional<Terminated> e;
+  tr2::optional<Trapped&> r;
+  assert (dies_with([&]{ t.value(); }) != 0);
+  assert (dies_with([&]{ r.value(); }) != 0);
+  assert (dies_with([&]{ e.value(); }) == SIGABRT);
+
+  if (tr2::optional_check_assert::checks) {
+    tr2::optional<Asserted> a;
+    assert (dies_with([&]{ a.value(); }) == SIGABRT);
+  }
+
+  tr2::expected<Trapped, int> et{tr2::unexpect, 1};
+  tr2::expected<Terminated, int> ee{tr2::unexpect, 2};
+  assert (dies_with([&]{ et.value(); }) != 0);
+  assert (dies_with([&]{ std::move(et).value(); }) != 0);
+  assert (dies_with([&]{ ee.value(); }) == SIGABRT);
+
+# if !OPTIONAL_HAS_EXCEPTIONS
+  tr2::optional<int> i;
+  tr2::expected<int, int> ei{tr2::unexpect, 3};
+  assert (dies_with([&]{ i.value(); }) == SIGABRT);
+  assert (dies_with([&]{ ei.value(); }) == SIGABRT);
+  assert (dies_with([&]{ std::move(ei).value(); }) == SIGABRT);
+# endif
+};
+
+TEST(user_defined_policy)
+{
+  tr2::optional<Counted> c;
+  int status = run_in_child([&]{ c.value(); });
+  assert (WIFEXITED(status) && WEXITSTATUS(status) == 3);
+
+  c.emplace(Counted{9});
+  status = run_in_child([&]{ if (c.value().v != 9) std::abort(); });
+  assert (WIFEXITED(status) && WEXITSTATUS(status) == 0);
+};
+
+# endif
+
+
+int main() { }
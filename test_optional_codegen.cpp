@@ -0,0 +1,231 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Checks the assembly of the hot operations: the probes in test_optional_codegen_probes.cpp
+// are compiled at -O2 -DNDEBUG and linked into this program, which disassembles itself with
+// objdump (OPTIONAL_OBJDUMP, set by the build) and counts the instructions, branches and
+// calls of each.
+
+# include <cassert>
+# include <cstdio>
+# include <iomanip>
+# include <iostream>
+# include <map>
+# include <string>
+# include <vector>
+# include <unistd.h>
+
+# if !defined OPTIONAL_OBJDUMP
+#   define OPTIONAL_OBJDUMP "objdump"
+# endif
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+// what a function compiles to; padding is not counted
+struct code
+{
+  int instructions = 0;  // in the function, without its .cold part
+  int branches = 0;      // conditional or not, within the function or to its .cold part
+  int calls = 0;         // calls and tail calls to other functions
+  int cold = 0;          // instructions in the .cold part
+};
+
+
+// the function a jump target names: "1c <f+0x4>" or "1c <f>" gives "f"
+std::string target_of(const std::string& operands)
+{
+  std::string::size_type b = operands.find('<');
+  if (b == std::string::npos) return std::string();
+  std::string::size_type e = operands.find_first_of("+>", b);
+  return operands.substr(b + 1, e - b - 1);
+}
+
+bool starts_with(const std::string& s, const char* p) { return s.compare(0, std::char_traits<char>::length(p), p) == 0; }
+
+bool is_padding(const std::string& m, const std::string& operands)
+{
+  return starts_with(m, "nop") || m == "int3" || (m == "xchg" && operands == "%ax,%ax");
+}
+
+// the mnemonic and the operands of "  4a:\tmov    0x4(%rdi),%eax", prefixes skipped
+void split(const std::string& text, std::string& m, std::string& operands)
+{
+  static const char* const prefixes[] = { "rep", "repz", "repnz", "bnd", "notrack", "data16", "cs", "ds", "lock" };
+  std::string::size_type p = 0;
+  for (;;) {
+    std::string::size_type e = text.find_first_of(" \t", p);
+    m = text.substr(p, e == std::string::npos ? std::string::npos : e - p);
+    p = e == std::string::npos ? text.size() : text.find_first_not_of(" \t", e);
+    if (p == std::string::npos) p = text.size();
+    bool prefix = false;
+    for (const char* x : prefixes) prefix = prefix || m == x;
+    if (!prefix || p == text.size()) break;
+  }
+  operands = text.substr(p);
+}
+
+void classify(const std::string& function, const std::string& m, const std::string& operands, code& c)
+{
+  std::string home = function.substr(0, function.find('.'));
+  std::string target = target_of(operands);
+  bool local = target.substr(0, target.find('.')) == home;
+
+# if defined __x86_64__
+  bool call = starts_with(m, "call");
+  bool jump = m[0] == 'j';
+# elif defined __aarch64__
+  bool call = m == "bl" || m == "blr";
+  bool jump = m == "b" || starts_with(m, "b.") || m == "br" || m == "cbz" || m == "cbnz" || m == "tbz" || m == "tbnz";
+# else
+#   error "no instruction classes for this architecture"
+# endif
+
+  if (call || (jump && !local && (m == "jmp" || m == "b"))) ++c.calls;   // a call or a tail call
+  else if (jump) ++c.branches;
+}
+
+std::map<std::string, code> disassemble()
+{
+  std::map<std::string, code> functions;
+  char self[4096];
+  ssize_t n = readlink("/proc/self/exe", self, sizeof self - 1);   // objdump's own /proc/self is objdump
+  assert (n > 0);
+  self[n] = '\0';
+  std::string command = std::string("'") + OPTIONAL_OBJDUMP + "' -d --no-show-raw-insn '" + self + "'";
+  FILE* f = popen(command.c_str(), "r");
+  assert (f);
+
+  std::string function;
+  char buf[4096];
+  while (std::fgets(buf, sizeof buf, f)) {
+    std::string line(buf);
+    if (!line.empty() && line.back() == '\n') line.pop_back();
+
+    std::string::size_type lt = line.find(" <"), gt = line.rfind(">:");
+    if (lt != std::string::npos && gt == line.size() - 2 && line[0] != ' ') {   // "0000000000001130 <probe_deref>:"
+      function = line.substr(lt + 2, gt - lt - 2);
+      continue;
+    }
+    std::string::size_type colon = line.find(":\t");
+    if (line.empty() || line[0] != ' ' || colon == std::string::npos || !starts_with(function, "probe_")) continue;
+
+    std::string m, operands;
+    split(line.substr(colon + 2), m, operands);
+    if (m.empty() || is_padding(m, operands)) continue;
+
+    std::string::size_type dot = function.find(".cold");
+    code& c = functions[function.substr(0, dot)];
+    if (dot != std::string::npos) ++c.cold;
+    else {
+      ++c.instructions;
+      classify(function, m, operands, c);
+    }
+  }
+  int status = pclose(f);
+  assert (status == 0);
+  (void)status;
+  return functions;
+}
+
+// the probes of this program
+const std::map<std::string, code>& functions()
+{
+  static const std::map<std::string, code> f = disassemble();
+  return f;
+}
+
+const code& probe(const char* name)
+{
+  std::map<std::string, code>::const_iterator it = functions().find(name);
+  if (it == functions().end()) std::cerr << "no probe " << name << " in the disassembly\n";
+  assert (it != functions().end());
+  return it->second;
+}
+
+// a load and a return at most, with neither branches nor calls
+void expect_single_load(const char* name, int max_instructions = 2)
+{
+  const code& c = probe(name);
+  assert (c.instructions <= max_instructions);
+  assert (c.branches == 0);
+  assert (c.calls == 0);
+}
+
+// one test of the flag and at most one branch over a load, no calls
+void expect_single_test(const char* name, int max_instructions)
+{
+  const code& c = probe(name);
+  assert (c.instructions <= max_instructions);
+  assert (c.branches <= 1);
+  assert (c.calls == 0);
+}
+
+// the wrapped form is no larger than the hand-written one
+void expect_no_worse(const char* name, const char* baseline)
+{
+  const code& c = probe(name);
+  const code& b = probe(baseline);
+  assert (c.instructions <= b.instructions);
+  assert (c.branches <= b.branches);
+  assert (c.calls <= b.calls);
+}
+
+
+// the observers are a load, or a load and a compare
+TEST(observers)
+{
+  expect_single_load("probe_deref");
+  expect_single_load("probe_arrow");
+  expect_single_load("probe_has_value");
+  expect_single_load("probe_bool");
+  expect_single_load("probe_eq_nullopt", 3);
+  expect_single_test("probe_value_or", 5);
+  expect_single_test("probe_eq_value", 6);
+};
+
+TEST(reference_observers)
+{
+  expect_single_load("probe_ref_deref", 3);
+  expect_single_load("probe_ref_has_value", 3);
+  expect_single_test("probe_ref_value_or", 6);
+};
+
+// the checking policies test the flag and branch to an out-of-line failure path; the
+// others are operator*
+TEST(checked_access_policies)
+{
+  for (const char* p : { "probe_value_throw", "probe_value_terminate", "probe_value_trap" }) {
+    expect_single_test(p, 4);
+    assert (probe(p).branches == 1);
+  }
+  expect_single_load("probe_value_assert");
+  expect_single_load("probe_value_unchecked");
+  assert (probe("probe_value_unchecked").instructions == probe("probe_deref").instructions);
+};
+
+// lookup adds nothing to the find or the range check it wraps
+TEST(lookup)
+{
+  expect_no_worse("probe_lookup_vector", "probe_index_vector");
+  expect_no_worse("probe_lookup_map", "probe_find_map");
+};
+
+
+// prints the counts, for comparing compilers and policies
+int main()
+{
+  std::cout << std::left << std::setw(24) << "probe" << std::right << std::setw(14) << "instructions"
+            << std::setw(10) << "branches" << std::setw(7) << "calls" << std::setw(7) << "cold" << '\n';
+  for (const auto& f : functions())
+    std::cout << std::left << std::setw(24) << f.first << std::right << std::setw(14) << f.second.instructions
+              << std::setw(10) << f.second.branches << std::setw(7) << f.second.calls << std::setw(7) << f.second.cold << '\n';
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// The probes of test_optional_codegen: one hot operation per function, compiled at -O2 -DNDEBUG
+// and disassembled by the test. The names are unmangled so that the test can find them.
+
+# include "optional.hpp"
+# include "optional_lookup.hpp"
+# include <map>
+# include <vector>
+
+namespace tr2 = std::experimental;
+
+struct Point { int x, y; };
+
+template <class Policy> struct Checked { int i; };
+
+namespace std { namespace experimental {
+  template <class Policy> struct optional_check_policy<Checked<Policy>> { typedef Policy type; };
+}}
+
+extern "C" {
+
+// observers
+int probe_deref(const tr2::optional<int>& o) { return *o; }
+int probe_arrow(const tr2::optional<Point>& o) { return o->y; }
+bool probe_has_value(const tr2::optional<int>& o) { return o.has_value(); }
+bool probe_bool(const tr2::optional<int>& o) { return bool(o); }
+int probe_value_or(const tr2::optional<int>& o, int d) { return o.value_or(d); }
+bool probe_eq_nullopt(const tr2::optional<int>& o) { return o == tr2::nullopt; }
+bool probe_eq_value(const tr2::optional<int>& o, int v) { return o == v; }
+
+int probe_ref_deref(const tr2::optional<int&>& o) { return *o; }
+bool probe_ref_has_value(const tr2::optional<int&>& o) { return o.has_value(); }
+int probe_ref_value_or(const tr2::optional<int&>& o, int d) { return o.value_or(d); }
+
+// value() under each checked access policy
+int probe_value_throw(const tr2::optional<Checked<tr2::optional_check_throw>>& o) { return o.value().i; }
+int probe_value_terminate(const tr2::optional<Checked<tr2::optional_check_terminate>>& o) { return o.value().i; }
+int probe_value_trap(const tr2::optional<Checked<tr2::optional_check_trap>>& o) { return o.value().i; }
+int probe_value_assert(const tr2::optional<Checked<tr2::optional_check_assert>>& o) { return o.value().i; }
+int probe_value_unchecked(const tr2::optional<Checked<tr2::optional_check_unchecked>>& o) { return o.value().i; }
+
+// lookup against the code it replaces
+int probe_lookup_vector(const std::vector<int>& v, size_t i) { return tr2::lookup(v, i).value_or(-1); }
+int probe_index_vector(const std::vector<int>& v, size_t i) { return i < v.size() ? v[i] : -1; }
+
+int probe_lookup_map(const std::map<int, int>& m, int k)
+{
+  tr2::optional<const int&> o = tr2::lookup(m, k);
+  return o ? *o : -1;
+}
+
+int probe_find_map(const std::map<int, int>& m, int k)
+{
+  std::map<int, int>::const_iterator it = m.find(k);
+  return it != m.end() ? it->second : -1;
+}
+
+} // extern "C"
@@ -0,0 +1,115 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// optional_core.hpp on its own: everything but the relational operators and std::hash,
+// without <string> and <stdexcept>. value() throws through a function that another
+// translation unit, test_optional_core_throw.cpp, defines.
+
+# include "optional_fwd.hpp"
+
+// the declarations are enough for signatures
+int parse(const std::experimental::optional<int>& o);
+
+# include "optional_core.hpp"
+
+// with libstdc++ <string> and <stdexcept> stay out (their include guards would be defined),
+// and with OPTIONAL_LIBSTDCXX_INTERNAL_HEADERS <memory> and <functional> too
+# if defined __GLIBCXX__ && defined OPTIONAL_USES_LIBSTDCXX_INTERNAL_HEADERS
+#   if defined _GLIBCXX_STRING || defined _GLIBCXX_STDEXCEPT || defined _GLIBCXX_FUNCTIONAL || defined _GLIBCXX_MEMORY
+#     error "optional_core.hpp includes a header it should not need"
+#   endif
+# elif defined __GLIBCXX__ && __cplusplus < 202002L
+#   if defined _GLIBCXX_STRING || defined _GLIBCXX_STDEXCEPT
+#     error "optional_core.hpp includes a header it should not need"
+#   endif
+# endif
+# if defined OPTIONAL_LIBSTDCXX_INTERNAL_HEADERS && defined __GLIBCXX__ && _GLIBCXX_RELEASE >= 7
+#   if !defined OPTIONAL_USES_LIBSTDCXX_INTERNAL_HEADERS
+#     error "OPTIONAL_LIBSTDCXX_INTERNAL_HEADERS does not select the internal headers"
+#   endif
+# endif
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+// value() under a policy that does not throw needs no more than the core
+struct Unchecked { int v; };
+namespace std { namespace experimental {
+  template <> struct optional_check_policy<Unchecked> { typedef optional_check_unchecked type; };
+}}
+
+int parse(const tr2::optional<int>& o) { return o ? *o : -1; }
+
+// in test_optional_core_throw.cpp, which includes optional_bad_access.hpp
+bool is_bad_optional_access(const std::exception& e);
+
+
+TEST(observers)
+{
+  tr2::optional<int> o;
+  assert (!o);
+  assert (parse(o) == -1);
+  assert (o.value_or(2) == 2);
+  o = 1;
+  assert (o.has_value());
+  assert (parse(o) == 1);
+  o = tr2::nullopt;
+  assert (!o);
+};
+
+TEST(in_place_and_emplace)
+{
+  struct Point { int x, y; Point(int x, int y) : x(x), y(y) {} };
+  tr2::optional<Point> p(tr2::in_place, 1, 2);
+  assert (p->x == 1 && p->y == 2);
+  p.emplace(3, 4);
+  assert ((*p).y == 4);
+  p.reset();
+  assert (!p);
+};
+
+TEST(make_optional_and_swap)
+{
+  int i = 1;
+  tr2::optional<int&> r = tr2::make_optional(std::ref(i));
+  static_assert(std::is_same<decltype(tr2::make_optional(std::ref(i))), tr2::optional<int&>>::value, "");
+  *r = 2;
+  assert (i == 2);
+
+  tr2::optional<int> a = tr2::make_optional(3), b;
+  swap(a, b);
+  assert (!a && *b == 3);
+};
+
+TEST(unchecked_value)
+{
+  tr2::optional<Unchecked> o(Unchecked{5});
+  assert (o.value().v == 5);
+};
+
+# if OPTIONAL_HAS_EXCEPTIONS
+TEST(throwing_value)
+{
+  // the throw is declared here and defined by another translation unit
+  tr2::optional<int> o(1);
+  assert (o.value() == 1);
+  o = tr2::nullopt;
+  bool thrown = false;
+  try { (void)o.value(); }
+  catch (const std::exception& e) { thrown = is_bad_optional_access(e); }
+  assert (thrown);
+};
+# endif
+
+
+int main() { }
@@ -0,0 +1,15 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// The other translation unit of test_optional_core: it includes optional_bad_access.hpp, and
+// so defines the throw that value() in test_optional_core.cpp calls.
+
+# include "optional_bad_access.hpp"
+
+bool is_bad_optional_access(const std::exception& e)
+{
+  return dynamic_cast<const std::experimental::bad_optional_access*>(&e) != nullptr;
+}
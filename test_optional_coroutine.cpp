@@ -0,0 +1,246 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Built twice: in C++20, and in the default mode, where the header must add nothing.
+
+# include "optional_coroutine.hpp"
+# include "test_alloc.hpp"
+# include <cstdlib>
+# include <new>
+# include <stdexcept>
+# include <string>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+
+# if OPTIONAL_HAS_COROUTINES
+
+tr2::optional<int> digit(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  return tr2::nullopt;
+}
+
+// the early-return version
+tr2::optional<int> number2_plain(const char* s)
+{
+  tr2::optional<int> a = digit(s[0]);
+  if (!a) return tr2::nullopt;
+  tr2::optional<int> b = digit(s[1]);
+  if (!b) return tr2::nullopt;
+  return *a * 10 + *b;
+}
+
+tr2::optional<int> number2(const char* s)
+{
+  int a = co_await digit(s[0]);
+  int b = co_await digit(s[1]);
+  co_return a * 10 + b;
+}
+
+tr2::optional<int> sum_of_numbers(const char* s, int n) // nested coroutines
+{
+  int sum = 0;
+  for (int i = 0; i != n; ++i)
+    sum += co_await number2(s + 2 * i);
+  co_return sum;
+}
+
+int destroyed = 0;
+
+struct Guard
+{
+  ~Guard() { ++destroyed; }
+};
+
+tr2::optional<int> guarded(tr2::optional<int> o)
+{
+  Guard g;
+  int v = co_await o;
+  co_return v + 1;
+}
+
+tr2::optional<std::string> concat(const tr2::optional<std::string>& a, tr2::optional<std::string> b)
+{
+  const std::string& x = co_await a;                      // lvalue: a reference, no copy
+  assert (&x == &*a);
+  std::string y = co_await std::move(b);
+  co_return x + y;
+}
+
+tr2::optional<int> returns_optional(bool e)
+{
+  tr2::optional<int> r;
+  if (e) r = 7;
+  co_return r;
+}
+
+tr2::optional<int> returns_nullopt()
+{
+  co_return tr2::nullopt;
+}
+
+tr2::optional<int> throws()
+{
+  co_await digit('1');
+  throw std::runtime_error("parse");
+  co_return 0;
+}
+
+
+TEST(coroutine_matches_early_return)
+{
+  const char* inputs[] = { "42", "07", "4x", "x2", "xx", "99" };
+  for (const char* s : inputs)
+    assert (number2(s) == number2_plain(s));
+
+  assert (number2("42") == 42);
+  assert (!number2("4x"));
+};
+
+
+TEST(coroutine_nested)
+{
+  assert (sum_of_numbers("102030", 3) == 60);
+  assert (!sum_of_numbers("1020x0", 3));
+  assert (sum_of_numbers("", 0) == 0);
+};
+
+
+TEST(coroutine_short_circuit_destroys_locals)
+{
+  destroyed = 0;
+  assert (guarded(1) == 2);
+  assert (destroyed == 1);
+  assert (!guarded(tr2::nullopt));
+  assert (destroyed == 2);
+};
+
+
+TEST(coroutine_await_value_categories)
+{
+  tr2::optional<std::string> a = std::string("ab");
+  assert (concat(a, std::string("cd")) == std::string("abcd"));
+  assert (!concat(a, tr2::nullopt));
+  assert (!concat(tr2::nullopt, std::string("cd")));
+};
+
+
+TEST(coroutine_co_return_forms)
+{
+  assert (returns_optional(true) == 7);
+  assert (!returns_optional(false));
+  assert (!returns_nullopt());
+};
+
+
+TEST(coroutine_exception_propagates)
+{
+  bool caught = false;
+  try { throws(); }
+  catch (const std::runtime_error&) { caught = true; }
+  assert (caught);
+  assert (number2("12") == 12); // the frame of throws() was released
+};
+
+
+struct lookalike
+{
+  typedef void optional_coroutine_result;
+  void bind(tr2::optional<int>&) {}
+};
+
+// the two orders in which a compiler may convert the return object, played by hand
+TEST(coroutine_return_object_conversion_orders)
+{
+  typedef std::coroutine_traits<tr2::optional<int>>::promise_type promise;
+
+  tr2::optional<int> eager = [] {
+    promise* p = new promise;
+    tr2::optional<int> o = p->get_return_object();   // converted before the body runs
+    p->return_value(5);
+    delete p;
+    return o;
+  }();
+  assert (eager == 5);
+
+  tr2::optional<int> late = [] {
+    promise* p = new promise;
+    auto r = p->get_return_object();
+    p->return_value(6);
+    delete p;                                         // the frame is gone before the conversion
+    return tr2::optional<int>(std::move(r));
+  }();
+  assert (late == 6);
+
+  tr2::optional<int> failed = [] {
+    promise* p = new promise;
+    auto r = p->get_return_object();
+    delete p;
+    return tr2::optional<int>(std::move(r));
+  }();
+  assert (!failed);
+
+  // only the return object of optional_promise binds; a look-alike does not
+  static_assert(!std::is_constructible<tr2::optional<int>, lookalike&&>::value, "");
+  static_assert(!std::is_constructible<tr2::optional<int>, tr2::detail_::optional_coroutine_result<int>&>::value, "");
+};
+
+
+TEST(coroutine_frames_do_not_allocate)
+{
+  allocations = 0;
+  int total = 0;
+  for (int i = 0; i != 1000; ++i) {
+    total += sum_of_numbers("112233", 3).value_or(0);
+    total += number2("x1").value_or(0);
+  }
+  assert (total == 66 * 1000);
+  assert (allocations == 0);
+  assert (tr2::detail_::coroutine_arena::local().used() == 0);
+};
+
+
+TEST(coroutine_arena_overflow)
+{
+  // deeper than the arena: the outer frames spill to operator new, and are freed
+  struct deep
+  {
+    static tr2::optional<int> f(int n)
+    {
+      if (n == 0) co_return 0;
+      int r = co_await f(n - 1);
+      co_return r + 1;
+    }
+  };
+  allocations = 0;
+  assert (deep::f(1000) == 1000);
+  assert (allocations > 0);
+  assert (tr2::detail_::coroutine_arena::local().used() == 0);
+};
+
+# else
+
+TEST(coroutines_unavailable)
+{
+  static_assert(OPTIONAL_HAS_COROUTINES == 0, "");
+  tr2::optional<int> o = 1;
+  assert (o == 1);
+};
+
+# endif // OPTIONAL_HAS_COROUTINES
+
+
+int main() { }
@@ -0,0 +1,250 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Built twice: in C++20, and in the default mode, which has only step_generator.
+
+# include "optional_generator.hpp"
+# include "test_alloc.hpp"
+# include <cstdlib>
+# include <new>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Record
+{
+  static int constructed, destroyed, assigned;
+
+  int id;
+
+  explicit Record(int i) : id(i) { ++constructed; }
+  Record(const Record& r) : id(r.id) { ++constructed; }
+  Record& operator=(const Record& r) { id = r.id; ++assigned; return *this; }
+  ~Record() { ++destroyed; }
+
+  static void reset_counts() { constructed = destroyed = assigned = 0; }
+};
+
+int Record::constructed = 0;
+int Record::destroyed = 0;
+int Record::assigned = 0;
+
+
+// the generator of records id .. id + n - 1
+struct counting_step
+{
+  int id, end;
+
+  bool operator()(tr2::optional<Record>& out)
+  {
+    if (id == end) return false;
+    tr2::detail_::assign_or_emplace(out, Record(id++));
+    return true;
+  }
+};
+
+
+TEST(step_generator_next)
+{
+  tr2::step_generator<Record, counting_step> g (counting_step{1, 4});
+  tr2::optional<Record> buf;
+  assert (g.next(buf) && buf->id == 1);
+  assert (g.next(buf) && buf->id == 2);
+  assert (g.next(buf) && buf->id == 3);
+  assert (!g.next(buf));
+  assert (!buf);
+  assert (!g.next(buf));
+};
+
+
+TEST(step_generator_reuses_the_buffer)
+{
+  Record::reset_counts();
+  {
+    tr2::step_generator<Record, counting_step> g (counting_step{0, 100});
+    tr2::optional<Record> buf;
+    int sum = 0;
+    for (const Record& r : tr2::generator_range(g, buf))
+      sum += r.id;
+    assert (sum == 4950);
+  }
+  // one Record lives in the buffer throughout; later ones are assigned to it
+  assert (Record::assigned == 99);
+  assert (Record::constructed == 100 + 1); // the temporaries, and the first element in buf
+  assert (Record::destroyed == Record::constructed);
+};
+
+
+TEST(step_generator_from_lambda)
+{
+  std::vector<std::string> lines = { "a", "bb", "ccc" };
+  size_t i = 0;
+  auto g = tr2::make_step_generator<std::string>([&](tr2::optional<std::string>& out) {
+    if (i == lines.size()) return false;
+    tr2::detail_::assign_or_emplace(out, lines[i++]);
+    return true;
+  });
+
+  std::string all;
+  for (const std::string& s : g) // the generator's own buffer
+    all += s;
+  assert (all == "abbccc");
+};
+
+
+TEST(step_generator_does_not_allocate)
+{
+  allocations = 0;
+  tr2::step_generator<Record, counting_step> g (counting_step{0, 1000});
+  int n = 0;
+  for (const Record& r : g) n += (r.id >= 0);
+  assert (n == 1000);
+  assert (allocations == 0);
+};
+
+
+# if OPTIONAL_HAS_COROUTINES
+
+tr2::optional_generator<Record> records(int from, int to)
+{
+  for (int i = from; i != to; ++i)
+    co_yield Record(i);
+}
+
+tr2::optional_generator<std::string> words(std::string text)
+{
+  std::string w;
+  for (char c : text) {
+    if (c != ' ') w += c;
+    else if (!w.empty()) { co_yield w; w.clear(); }
+  }
+  if (!w.empty()) co_yield w;
+}
+
+// not assignable: each yield destroys the previous value and constructs the next one
+struct Fixed
+{
+  const int id;
+  explicit Fixed(int i) : id(i) {}
+};
+
+tr2::optional_generator<Fixed> fixed(int from, int to)
+{
+  for (int i = from; i != to; ++i)
+    co_yield Fixed(i);
+}
+
+tr2::optional_generator<int> failing()
+{
+  co_yield 1;
+  throw std::runtime_error("io");
+}
+
+
+TEST(optional_generator_next)
+{
+  tr2::optional_generator<Record> g = records(5, 7);
+  tr2::optional<Record> buf;
+  assert (g.next(buf) && buf->id == 5);
+  assert (g.next(buf) && buf->id == 6);
+  assert (!g.next(buf));
+  assert (!buf);
+  assert (!g.next(buf));
+};
+
+
+TEST(optional_generator_reuses_the_buffer)
+{
+  Record::reset_counts();
+  {
+    tr2::optional<Record> buf;
+    int sum = 0;
+    tr2::optional_generator<Record> g = records(0, 100);
+    for (const Record& r : tr2::generator_range(g, buf))
+      sum += r.id;
+    assert (sum == 4950);
+  }
+  assert (Record::assigned == 99);
+  assert (Record::destroyed == Record::constructed);
+};
+
+
+TEST(optional_generator_non_assignable)
+{
+  static_assert(!std::is_assignable<Fixed&, Fixed&&>::value, "");
+  int sum = 0;
+  for (const Fixed& f : fixed(0, 10))
+    sum += f.id;
+  assert (sum == 45);
+};
+
+
+TEST(optional_generator_range_for)
+{
+  std::string all;
+  for (const std::string& w : words("  the quick  brown fox "))
+    all += w + ".";
+  assert (all == "the.quick.brown.fox.");
+
+  int n = 0;
+  for (const std::string& w : words("   ")) n += int(w.size());
+  assert (n == 0);
+};
+
+
+TEST(optional_generator_exception)
+{
+  tr2::optional_generator<int> g = failing();
+  tr2::optional<int> buf;
+  assert (g.next(buf) && *buf == 1);
+  bool caught = false;
+  try { g.next(buf); }
+  catch (const std::runtime_error&) { caught = true; }
+  assert (caught);
+  assert (!g.next(buf));
+};
+
+
+TEST(optional_generator_move)
+{
+  tr2::optional_generator<Record> g = records(0, 3);
+  tr2::optional<Record> buf;
+  assert (g.next(buf) && buf->id == 0);
+  tr2::optional_generator<Record> h = std::move(g);
+  assert (!g.next(buf));
+  assert (h.next(buf) && buf->id == 1);
+};
+
+
+TEST(optional_generator_frames_are_recycled)
+{
+  { tr2::optional_generator<Record> g = records(0, 1); } // warm up this thread's cache
+  allocations = 0;
+  int sum = 0;
+  for (int k = 0; k != 100; ++k) {
+    tr2::optional_generator<Record> g = records(0, 10);
+    tr2::optional<Record> buf;
+    while (g.next(buf)) sum += buf->id;
+  }
+  assert (sum == 4500);
+  assert (allocations == 0);
+};
+
+# endif // OPTIONAL_HAS_COROUTINES
+
+
+int main() { }
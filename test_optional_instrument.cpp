@@ -0,0 +1,171 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# define OPTIONAL_INSTRUMENT
+# include "optional.hpp"
+# include <atomic>
+# include <sstream>
+# include <string>
+# include <thread>
+# include <vector>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Big
+{
+  int a[16];
+  explicit Big(int i = 0) : a{i} {}
+};
+
+struct PerThread { int i; };
+
+// swaps without moving
+struct Handle
+{
+  int id;
+  static int swaps;
+  friend void swap(Handle& x, Handle& y) { std::swap(x.id, y.id); ++swaps; }
+};
+int Handle::swaps = 0;
+
+// still usable in constant expressions
+constexpr tr2::optional<int> ci{1};
+static_assert(*ci == 1, "constexpr");
+
+tr2::optional_instrument_row counts() { return tr2::optional_instrument_counts<Big>(); }
+
+int take(tr2::optional<Big> o) { return o ? o->a[0] : -1; }
+
+
+TEST(each_event_is_counted)
+{
+  tr2::optional_instrument_reset();
+  Big b(1);
+  tr2::optional<Big> o1(b);                   // copy
+  tr2::optional<Big> o2(Big(2));              // move
+  tr2::optional<Big> o3(tr2::in_place, 3);    // emplace
+  tr2::optional<Big> o4(o1);                  // copy
+  tr2::optional<Big> o5(std::move(o2));       // move
+  o4 = o3;                                    // copy
+  o4 = std::move(o3);                         // move
+  o4 = b;                                     // copy
+  o5.emplace(5);                              // reset, emplace
+  o5.reset();                                 // reset
+  o5 = o1;                                    // copy
+  o5 = tr2::nullopt;                          // reset
+  (void)o1.value_or(Big(9));                  // copy
+
+  tr2::optional_instrument_row r = counts();
+  assert (r.size == sizeof(Big));
+  assert (r.copies == 6);
+  assert (r.moves == 3);
+  assert (r.emplaces == 2);
+  assert (r.resets == 3);
+  assert (r.failed_accesses == 0);
+};
+
+TEST(a_copy_meant_to_be_a_move_shows)
+{
+  tr2::optional<Big> o(tr2::in_place, 7);
+  tr2::optional_instrument_reset();
+  assert (take(o) == 7);
+  assert (counts().copies == 1 && counts().moves == 0);
+
+  tr2::optional_instrument_reset();
+  assert (take(std::move(o)) == 7);
+  assert (counts().copies == 0 && counts().moves == 1);
+};
+
+TEST(failed_accesses)
+{
+  tr2::optional_instrument_reset();
+  tr2::optional<Big> o;
+  for (int i = 0; i != 3; ++i) {
+    try { o.value(); }
+    catch (const tr2::bad_optional_access&) {}
+  }
+  assert (counts().failed_accesses == 3);
+};
+
+TEST(swap)
+{
+  tr2::optional<Big> x(tr2::in_place, 1), y(tr2::in_place, 2), z;
+  tr2::optional_instrument_reset();
+  x.swap(y);                                  // std::swap of the payloads
+  assert (counts().swaps == 1 && counts().moves == 0 && counts().resets == 0);
+  assert (x->a[0] == 2 && y->a[0] == 1);
+  x.swap(z);                                  // one move into z, x destroys its moved-from payload
+  assert (counts().swaps == 1 && counts().moves == 1 && counts().resets == 1);
+};
+
+TEST(swap_of_engaged_optionals_is_one_swap)
+{
+  tr2::optional<Handle> x(Handle{1}), y(Handle{2});
+  tr2::optional_instrument_reset();
+  Handle::swaps = 0;
+  swap(x, y);                                 // the payload's own swap, no move
+  assert (Handle::swaps == 1 && x->id == 2 && y->id == 1);
+  tr2::optional_instrument_row r = tr2::optional_instrument_counts<Handle>();
+  assert (r.swaps == 1 && r.moves == 0 && r.copies == 0 && r.resets == 0);
+
+  std::ostringstream os;
+  tr2::optional_instrument_report(os);
+  std::string s = os.str();
+  std::istringstream is(s.substr(s.find("\nHandle ") + 1)); // the row of Handle
+  std::string type;
+  unsigned long long size, copies, moves, emplaces, resets, swaps, failed;
+  is >> type >> size >> copies >> moves >> emplaces >> resets >> swaps >> failed;
+  assert (is && size == sizeof(Handle) && moves == 0 && swaps == 1 && failed == 0);
+};
+
+TEST(threads_are_merged)
+{
+  const int n = 4, per_thread = 1000;
+  tr2::optional_instrument_reset();
+  std::atomic<int> done(0);
+  std::atomic<bool> leave(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t != n; ++t)
+    threads.emplace_back([&] {
+      tr2::optional<PerThread> o;
+      for (int i = 0; i != per_thread; ++i) o.emplace(PerThread{i}); // emplacing a T is a move
+      ++done;
+      while (!leave) std::this_thread::yield();
+    });
+
+  while (done != n) std::this_thread::yield();
+  assert (tr2::optional_instrument_counts<PerThread>().moves == n * per_thread); // live threads
+
+  leave = true;
+  for (std::thread& t : threads) t.join();
+  tr2::optional_instrument_row r = tr2::optional_instrument_counts<PerThread>(); // exited threads
+  assert (r.moves == n * per_thread);
+  assert (r.resets == n * (per_thread - 1));  // by emplace; the destructor is not a reset
+};
+
+TEST(report)
+{
+  tr2::optional<Big> o(tr2::in_place, 1);
+  std::ostringstream os;
+  tr2::optional_instrument_report(os);
+  std::string s = os.str();
+  assert (s.compare(0, 4, "type") == 0);
+  assert (s.find("copies") != std::string::npos && s.find("swaps") != std::string::npos && s.find("failed") != std::string::npos);
+  assert (s.find("\nBig ") != std::string::npos);
+  assert (s.find("\nPerThread ") != std::string::npos);
+};
+
+
+int main() { }
@@ -0,0 +1,159 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "optional_lookup.hpp"
+# include <map>
+# include <unordered_map>
+# include <vector>
+# include <array>
+# include <string>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Counted
+{
+  static int constructions;
+  int i;
+  Counted(int i = 0) : i(i) { ++constructions; }
+  Counted(const Counted& c) : i(c.i) { ++constructions; }
+};
+int Counted::constructions = 0;
+
+
+TEST(lookup_map)
+{
+  std::map<std::string, int> m {{"one", 1}, {"two", 2}};
+
+  tr2::optional<int&> o1 = tr2::lookup(m, "one");
+  assert (o1);
+  assert (*o1 == 1);
+  *o1 = 11;
+  assert (m["one"] == 11);
+
+  assert (!tr2::lookup(m, "three"));
+  assert (tr2::lookup(m, "two") == 2);
+
+  const std::map<std::string, int>& cm = m;
+  auto co = tr2::lookup(cm, "two");
+  static_assert(std::is_same<decltype(co), tr2::optional<const int&>>::value, "");
+  assert (co == 2);
+};
+
+
+TEST(lookup_unordered_map)
+{
+  std::unordered_map<int, Counted> m;
+  m.emplace(1, 1);
+  m.emplace(2, 2);
+
+  Counted::constructions = 0;
+  auto o = tr2::lookup(m, 2);
+  assert (o);
+  assert (o->i == 2);
+  assert (&*o == &m.at(2));
+  assert (!tr2::lookup(m, 3));
+  assert (Counted::constructions == 0); // no copies of the payload
+};
+
+
+# if (defined __cplusplus) && (__cplusplus >= 201402L)
+TEST(lookup_heterogeneous)
+{
+  std::map<std::string, int, std::less<>> m {{"one", 1}};
+  const char* key = "one";
+  assert (tr2::lookup(m, key) == 1);
+  assert (!tr2::lookup(m, "two"));
+};
+# endif
+
+
+TEST(lookup_sequence)
+{
+  std::vector<int> v {10, 20, 30};
+  auto o = tr2::lookup(v, 1);
+  static_assert(std::is_same<decltype(o), tr2::optional<int&>>::value, "");
+  assert (o == 20);
+  *o = 21;
+  assert (v[1] == 21);
+  assert (!tr2::lookup(v, 3));
+
+  const std::array<int, 2> a = {{1, 2}};
+  auto ca = tr2::lookup(a, 0);
+  static_assert(std::is_same<decltype(ca), tr2::optional<const int&>>::value, "");
+  assert (ca == 1);
+  assert (!tr2::lookup(a, 2));
+
+  std::vector<int> e;
+  assert (!tr2::lookup(e, 0));
+};
+
+
+TEST(lookup_or_emplace)
+{
+  std::unordered_map<int, Counted> m;
+
+  Counted::constructions = 0;
+  Counted& c = tr2::lookup_or_emplace(m, 1, 5);
+  assert (c.i == 5);
+  assert (Counted::constructions == 1);
+
+  Counted& d = tr2::lookup_or_emplace(m, 1, 7);
+  assert (&c == &d);
+  assert (d.i == 5);
+  assert (Counted::constructions == 1); // existing value is neither replaced nor built
+  assert (m.size() == 1);
+
+  std::map<std::string, std::vector<int>> mv;
+  tr2::lookup_or_emplace(mv, "a", 3, 1).push_back(2);
+  assert (mv["a"].size() == 4);
+  assert (tr2::lookup_or_emplace(mv, "a").size() == 4);
+};
+
+// before C++17 an ordered map inserts at the hint lower_bound gave
+TEST(lookup_or_emplace_ordered)
+{
+  std::map<int, int> m = { {1, 10}, {5, 50} };
+  assert (tr2::lookup_or_emplace(m, 3, 30) == 30);
+  assert (tr2::lookup_or_emplace(m, 0, 0) == 0);
+  assert (tr2::lookup_or_emplace(m, 9, 90) == 90);
+  assert (tr2::lookup_or_emplace(m, 5, 0) == 50);
+  assert (m.size() == 5);
+  int k = 0;
+  for (auto& e : m) { assert (e.first >= k); k = e.first; }
+};
+
+
+# if (defined __cplusplus) && (__cplusplus >= 201703L)
+struct CountingHash
+{
+  static int calls;
+  size_t operator()(int i) const { ++calls; return std::hash<int>{}(i); }
+};
+int CountingHash::calls = 0;
+
+TEST(lookup_or_emplace_single_hash)
+{
+  std::unordered_map<int, int, CountingHash> m;
+  CountingHash::calls = 0;
+  tr2::lookup_or_emplace(m, 1, 2);
+  assert (CountingHash::calls == 1);
+  tr2::lookup_or_emplace(m, 1, 3);
+  assert (CountingHash::calls == 2);
+  assert (m[1] == 2);
+};
+# endif
+
+
+int main() { }
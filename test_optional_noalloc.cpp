@@ -0,0 +1,196 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// optional allocates nothing itself: every operation on payloads that do not allocate is
+// checked to be free of heap traffic. Only the bad_optional_access path may allocate.
+
+# include "optional.hpp"
+# include "test_alloc.hpp"
+# include <functional>
+# include <string>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+// a payload with non-trivial special members that do not allocate
+struct Payload
+{
+  int a[8];
+  static int live;
+
+  explicit Payload(int i = 0) : a{i} { ++live; }
+  Payload(const Payload& p) { *this = p; ++live; }
+  Payload(Payload&& p) noexcept { *this = p; ++live; }
+  Payload& operator=(const Payload& p) { for (int i = 0; i != 8; ++i) a[i] = p.a[i]; return *this; }
+  Payload& operator=(Payload&& p) noexcept { return *this = static_cast<const Payload&>(p); }
+  ~Payload() { --live; }
+};
+int Payload::live = 0;
+
+bool operator==(const Payload& x, const Payload& y) { return x.a[0] == y.a[0]; }
+bool operator!=(const Payload& x, const Payload& y) { return x.a[0] != y.a[0]; }
+bool operator<(const Payload& x, const Payload& y) { return x.a[0] < y.a[0]; }
+bool operator<=(const Payload& x, const Payload& y) { return x.a[0] <= y.a[0]; }
+bool operator>(const Payload& x, const Payload& y) { return x.a[0] > y.a[0]; }
+bool operator>=(const Payload& x, const Payload& y) { return x.a[0] >= y.a[0]; }
+
+
+template <class T>
+void construction_is_allocation_free(T v)
+{
+  expect_no_alloc([&] {
+    tr2::optional<T> a;
+    tr2::optional<T> b(tr2::nullopt);
+    tr2::optional<T> c(v);
+    tr2::optional<T> d(std::move(v));
+    tr2::optional<T> e(tr2::in_place, v);
+    tr2::optional<T> f(c);
+    tr2::optional<T> g(std::move(f));
+    tr2::optional<T> h(a);
+    tr2::optional<T> i = tr2::make_optional(v);
+    (void)b; (void)d; (void)e; (void)g; (void)h; (void)i;
+  });
+}
+
+template <class T>
+void assignment_is_allocation_free(T v)
+{
+  tr2::optional<T> engaged(v), disengaged, x;
+  expect_no_alloc([&] {
+    x = engaged;             // disengaged <- engaged
+    x = engaged;             // engaged <- engaged
+    x = disengaged;          // engaged <- disengaged
+    x = disengaged;          // disengaged <- disengaged
+    x = std::move(engaged);
+    x = tr2::optional<T>(v);
+    x = tr2::nullopt;
+    x = v;
+    x = std::move(v);
+    x.emplace(v);
+    x.emplace(v);
+    x.reset();
+    x.reset();
+  });
+}
+
+template <class T>
+void swap_is_allocation_free(T v)
+{
+  tr2::optional<T> a(v), b(v), c, d;
+  expect_no_alloc([&] {
+    a.swap(b);               // both engaged
+    a.swap(c);               // engaged, disengaged
+    a.swap(c);               // disengaged, engaged
+    c.swap(d);               // neither
+    using std::swap;
+    swap(a, b);
+  });
+}
+
+template <class T>
+void observers_are_allocation_free(T v)
+{
+  tr2::optional<T> a(v), n;
+  const tr2::optional<T>& ca = a;
+  expect_no_alloc([&] {
+    assert (a && a.has_value() && !n);
+    assert (*a == v && *ca == v && a.value() == v && ca.value() == v);
+    assert (a.value_or(v) == v && n.value_or(v) == v);
+    assert (tr2::optional<T>(v).value_or(v) == v && tr2::optional<T>().value_or(v) == v);
+    (void)a.operator->();
+  });
+}
+
+template <class T>
+void comparisons_are_allocation_free(T v)
+{
+  tr2::optional<T> a(v), b(v), n;
+  expect_no_alloc([&] {
+    assert (a == b && !(a != b) && !(a < b) && a <= b && !(a > b) && a >= b);
+    assert (n != a && n < a && n <= a && a > n && a >= n);
+    assert (n == tr2::nullopt && tr2::nullopt == n && a != tr2::nullopt && tr2::nullopt != a);
+    assert (!(a < tr2::nullopt) && tr2::nullopt < a && a > tr2::nullopt && !(tr2::nullopt > a));
+    assert (a == v && v == a && n != v && v != n);
+    assert (!(a < v) && a <= v && !(v < a) && v <= a && n < v && v > n);
+  });
+}
+
+template <class T>
+void all_operations_are_allocation_free(T v)
+{
+  construction_is_allocation_free(v);
+  assignment_is_allocation_free(v);
+  swap_is_allocation_free(v);
+  observers_are_allocation_free(v);
+  comparisons_are_allocation_free(v);
+}
+
+
+TEST(int_payload)
+{
+  all_operations_are_allocation_free(7);
+  expect_no_alloc([] { (void)std::hash<tr2::optional<int>>()(tr2::optional<int>(1)); });
+};
+
+TEST(non_trivial_payload)
+{
+  all_operations_are_allocation_free(Payload(3));
+  assert (Payload::live == 0);
+};
+
+TEST(short_string_payload)
+{
+  all_operations_are_allocation_free(std::string("sso")); // fits the small string buffer
+};
+
+TEST(reference_payload)
+{
+  int i = 1, j = 2;
+  expect_no_alloc([&] {
+    tr2::optional<int&> r(i), s;
+    s = r;
+    r.emplace(j);
+    assert (r.value() == 2 && *s == 1 && s != tr2::nullopt);
+    r.swap(s);
+    r = tr2::nullopt;
+  });
+};
+
+
+// The bad_optional_access path, listed apart: the exception object itself comes from the
+// runtime's exception allocator, not from operator new, and the message is allocated by the
+// first failure only.
+# if OPTIONAL_HAS_EXCEPTIONS
+
+long failure_allocations()
+{
+  return count_allocations([] {
+    tr2::optional<int> n;
+    try { n.value(); }
+    catch (const tr2::bad_optional_access&) {}
+  });
+}
+
+TEST(bad_optional_access_path)
+{
+  long first = failure_allocations();
+  assert (first <= 1);
+  for (int i = 0; i != 10; ++i)
+    assert (failure_allocations() == 0);
+};
+
+# endif
+
+
+int main() { }
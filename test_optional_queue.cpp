@@ -0,0 +1,196 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "optional_queue.hpp"
+# include <memory>
+# include <string>
+# include <thread>
+# include <vector>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct MoveCounter
+{
+  static int moves, copies;
+  std::string s;
+  explicit MoveCounter(std::string s) : s(s) {}
+  MoveCounter(const MoveCounter& m) : s(m.s) { ++copies; }
+  MoveCounter(MoveCounter&& m) : s(std::move(m.s)) { ++moves; }
+  MoveCounter& operator=(MoveCounter&& m) { s = std::move(m.s); ++moves; return *this; }
+};
+int MoveCounter::moves = 0;
+int MoveCounter::copies = 0;
+
+
+TEST(optional_queue_fifo)
+{
+  tr2::optional_queue<int> q(3);
+  assert (q.capacity() == 4);
+  assert (!q.try_pop());
+
+  for (int i = 0; i < 4; ++i) assert (q.try_push(i));
+  assert (!q.try_push(4));                       // full
+
+  for (int i = 0; i < 4; ++i) assert (q.try_pop() == i);
+  assert (!q.try_pop());
+
+  for (int round = 0; round < 10; ++round) {     // wrap around many times
+    assert (q.try_emplace(round));
+    assert (q.try_pop() == round);
+  }
+};
+
+
+TEST(optional_queue_single_move)
+{
+  tr2::optional_queue<MoveCounter> q(4);
+  q.try_emplace("a");
+  MoveCounter::moves = MoveCounter::copies = 0;
+
+  tr2::optional<MoveCounter> o = q.try_pop();
+  assert (o && o->s == "a");
+  assert (MoveCounter::moves == 1);              // slot -> returned optional, nothing else
+  assert (MoveCounter::copies == 0);
+
+  MoveCounter::moves = 0;
+  tr2::optional<MoveCounter> e = q.try_pop();
+  assert (!e);
+  assert (MoveCounter::moves == 0);
+};
+
+
+TEST(optional_queue_bulk)
+{
+  tr2::optional_queue<std::string> q(8);
+  for (int i = 0; i < 5; ++i) q.try_push(std::string(1, char('a' + i)));
+
+  tr2::optional<std::string> out[4];
+  out[0] = std::string("old");
+  assert (q.try_pop_bulk(out, 4) == 4);
+  assert (out[0] == std::string("a") && out[3] == std::string("d"));
+
+  out[1] = tr2::nullopt;
+  assert (q.try_pop_bulk(out, 4) == 1);
+  assert (out[0] == std::string("e"));
+  assert (!out[1]);                               // untouched past the count
+  assert (q.try_pop_bulk(out, 4) == 0);
+
+# if defined __cpp_lib_span
+  q.try_push("f");
+  assert (q.try_pop_bulk(std::span<tr2::optional<std::string>>(out)) == 1);
+  assert (out[0] == std::string("f"));
+# endif
+};
+
+
+TEST(optional_queue_destroys_leftovers)
+{
+  std::shared_ptr<int> p = std::make_shared<int>(0);
+  {
+    tr2::optional_queue<std::shared_ptr<int>> q(4);
+    q.try_push(p);
+    q.try_push(p);
+    assert (p.use_count() == 3);
+  }
+  assert (p.use_count() == 1);
+};
+
+
+// a payload whose constructions throw on demand
+struct Fragile
+{
+  static bool fail;
+  int i;
+  explicit Fragile(int i) : i(i) { if (fail) throw i; }
+  Fragile(const Fragile& f) : i(f.i) { if (fail) throw i; }
+  Fragile(Fragile&& f) : i(f.i) { if (fail) throw i; }
+  Fragile& operator=(Fragile&& f) { if (fail) throw i; i = f.i; return *this; }
+};
+bool Fragile::fail = false;
+
+// a throwing construction or move does not leave a cell that the others would wait for forever
+TEST(optional_queue_throwing_payload)
+{
+  tr2::optional_queue<Fragile> q(2);
+  bool thrown = false;
+
+  Fragile::fail = true;
+  try { q.try_emplace(1); } catch (int) { thrown = true; }
+  assert (thrown);
+  Fragile::fail = false;
+  assert (q.try_emplace(2));
+  tr2::optional<Fragile> o = q.try_pop();          // skips the cell the failed push left
+  assert (o && o->i == 2);
+  assert (!q.try_pop());
+
+  assert (q.try_emplace(3));
+  Fragile::fail = true;
+  thrown = false;
+  try { q.try_pop(); } catch (int) { thrown = true; }  // the move out throws: 3 is lost
+  assert (thrown);
+  Fragile::fail = false;
+  assert (!q.try_pop());
+
+  for (int i = 0; i < 2; ++i) assert (q.try_emplace(10 + i));
+  tr2::optional<Fragile> out[2];
+  out[0].emplace(0);
+  out[1].emplace(0);
+  Fragile::fail = true;
+  thrown = false;
+  try { q.try_pop_bulk(out, 2); } catch (int) { thrown = true; }  // the rest is dropped
+  assert (thrown);
+  Fragile::fail = false;
+  assert (!q.try_pop());
+
+  for (int round = 0; round < 4; ++round) {          // every cell is usable again
+    assert (q.try_emplace(round));
+    assert (q.try_pop()->i == round);
+  }
+};
+
+
+TEST(optional_queue_mpmc)
+{
+  const int producers = 3, consumers = 3, per_producer = 20000;
+  tr2::optional_queue<int> q(64);
+  std::atomic<long> sum{0};
+  std::atomic<int> popped{0};
+  std::vector<std::thread> ts;
+
+  for (int p = 0; p < producers; ++p)
+    ts.emplace_back([&, p] {
+      for (int i = 1; i <= per_producer; ++i)
+        while (!q.try_push(p * per_producer + i)) std::this_thread::yield();
+    });
+  for (int c = 0; c < consumers; ++c)
+    ts.emplace_back([&, c] {
+      tr2::optional<int> batch[8];
+      while (popped.load() < producers * per_producer) {
+        size_t n = (c % 2) ? q.try_pop_bulk(batch, 8) : (batch[0] = q.try_pop(), size_t(batch[0] ? 1 : 0));
+        for (size_t i = 0; i != n; ++i) sum += *batch[i];
+        popped += int(n);
+        if (n == 0) std::this_thread::yield();
+      }
+    });
+  for (auto& t : ts) t.join();
+
+  long n = long(producers) * per_producer;
+  assert (popped == n);
+  assert (sum == n * (n + 1) / 2);
+  assert (!q.try_pop());
+};
+
+
+int main() { }
@@ -0,0 +1,108 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "optional_slot.hpp"
+# include <memory>
+# include <string>
+# include <thread>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct MoveCounter
+{
+  static int moves;
+  std::string s;
+  explicit MoveCounter(std::string s) : s(s) {}
+  MoveCounter(MoveCounter&& m) : s(std::move(m.s)) { ++moves; }
+};
+int MoveCounter::moves = 0;
+
+
+TEST(optional_slot_single_thread)
+{
+  tr2::optional_slot<MoveCounter> slot;
+  assert (!slot.has_value());
+  assert (!slot.try_take());
+
+  MoveCounter::moves = 0;
+  slot.emplace("one");
+  assert (slot.has_value());
+  assert (!slot.try_emplace("two"));           // previous value not taken yet
+
+  tr2::optional<MoveCounter> v = slot.try_take();
+  assert (v && v->s == "one");
+  assert (MoveCounter::moves == 1);            // moved once, from the slot into the optional
+  assert (!slot.has_value());
+
+  assert (slot.try_emplace("three"));
+  assert (slot.wait()->s == "three");
+  assert (!slot.wait_for(std::chrono::milliseconds(1)));
+
+  slot.emplace("four");
+  assert (slot.wait_for(std::chrono::seconds(0))->s == "four");
+};
+
+
+TEST(optional_slot_destroys_untaken_value)
+{
+  std::shared_ptr<int> p = std::make_shared<int>(1);
+  {
+    tr2::optional_slot<std::shared_ptr<int>> slot;
+    slot.emplace(p);
+    assert (p.use_count() == 2);
+  }
+  assert (p.use_count() == 1);
+};
+
+
+TEST(optional_slot_ping_pong)
+{
+  const int n = 20000;
+  tr2::optional_slot<int> slot;
+  long sum = 0;
+
+  std::thread consumer([&] {
+    for (int i = 0; i < n; ++i) {
+      tr2::optional<int> v = (i % 2) ? slot.wait() : slot.wait_for(std::chrono::seconds(10));
+      assert (v && *v == i);
+      sum += *v;
+    }
+  });
+  for (int i = 0; i < n; ++i)
+    slot.emplace(i);                            // blocks while the consumer lags behind
+  consumer.join();
+
+  assert (sum == long(n) * (n - 1) / 2);
+  assert (!slot.try_take());
+};
+
+
+TEST(optional_slot_timeout)
+{
+  tr2::optional_slot<int> slot;
+  auto start = std::chrono::steady_clock::now();
+  assert (!slot.wait_for(std::chrono::milliseconds(20)));
+  assert (std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+  std::thread producer([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    slot.emplace(7);
+  });
+  assert (slot.wait_for(std::chrono::seconds(10)) == 7);
+  producer.join();
+};
+
+
+int main() { }
@@ -0,0 +1,239 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Linux only. Built twice at -O2: with OPTIONAL_USDT, where the test finds the probe notes in
+// its own executable, and without, where it finds none. The build without probes is also given
+// the path of the other one, and checks that its probed functions are the smaller ones, and the
+// path of a reference build against headers with the probe call sites deleted, and checks with
+// objdump (OPTIONAL_OBJDUMP, set by the build) that its probed functions have as many
+// instructions as those: the probes add code only where they are enabled.
+
+# include "optional.hpp"
+# include <algorithm>
+# include <cstdio>
+# include <cstring>
+# include <fstream>
+# include <iterator>
+# include <string>
+# include <vector>
+# include <elf.h>
+# include <unistd.h>
+
+# if !defined OPTIONAL_OBJDUMP
+#   define OPTIONAL_OBJDUMP "objdump"
+# endif
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Record { int id; std::string name; };
+
+// the probed paths, kept out of line so that their code can be found by symbol name
+extern "C" __attribute__((noinline)) void probed_emplace(tr2::optional<Record>& o, int id) { o.emplace(Record{id, "r"}); }
+extern "C" __attribute__((noinline)) void probed_reset(tr2::optional<Record>& o) { o.reset(); }
+extern "C" __attribute__((noinline)) void probed_disengage(tr2::optional<Record>& o) { o = tr2::nullopt; }
+extern "C" __attribute__((noinline)) int probed_value(const tr2::optional<int>& o) { return o.value(); }
+extern "C" __attribute__((noinline)) void probed_ref_emplace(tr2::optional<Record&>& o, Record& r) { o.emplace(r); }
+extern "C" __attribute__((noinline)) void probed_ref_reset(tr2::optional<Record&>& o) { o.reset(); }
+extern "C" __attribute__((noinline)) void probed_ref_disengage(tr2::optional<Record&>& o) { o = tr2::nullopt; }
+
+
+class elf_image
+{
+  std::vector<char> bytes_;
+
+  const Elf64_Ehdr& header() const { return *reinterpret_cast<const Elf64_Ehdr*>(bytes_.data()); }
+
+  const Elf64_Shdr& section(size_t i) const
+  {
+    return *reinterpret_cast<const Elf64_Shdr*>(bytes_.data() + header().e_shoff + i * header().e_shentsize);
+  }
+
+  const char* section_name(const Elf64_Shdr& s) const
+  {
+    return bytes_.data() + section(header().e_shstrndx).sh_offset + s.sh_name;
+  }
+
+public:
+  explicit elf_image(const char* path)
+  {
+    std::ifstream f(path, std::ios::binary);
+    bytes_.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    assert (bytes_.size() > sizeof(Elf64_Ehdr) && std::memcmp(bytes_.data(), ELFMAG, SELFMAG) == 0);
+  }
+
+  const Elf64_Shdr* find_section(const char* name) const
+  {
+    for (size_t i = 0; i != header().e_shnum; ++i)
+      if (std::strcmp(section_name(section(i)), name) == 0) return &section(i);
+    return nullptr;
+  }
+
+  // "provider:name:arguments" for each stapsdt note
+  std::vector<std::string> probes() const
+  {
+    std::vector<std::string> ans;
+    const Elf64_Shdr* s = find_section(".note.stapsdt");
+    if (!s) return ans;
+    for (size_t at = s->sh_offset; at < s->sh_offset + s->sh_size; ) {
+      const Elf64_Nhdr& n = *reinterpret_cast<const Elf64_Nhdr*>(bytes_.data() + at);
+      const char* owner = bytes_.data() + at + sizeof(Elf64_Nhdr);
+      const char* desc = owner + ((n.n_namesz + 3) & ~3u);
+      assert (n.n_type == 3 && std::strcmp(owner, "stapsdt") == 0);
+      const char* provider = desc + 3 * 8; // after the probe, base and semaphore addresses
+      const char* name = provider + std::strlen(provider) + 1;
+      const char* args = name + std::strlen(name) + 1;
+      ans.push_back(std::string(provider) + ":" + name + ":" + args);
+      at = (desc + ((n.n_descsz + 3) & ~3u)) - bytes_.data();
+    }
+    return ans;
+  }
+
+  // the size of a function, including the part the compiler moved to name.cold
+  size_t code_size(const std::string& name) const
+  {
+    const Elf64_Shdr* s = find_section(".symtab");
+    assert (s);
+    const char* strtab = bytes_.data() + section(s->sh_link).sh_offset;
+    size_t ans = 0;
+    for (size_t at = s->sh_offset; at < s->sh_offset + s->sh_size; at += sizeof(Elf64_Sym)) {
+      const Elf64_Sym& sym = *reinterpret_cast<const Elf64_Sym*>(bytes_.data() + at);
+      if (strtab + sym.st_name == name || strtab + sym.st_name == name + ".cold") ans += sym.st_size;
+    }
+    assert (ans != 0);
+    return ans;
+  }
+};
+
+// the instructions of a function in the executable at path, with its .cold part; padding is not counted
+size_t instruction_count(const char* path, const std::string& name)
+{
+  std::string command = std::string("'") + OPTIONAL_OBJDUMP + "' -d --no-show-raw-insn '" + path + "'";
+  FILE* f = popen(command.c_str(), "r");
+  assert (f);
+  size_t ans = 0;
+  bool inside = false;
+  char buf[4096];
+  while (std::fgets(buf, sizeof buf, f)) {
+    std::string line(buf);
+    if (line[0] != ' ') {   // "0000000000001130 <probed_reset>:" or a blank line
+      inside = line.find(" <" + name + ">:") != std::string::npos || line.find(" <" + name + ".cold>:") != std::string::npos;
+      continue;
+    }
+    if (inside && line.find(":\t") != std::string::npos && line.find("nop") == std::string::npos) ++ans;
+  }
+  int status = pclose(f);
+  assert (status == 0 && ans != 0);
+  (void)status;
+  return ans;
+}
+
+size_t count_probes(const std::vector<std::string>& probes, const std::string& name)
+{
+  size_t n = 0;
+  for (const std::string& p : probes)
+    if (p.compare(0, name.size() + 1, name + ":") == 0) ++n;
+  return n;
+}
+
+
+TEST(probed_paths_behave_as_before)
+{
+  tr2::optional<Record> o;
+  probed_emplace(o, 1);
+  assert (o && o->id == 1);
+  probed_reset(o);
+  assert (!o);
+  probed_emplace(o, 2);
+  probed_disengage(o);
+  assert (!o);
+
+  assert (probed_value(tr2::optional<int>(3)) == 3);
+  bool thrown = false;
+  try { probed_value(tr2::optional<int>()); }
+  catch (const tr2::bad_optional_access&) { thrown = true; }
+  assert (thrown);
+
+  Record r{3, "r"};
+  tr2::optional<Record&> ref;
+  probed_ref_emplace(ref, r);
+  assert (ref && &*ref == &r);
+  probed_ref_reset(ref);
+  assert (!ref);
+  probed_ref_emplace(ref, r);
+  probed_ref_disengage(ref);
+  assert (!ref);
+  probed_ref_disengage(ref);
+  assert (!ref);
+};
+
+
+# if OPTIONAL_HAS_USDT
+
+TEST(probe_notes_are_in_the_executable)
+{
+  std::vector<std::string> probes = elf_image("/proc/self/exe").probes();
+  assert (count_probes(probes, "optional:emplace") >= 2);     // optional<Record> and optional<Record&>
+  assert (count_probes(probes, "optional:reset") >= 2);
+  assert (count_probes(probes, "optional:disengage") >= 2);
+  assert (count_probes(probes, "optional:value_failure") >= 1);
+
+  for (const std::string& p : probes) {
+    std::string args = p.substr(p.rfind(':') + 1);
+    assert (args.compare(0, 2, "8@") == 0);
+    assert (std::count(args.begin(), args.end(), '@') == 3); // the type's hash, size and name
+  }
+};
+
+# else
+
+TEST(no_probes_and_no_code_when_disabled)
+{
+  assert (!OPTIONAL_HAS_USDT);
+  elf_image self("/proc/self/exe");
+  assert (self.probes().empty());
+  assert (!self.find_section(".stapsdt.base"));
+};
+
+# endif
+
+
+int main(int argc, char* argv[])
+{
+# if !OPTIONAL_HAS_USDT
+  // given the build with probes: each probed function there is bigger by the probe
+  if (argc > 1) {
+    elf_image self("/proc/self/exe"), probed(argv[1]);
+    assert (!probed.probes().empty());
+    for (const char* f : { "probed_emplace", "probed_reset", "probed_disengage", "probed_value",
+                           "probed_ref_emplace", "probed_ref_reset", "probed_ref_disengage" })
+      assert (self.code_size(f) < probed.code_size(f));
+  }
+  // given the probe-free reference build: each probed function here is the same
+  if (argc > 2) {
+    assert (elf_image(argv[2]).probes().empty());
+    char self[4096];
+    ssize_t n = readlink("/proc/self/exe", self, sizeof self - 1);   // objdump's own /proc/self is objdump
+    assert (n > 0);
+    self[n] = '\0';
+    for (const char* f : { "probed_emplace", "probed_reset", "probed_disengage", "probed_value",
+                           "probed_ref_emplace", "probed_ref_reset", "probed_ref_disengage" }) {
+      size_t here = instruction_count(self, f), reference = instruction_count(argv[2], f);
+      if (here != reference) std::fprintf(stderr, "%s: %zu instructions, %zu without probes\n", f, here, reference);
+      assert (here == reference);
+    }
+  }
+# else
+  (void)argc; (void)argv;
+# endif
+}
@@ -0,0 +1,142 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "optional_with_reason.hpp"
+# include <string>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+enum class why : unsigned char { unknown, not_found, timed_out, filtered, last = 254 };
+enum legacy_why { legacy_none, legacy_gone };
+
+// the same size as optional
+static_assert(sizeof(tr2::optional_with_reason<int, why>) == sizeof(tr2::optional<int>), "bad size");
+static_assert(sizeof(tr2::optional_with_reason<char, why>) == sizeof(tr2::optional<char>), "bad size");
+static_assert(sizeof(tr2::optional_with_reason<double, legacy_why>) == sizeof(tr2::optional<double>), "bad size");
+static_assert(sizeof(tr2::optional_with_reason<std::string, why>) == sizeof(tr2::optional<std::string>), "bad size");
+static_assert(std::is_trivially_destructible<tr2::optional_with_reason<int, why>>::value, "bad dtor");
+static_assert(!std::is_trivially_destructible<tr2::optional_with_reason<std::string, why>>::value, "bad dtor");
+
+// constexpr
+constexpr tr2::optional_with_reason<int, why> ce_val {3};
+constexpr tr2::optional_with_reason<int, why> ce_empty {why::timed_out};
+static_assert(ce_val && *ce_val == 3 && ce_val.value() == 3, "bad constexpr");
+static_assert(!ce_empty && ce_empty.reason() == why::timed_out, "bad constexpr");
+static_assert(ce_empty == tr2::nullopt && ce_empty.value_or(9) == 9, "bad constexpr");
+
+
+tr2::optional_with_reason<std::string, why> find(int key)
+{
+  if (key < 0) return why::filtered;
+  if (key > 100) return why::not_found;
+  return std::to_string(key);
+}
+
+
+TEST(reasons)
+{
+  tr2::optional_with_reason<int, why> o;
+  assert (!o);
+  assert (o.reason() == why::unknown);
+  assert (o == tr2::nullopt);
+
+  o = why::not_found;
+  assert (!o.has_value());
+  assert (o.reason() == why::not_found);
+
+  o = 5;
+  assert (o && *o == 5);
+  o.reset(why::timed_out);
+  assert (o.reason() == why::timed_out);
+  o = tr2::nullopt;
+  assert (o.reason() == why::unknown);
+
+  o = why::last;
+  assert (o.reason() == why::last);
+
+  tr2::optional_with_reason<int, legacy_why> l {legacy_gone};
+  assert (l.reason() == legacy_gone);
+};
+
+
+TEST(every_reason_is_nullopt)
+{
+  tr2::optional_with_reason<int, why> a {why::filtered}, b {why::timed_out}, c {7};
+  assert (a == tr2::nullopt && tr2::nullopt == b);
+  assert (!(a != tr2::nullopt));
+  assert (a == b);            // both empty
+  assert (a != c && c == 7 && 7 == c && a != 7);
+};
+
+
+TEST(values)
+{
+  tr2::optional_with_reason<std::string, why> s = find(42);
+  assert (s && *s == "42");
+  assert (s->size() == 2);
+  assert (s.value() == "42");
+  assert (find(500).reason() == why::not_found);
+  assert (find(-1).reason() == why::filtered);
+  assert (find(-1).value_or("none") == "none");
+
+  bool thrown = false;
+  try { (void)find(-1).value(); }
+  catch (const tr2::bad_optional_access&) { thrown = true; }
+  assert (thrown);
+
+  s.emplace(3, 'z');
+  assert (*s == "zzz");
+  std::string m = std::move(s).value();
+  assert (m == "zzz");
+};
+
+
+TEST(copy_move_keep_the_reason)
+{
+  typedef tr2::optional_with_reason<std::string, why> O;
+  O e {why::timed_out};
+  O v {std::string("v")};
+
+  O c1 = e;
+  assert (c1.reason() == why::timed_out);
+  O c2 = std::move(v);
+  assert (*c2 == "v");
+
+  c2 = e;
+  assert (c2.reason() == why::timed_out);
+  c2 = O(std::string("w"));
+  assert (*c2 == "w");
+
+  swap(c2, c1);
+  assert (*c1 == "w" && c2.reason() == why::timed_out);
+  O f {why::filtered};
+  f.swap(c2);
+  assert (f.reason() == why::timed_out && c2.reason() == why::filtered);
+};
+
+
+TEST(optional_conversions)
+{
+  typedef tr2::optional_with_reason<int, why> O;
+  O a (tr2::optional<int>(1), why::not_found);
+  O b (tr2::optional<int>(), why::not_found);
+  assert (a == 1);
+  assert (b.reason() == why::not_found);
+  assert (a.to_optional() == 1);
+  assert (!b.to_optional());
+};
+
+
+int main() { }
@@ -0,0 +1,159 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "poly_optional.hpp"
+# include "test_alloc.hpp"
+# include <cstdlib>
+# include <new>
+# include <string>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Strategy
+{
+  static int alive;
+  Strategy() { ++alive; }
+  Strategy(const Strategy&) { ++alive; }
+  virtual ~Strategy() { --alive; }
+  virtual int apply(int x) const = 0;
+};
+
+int Strategy::alive = 0;
+
+struct Add : Strategy
+{
+  int n;
+  explicit Add(int n) : n(n) {}
+  Add(const Add&) = default;
+  Add(Add&& r) noexcept : Strategy(r), n(r.n) { r.n = -1; }
+  int apply(int x) const override { return x + n; }
+};
+
+struct Scale : Strategy
+{
+  double f;
+  long pad[2];
+  explicit Scale(double f) : f(f), pad() {}
+  Scale(Scale&&) noexcept = default;
+  int apply(int x) const override { return int(x * f); }
+};
+
+// Strategy is not the first base: the Base* differs from the address of the object
+struct Named
+{
+  std::string name;
+  explicit Named(std::string s) : name(std::move(s)) {}
+  Named(Named&&) noexcept = default;
+};
+
+struct Tagged : Named, Strategy
+{
+  explicit Tagged(std::string s) : Named(std::move(s)) {}
+  Tagged(Tagged&&) noexcept = default;
+  int apply(int x) const override { return x + int(name.size()); }
+};
+
+struct Big : Strategy
+{
+  char data[128];
+  int apply(int x) const override { return x; }
+};
+
+typedef tr2::poly_optional<Strategy, 64> P;
+
+static_assert(P::can_hold<Add>(), "");
+static_assert(P::can_hold<Scale>(), "");
+static_assert(P::can_hold<Tagged>(), "");
+static_assert(!P::can_hold<Big>(), "");
+static_assert(!P::can_hold<Named>(), "");
+static_assert(sizeof(P) == 64 + 2 * sizeof(void*), "");
+
+
+TEST(poly_optional_empty)
+{
+  P p;
+  assert (!p);
+  assert (p == tr2::nullopt);
+  assert (p.get() == nullptr);
+  P q {tr2::nullopt};
+  assert (!q.has_value());
+};
+
+
+TEST(poly_optional_dispatch)
+{
+  P p {Add(2)};
+  assert (p && p != tr2::nullopt);
+  assert (p->apply(1) == 3);
+  assert ((*p).apply(5) == 7);
+
+  p.emplace<Scale>(2.5);
+  assert (p->apply(2) == 5);
+
+  Tagged& t = p.emplace<Tagged>("abcd");
+  assert (p.get() == static_cast<Strategy*>(&t));
+  assert (p->apply(1) == 5);
+
+  const P& cp = p;
+  assert (cp->apply(0) == 4);
+};
+
+
+TEST(poly_optional_moves_relocate)
+{
+  Strategy::alive = 0;
+  {
+    P a {Tagged("xy")};
+    P b = std::move(a);
+    assert (!a);
+    assert (b->apply(0) == 2);
+    assert (reinterpret_cast<const char*>(b.get()) >= reinterpret_cast<const char*>(&b));
+    assert (reinterpret_cast<const char*>(b.get()) < reinterpret_cast<const char*>(&b) + sizeof(b));
+
+    P c {Add(1)};
+    c = std::move(b);
+    assert (!b && c->apply(0) == 2);
+    swap(a, c);
+    assert (!c && a->apply(1) == 3);
+    assert (Strategy::alive == 1);
+
+    a = tr2::nullopt;
+    assert (Strategy::alive == 0);
+    a.emplace<Add>(4);
+    a.reset();
+    assert (!a);
+    a.emplace<Add>(5);
+  }
+  assert (Strategy::alive == 0);
+};
+
+
+TEST(poly_optional_does_not_allocate)
+{
+  allocations = 0;
+  int sum = 0;
+  for (int i = 0; i != 100; ++i) {
+    P p;
+    if (i % 2) p.emplace<Add>(i);
+    else       p.emplace<Scale>(2.0);
+    P q = std::move(p);
+    sum += q->apply(1);
+  }
+  assert (sum > 0);
+  assert (allocations == 0);
+};
+
+
+int main() { }
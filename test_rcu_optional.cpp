@@ -0,0 +1,137 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "rcu_optional.hpp"
+# include <string>
+# include <thread>
+# include <vector>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct RouteTable
+{
+  static std::atomic<int> alive;
+  enum : unsigned { live = 0x600d, dead = 0xdead };
+  unsigned magic;
+  int version;
+  std::vector<int> routes;
+
+  explicit RouteTable(int v) : magic(live), version(v), routes(64, v) { ++alive; }
+  ~RouteTable() { magic = dead; --alive; }
+
+  bool consistent() const
+  {
+    if (magic != live) return false;
+    for (int r : routes) if (r != version) return false;
+    return true;
+  }
+};
+std::atomic<int> RouteTable::alive{0};
+
+
+TEST(rcu_optional_single_thread)
+{
+  {
+    tr2::rcu_optional<RouteTable> r;
+    assert (!r.read());
+
+    r.emplace(1);
+    {
+      auto s = r.read();
+      assert (s);
+      assert (s->version == 1);
+      assert (&*s.get() == &*s);
+
+      r.emplace(2);                             // s still sees version 1, which stays alive
+      assert (s->consistent() && s->version == 1);
+      assert (r.read()->version == 2);
+      assert (RouteTable::alive == 2);
+      assert (tr2::rcu_optional<RouteTable>::reclaim() == 1);
+    }
+    assert (tr2::rcu_optional<RouteTable>::reclaim() == 0);
+    assert (RouteTable::alive == 1);
+
+    r.reset();
+    assert (!r.read());
+    assert (tr2::rcu_optional<RouteTable>::reclaim() == 0);
+    assert (RouteTable::alive == 0);
+
+    r = tr2::nullopt;
+    r.emplace(3);
+  }
+  assert (RouteTable::alive == 0);
+
+  tr2::rcu_optional<std::string> s {tr2::in_place, "abc"};
+  assert (*s.read() == "abc");
+};
+
+
+TEST(rcu_optional_nested_snapshots)
+{
+  tr2::rcu_optional<RouteTable> a, b;
+  a.emplace(1);
+  b.emplace(2);
+  {
+    auto sa = a.read();
+    {
+      auto sb = b.read();
+      a.emplace(3);
+      b.reset();
+      assert (sb->consistent());
+    }
+    assert (sa->consistent() && sa->version == 1); // still protected by the outer section
+  }
+  a.reset();
+  assert (tr2::rcu_optional<RouteTable>::reclaim() == 0);
+  assert (RouteTable::alive == 0);
+};
+
+
+// readers must never observe a destroyed version: run under AddressSanitizer or
+// ThreadSanitizer (see the _asan and _tsan test targets) to also catch silent reuse
+TEST(rcu_optional_stress)
+{
+  const int readers = 3, writers = 2, writes = 3000;
+  tr2::rcu_optional<RouteTable> r;
+  std::atomic<bool> done{false};
+  std::vector<std::thread> ts;
+
+  for (int i = 0; i < readers; ++i)
+    ts.emplace_back([&] {
+      while (!done.load()) {
+        auto s = r.read();
+        if (s) assert (s->consistent());
+      }
+    });
+
+  std::vector<std::thread> ws;
+  for (int w = 0; w < writers; ++w)
+    ws.emplace_back([&, w] {
+      for (int i = 0; i < writes; ++i) {
+        if (i % 50 == 0) r.reset();
+        else r.emplace(w * writes + i);
+      }
+    });
+  for (auto& t : ws) t.join();
+  done = true;
+  for (auto& t : ts) t.join();
+
+  r.reset();
+  assert (tr2::rcu_optional<RouteTable>::reclaim() == 0);
+  assert (RouteTable::alive == 0);
+};
+
+
+int main() { }
@@ -0,0 +1,102 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "seqlock_optional.hpp"
+# include <thread>
+# include <vector>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Config
+{
+  int version;
+  char name[13];                                // odd size: the last word is partial
+  long checksum;
+
+  Config(int v) : version(v), name(), checksum(-v) { name[0] = char('a' + v % 26); }
+};
+
+
+TEST(seqlock_optional_semantics)
+{
+  tr2::seqlock_optional<Config> s;
+  assert (!s.load());
+  assert (!s.has_value());
+
+  s.emplace(3);
+  assert (s.has_value());
+  tr2::optional<Config> c = s.load();
+  assert (c && c->version == 3 && c->checksum == -3 && c->name[0] == 'd');
+
+  s.store(Config(4));
+  assert (s.load()->version == 4);
+
+  s.reset();
+  assert (!s.load());
+
+  s.store(tr2::nullopt);
+  assert (!s.load());
+
+  tr2::seqlock_optional<int> i {5};
+  assert (i.load() == 5);
+};
+
+
+TEST(seqlock_optional_no_torn_reads)
+{
+  const int readers = 3, writes = 20000;
+  tr2::seqlock_optional<Config> s;
+  std::atomic<bool> done{false};
+  std::vector<std::thread> ts;
+
+  for (int r = 0; r < readers; ++r)
+    ts.emplace_back([&] {
+      int last = -1;
+      while (!done.load()) {
+        tr2::optional<Config> c = s.load();
+        if (!c) continue;
+        assert (c->checksum == -c->version);     // flag and payload from the same write
+        assert (c->name[0] == char('a' + c->version % 26));
+        assert (c->version >= last);             // single writer: versions never go back
+        last = c->version;
+      }
+    });
+
+  for (int i = 0; i < writes; ++i) {
+    if (i % 100 == 99) s.reset();
+    else s.emplace(i);
+  }
+  done = true;
+  for (auto& t : ts) t.join();
+};
+
+
+TEST(seqlock_optional_concurrent_writers)
+{
+  tr2::seqlock_optional<Config> s;
+  std::vector<std::thread> ts;
+  for (int w = 0; w < 3; ++w)
+    ts.emplace_back([&, w] {
+      for (int i = 0; i < 5000; ++i) {
+        s.emplace(w * 10000 + i);
+        tr2::optional<Config> c = s.load();
+        assert (c && c->checksum == -c->version);
+      }
+    });
+  for (auto& t : ts) t.join();
+};
+
+
+int main() { }
@@ -0,0 +1,203 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Linux only: the processes share memory through a memfd
+
+# include "shm_optional.hpp"
+# include <cstddef>
+# include <cstring>
+# include <sys/mman.h>
+# include <sys/wait.h>
+# include <unistd.h>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Status
+{
+  int pid;
+  int sequence;
+  char state[6];
+  long long checksum;
+};
+
+// the documented layout
+static_assert(sizeof(tr2::shm_optional<Status>) == tr2::shm_optional<Status>::required_bytes(), "layout");
+static_assert(tr2::shm_optional<Status>::required_bytes() == 8 + 24, "layout");
+static_assert(sizeof(tr2::shm_optional<char>) == 16, "layout");
+static_assert(alignof(tr2::shm_optional<Status>) == 8, "layout");
+static_assert(tr2::shm_optional_array<Status>::required_bytes(3) == 16 + 3 * 32, "layout");
+
+
+void* map_shared(size_t bytes)
+{
+  int fd = memfd_create("test_shm_optional", 0);
+  assert (fd >= 0);
+  int r = ftruncate(fd, off_t(bytes));           // zero-filled
+  assert (r == 0);
+  (void)r;
+  void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  assert (p != MAP_FAILED);
+  close(fd);
+  return p;
+}
+
+template <class F>
+int in_child(F f)
+{
+  pid_t pid = fork();
+  assert (pid >= 0);
+  if (pid == 0) _exit(f());
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+Status make_status(int seq)
+{
+  Status s = {int(getpid()), seq, "up", 0};
+  s.checksum = 1000LL * seq + 7;
+  return s;
+}
+
+
+TEST(shm_optional_zero_memory_is_disengaged)
+{
+  void* mem = map_shared(tr2::shm_optional<Status>::required_bytes());
+  tr2::shm_optional<Status>* o = tr2::shm_optional<Status>::attach(mem);
+  assert (!o->load());
+  assert (!o->has_value());
+  assert (o->version() == 0);
+
+  o->emplace(make_status(1));
+  assert (o->load()->sequence == 1);
+  assert (o->version() == 2);
+  o->reset();
+  assert (!o->load());
+  munmap(mem, tr2::shm_optional<Status>::required_bytes());
+};
+
+
+TEST(shm_optional_cross_process)
+{
+  const int writes = 20000;
+  void* mem = map_shared(tr2::shm_optional<Status>::required_bytes());
+  tr2::shm_optional<Status>* o = tr2::shm_optional<Status>::attach(mem);
+
+  pid_t parent = getpid();
+  o->emplace(make_status(0));
+
+  // the child publishes while the parent reads: every snapshot must be consistent
+  pid_t pid = fork();
+  assert (pid >= 0);
+  if (pid == 0) {
+    tr2::shm_optional<Status>* c = tr2::shm_optional<Status>::attach(mem);
+    for (int i = 1; i <= writes; ++i) {
+      if (i % 100 == 0) c->reset();
+      else c->emplace(make_status(i));
+    }
+    c->emplace(make_status(writes + 1));
+    _exit(0);
+  }
+
+  int last = 0;
+  for (;;) {
+    tr2::optional<Status> s = o->load();
+    if (s) {
+      assert (s->checksum == 1000LL * s->sequence + 7);
+      assert (s->sequence >= last);
+      last = s->sequence;
+      if (s->sequence == writes + 1) break;
+    }
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  assert (WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  assert (o->load()->pid == pid && o->load()->pid != parent);
+
+  // and the other way round
+  o->emplace(make_status(42));
+  assert (in_child([&] { return o->load() && o->load()->sequence == 42 && o->load()->pid == parent ? 0 : 1; }) == 0);
+
+  munmap(mem, tr2::shm_optional<Status>::required_bytes());
+};
+
+
+TEST(shm_optional_array_cross_process)
+{
+  const size_t n = 8;
+  size_t bytes = tr2::shm_optional_array<Status>::required_bytes(n);
+  void* mem = map_shared(bytes);
+
+  int rc = in_child([&] {
+    tr2::shm_optional_array<Status>* a = tr2::shm_optional_array<Status>::init(mem, n);
+    if (!a || a->size() != n) return 1;
+    for (size_t i = 0; i < n; i += 2)
+      (*a)[i].emplace(make_status(int(i)));
+    return 0;
+  });
+  assert (rc == 0);
+
+  tr2::shm_optional_array<Status>* a = tr2::shm_optional_array<Status>::init(mem, n);
+  assert (a && a->size() == n);
+  for (size_t i = 0; i < n; ++i) {
+    if (i % 2) assert (!(*a)[i].load());
+    else assert ((*a)[i].load()->sequence == int(i));
+  }
+
+  assert (!tr2::shm_optional_array<Status>::init(mem, n + 1));    // layout mismatch
+  assert (!tr2::shm_optional_array<long>::init(mem, n));
+  munmap(mem, bytes);
+};
+
+
+// a process that dies between the two version stores, or while initializing an array header,
+// leaves the documented odd version or 'initializing' magic behind
+TEST(shm_optional_dead_writer_is_reported)
+{
+  size_t bytes = tr2::shm_optional<Status>::required_bytes();
+  void* mem = map_shared(bytes);
+  tr2::shm_optional<Status>* o = tr2::shm_optional<Status>::attach(mem);
+  o->emplace(make_status(1));
+
+  int rc = in_child([&] {
+    static_cast<std::atomic<uint32_t>*>(mem)->fetch_add(1);   // begins a write and dies
+    return 0;
+  });
+  assert (rc == 0);
+  tr2::optional<Status> out = make_status(2);
+  assert (!o->try_load(out, 1000));
+  assert (out->sequence == 2);
+
+  std::memset(mem, 0, bytes);                                 // the documented recovery
+  assert (o->try_load(out, 1000) && !out);
+
+  size_t n = 2, array_bytes = tr2::shm_optional_array<Status>::required_bytes(n);
+  void* array_mem = map_shared(array_bytes);
+  rc = in_child([&] {
+    static_cast<std::atomic<uint32_t>*>(array_mem)->store(1); // starts initializing and dies
+    return 0;
+  });
+  assert (rc == 0);
+  assert (!tr2::shm_optional_array<Status>::init(array_mem, n, 1000));
+  std::memset(array_mem, 0, array_bytes);
+  assert (tr2::shm_optional_array<Status>::init(array_mem, n, 1000));
+
+  munmap(mem, bytes);
+  munmap(array_mem, array_bytes);
+};
+
+
+
+int main() { }
@@ -0,0 +1,143 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# include "tls_optional.hpp"
+# include <atomic>
+# include <condition_variable>
+# include <thread>
+# include <vector>
+
+
+
+struct caller {
+    template <class T> caller(T fun) { fun(); }
+};
+# define CAT2(X, Y) X ## Y
+# define CAT(X, Y) CAT2(X, Y)
+# define TEST(NAME) caller CAT(__VAR, __LINE__) = []
+
+namespace tr2 = std::experimental;
+
+struct Tracked
+{
+  static std::atomic<int> alive;
+  int i;
+  explicit Tracked(int i) : i(i) { ++alive; }
+  ~Tracked() { --alive; }
+};
+std::atomic<int> Tracked::alive{0};
+
+
+TEST(tls_optional_single_thread)
+{
+  tr2::tls_optional<int> t;
+  assert (!t.local());
+  assert (t.reduce(0, [](int a, int b) { return a + b; }) == 0);
+
+  t.get_or_emplace(5) += 1;
+  assert (t.local() == 6);
+  assert (t.get_or_emplace(100) == 6);
+
+  tr2::tls_optional<int> u;                     // independent of t
+  assert (!u.local());
+  u.local() = 1;
+  assert (t.local() == 6);
+
+  int n = 0;
+  t.for_each_engaged([&](int& v) { ++n; v = 0; });
+  assert (n == 1);
+  assert (t.local() == 0);
+
+  t.local() = tr2::nullopt;
+  n = 0;
+  t.for_each_engaged([&](int&) { ++n; });
+  assert (n == 0);
+};
+
+
+TEST(tls_optional_reduce_across_threads)
+{
+  const int threads = 4, iterations = 1000;
+  tr2::tls_optional<long> counters;
+  std::mutex m;
+  std::condition_variable cv;
+  int done = 0;
+  bool finish = false;
+  std::vector<std::thread> ts;
+
+  for (int t = 0; t < threads; ++t)
+    ts.emplace_back([&] {
+      for (int i = 0; i < iterations; ++i)
+        ++counters.get_or_emplace(0);
+      std::unique_lock<std::mutex> lock(m);
+      ++done;
+      cv.notify_all();
+      cv.wait(lock, [&] { return finish; }); // stay alive until counted
+    });
+
+  {
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&] { return done == threads; });
+  }
+  assert (counters.reduce(0L, [](long a, long b) { return a + b; }) == long(threads) * iterations);
+  int n = 0;
+  counters.for_each_engaged([&](long& v) { ++n; assert (v == iterations); });
+  assert (n == threads);
+
+  {
+    std::lock_guard<std::mutex> lock(m);
+    finish = true;
+  }
+  cv.notify_all();
+  for (auto& t : ts) t.join();
+
+  assert (counters.reduce(0L, [](long a, long b) { return a + b; }) == 0); // exited threads are gone
+};
+
+
+// the slots are aligned to cache lines: the values of two threads are at the same offset
+// in different lines
+TEST(tls_optional_slots_are_cache_aligned)
+{
+  tr2::tls_optional<int> t;
+  uintptr_t here = reinterpret_cast<uintptr_t>(&t.local()), there = 0;
+  std::thread([&] { there = reinterpret_cast<uintptr_t>(&t.local()); }).join();
+  assert (here % OPTIONAL_CACHE_LINE_SIZE == there % OPTIONAL_CACHE_LINE_SIZE);
+  assert (here / OPTIONAL_CACHE_LINE_SIZE != there / OPTIONAL_CACHE_LINE_SIZE);
+};
+
+
+TEST(tls_optional_cleanup)
+{
+  {
+    tr2::tls_optional<Tracked> t;
+    std::thread([&] { t.get_or_emplace(1); assert (Tracked::alive == 1); }).join();
+    assert (Tracked::alive == 0);                 // destroyed at thread exit
+
+    t.get_or_emplace(2);
+    assert (Tracked::alive == 1);
+  }
+  assert (Tracked::alive == 0);                   // destroyed with the tls_optional
+
+  // a tls_optional destroyed while its threads are still running
+  std::atomic<bool> go{false}, used{false};
+  tr2::tls_optional<Tracked>* p = new tr2::tls_optional<Tracked>;
+  std::thread th([&] {
+    p->get_or_emplace(3);
+    used = true;
+    while (!go) std::this_thread::yield();
+    tr2::tls_optional<Tracked> q;                 // likely reuses the index of *p
+    assert (!q.local());
+  });
+  while (!used) std::this_thread::yield();
+  delete p;
+  assert (Tracked::alive == 0);
+  go = true;
+  th.join();
+};
+
+
+int main() { }
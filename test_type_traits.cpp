@@ -8,7 +8,9 @@
   namespace std { class type_info; }
 #endif
 
-# include "optional.hpp"
+# include "optional_layout.hpp"
+# include "expected.hpp"
+# include <memory>
 
 namespace std { namespace experimental {
 
@@ -61,6 +63,58 @@ static_assert(!is_nothrow_move_assignable<Unsafe>::value, "WTF!");
 static_assert(is_nothrow_move_constructible<VoidNothrowBoth>::value, "WTF!");
 static_assert(is_nothrow_move_assignable<VoidNothrowBoth>::value, "WTF!");
 
+// the layout of optional<T>: the flag follows the payload, padded to its alignment
+struct Pod { int i; char c; };
+struct NonPod { NonPod() {} int i; char c; };
+struct FinalNonPod final { FinalNonPod() {} int i; char c; };
+enum class Colour : unsigned char { red, green, blue };
+template <> struct optional_niche<Colour> : true_type {};
+
+template <class T>
+constexpr bool packs_flag_after_payload()
+{
+  return optional_layout<T>::size == (sizeof(T) + 1 + alignof(T) - 1) / alignof(T) * alignof(T)
+      && optional_layout<T>::size == optional_layout<T>::payload_size + optional_layout<T>::flag_size + optional_layout<T>::padding_bytes;
+}
+
+static_assert(packs_flag_after_payload<char>(), "WTF!");
+static_assert(packs_flag_after_payload<int>(), "WTF!");
+static_assert(packs_flag_after_payload<double>(), "WTF!");
+static_assert(packs_flag_after_payload<Pod>(), "WTF!");
+static_assert(packs_flag_after_payload<NonPod>(), "WTF!");
+static_assert(packs_flag_after_payload<const Safe>(), "WTF!");
+
+static_assert(optional_layout<char>::padding_bytes == 0, "WTF!");
+static_assert(optional_layout<char>::best_size == 2, "WTF!");
+static_assert(optional_layout<double>::padding_bytes == sizeof(double) - 1, "WTF!");
+static_assert(optional_layout<double>::overhead_bytes == sizeof(double), "WTF!");
+
+static_assert(optional_layout<bool>::has_niche && optional_layout<bool>::best_size == 1, "WTF!");
+static_assert(optional_layout<Colour>::has_niche && optional_layout<const Colour>::has_niche, "WTF!");
+static_assert(!optional_layout<int>::has_niche && optional_layout<int>::best_size == optional_layout<int>::size, "WTF!");
+
+static_assert(optional_layout<int&>::size == sizeof(int*), "WTF!");
+static_assert(optional_layout<int&>::flag_size == 0 && optional_layout<int&>::padding_bytes == 0, "WTF!");
+
+static_assert(!optional_layout<int>::tail_padding && !optional_layout<FinalNonPod>::tail_padding, "WTF!");
+# if defined __GNUC__ && !defined _WIN32 // the Itanium ABI reuses the tail padding of non-POD classes only
+static_assert(!optional_layout<Pod>::tail_padding, "WTF!");
+static_assert(optional_layout<NonPod>::tail_padding && optional_layout<NonPod>::best_size == sizeof(NonPod), "WTF!");
+# endif
+
+// expected<T, E> is copyable only if both T and E are
+typedef unique_ptr<int> MoveOnly;
+static_assert(!is_copy_constructible<expected<MoveOnly, int>>::value, "WTF!");
+static_assert(!is_copy_constructible<expected<int, MoveOnly>>::value, "WTF!");
+static_assert(!is_copy_assignable<expected<MoveOnly, int>>::value, "WTF!");
+static_assert(!is_copy_assignable<expected<int, MoveOnly>>::value, "WTF!");
+static_assert(is_move_constructible<expected<MoveOnly, int>>::value, "WTF!");
+static_assert(is_move_assignable<expected<int, MoveOnly>>::value, "WTF!");
+static_assert(is_copy_constructible<expected<Val, int>>::value, "WTF!");
+static_assert(!is_copy_assignable<expected<Val, int>>::value, "WTF!");
+static_assert(is_copy_assignable<expected<Safe, Unsafe>>::value, "WTF!");
+static_assert(sizeof(expected<MoveOnly, int>) == sizeof(optional<MoveOnly>), "WTF!");
+
 }} // namespace std::experimental
 
 int main() { }
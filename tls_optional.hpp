@@ -0,0 +1,234 @@
+// Copyright (C) 2011 - 2017 Andrzej Krzemienski.
+//
+// Use, modification, and distribution is subject to the Boost Software
+// License, Version 1.0. (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+# ifndef ___TLS_OPTIONAL_HPP___
+# define ___TLS_OPTIONAL_HPP___
+
+# include "optional.hpp"
+# include <cstdint>
+# include <memory>
+# include <mutex>
+# include <vector>
+
+# if !defined OPTIONAL_CACHE_LINE_SIZE
+#   define OPTIONAL_CACHE_LINE_SIZE 64
+# endif
+
+namespace std{
+
+namespace experimental{
+
+namespace detail_
+{
+
+struct tls_thread_record;
+
+// one per (tls_optional object, thread) pair; linked into the owning object's list
+struct tls_slot_base
+{
+  tls_slot_base* prev;
+  tls_slot_base* next;
+  tls_thread_record* thread;
+  size_t index;
+
+  tls_slot_base() noexcept : prev(this), next(this), thread(nullptr), index(0) {}
+  virtual ~tls_slot_base() {}
+
+  void link_before(tls_slot_base* pos) noexcept
+  {
+    prev = pos->prev;
+    next = pos;
+    pos->prev->next = this;
+    pos->prev = this;
+  }
+
+  void unlink() noexcept
+  {
+    prev->next = next;
+    next->prev = prev;
+    prev = next = this;
+  }
+};
+
+// storage aligned to align for class-specific operator new before C++17, where new does not
+// honour the alignment of over-aligned types; the block's own address is kept just before
+inline void* tls_aligned_allocate(size_t n, size_t align)
+{
+  void* raw = ::operator new(n + align + sizeof(void*));
+  uintptr_t a = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + align - 1) & ~uintptr_t(align - 1);
+  reinterpret_cast<void**>(a)[-1] = raw;
+  return reinterpret_cast<void*>(a);
+}
+
+inline void tls_aligned_deallocate(void* p) noexcept
+{
+  if (p) ::operator delete(static_cast<void**>(p)[-1]);
+}
+
+// Slow paths only: creating a slot, thread exit, destroying a tls_optional
+// and enumeration. The registry is leaked so that it outlives all thread_locals.
+struct tls_registry
+{
+  std::mutex mutex;
+  std::vector<size_t> free_indices;
+  size_t next_index;
+
+  tls_registry() : next_index(0) {}
+
+  static tls_registry& get()
+  {
+    static tls_registry& r = *new tls_registry;
+    return r;
+  }
+
+  size_t acquire_index()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_indices.empty()) return next_index++;
+    size_t i = free_indices.back();
+    free_indices.pop_back();
+    return i;
+  }
+};
+
+// this thread's slots, indexed by tls_optional object; read without locking by the owning thread
+struct tls_thread_record
+{
+  std::vector<tls_slot_base*> slots;
+
+  tls_thread_record() { tls_registry::get(); }
+
+  // values are destroyed outside the lock, their destructors may use other tls_optionals
+  ~tls_thread_record()
+  {
+    {
+      std::lock_guard<std::mutex> lock(tls_registry::get().mutex);
+      for (tls_slot_base* s : slots)
+        if (s) s->unlink();
+    }
+    for (tls_slot_base* s : slots)
+      delete s;
+  }
+
+  static tls_thread_record& current()
+  {
+    static thread_local tls_thread_record r;
+    return r;
+  }
+};
+
+} // namespace detail_
+
+
+// tls_optional<T>: one lazily constructed optional<T> per thread that uses this object.
+// The owning thread reads and writes its own optional without locking. All engaged values
+// can be visited with for_each_engaged() or folded with reduce(); these do not synchronize
+// with the owning threads' writes, so they are meant for atomic payloads or quiescent
+// owners. A thread's optional is destroyed when the thread exits.
+template <class T>
+class tls_optional
+{
+  static_assert( !std::is_reference<T>::value, "bad T" );
+
+  // each slot starts a cache line of its own, so the values of different threads never share one
+  struct alignas(OPTIONAL_CACHE_LINE_SIZE) slot : detail_::tls_slot_base
+  {
+    optional<T> value;
+# if !defined __cpp_aligned_new
+    static void* operator new(size_t n) { return detail_::tls_aligned_allocate(n, alignof(slot)); }
+    static void operator delete(void* p) noexcept { detail_::tls_aligned_deallocate(p); }
+# endif
+  };
+
+  detail_::tls_slot_base head_;
+  size_t index_;
+
+  optional<T>& make_local()
+  {
+    detail_::tls_thread_record& rec = detail_::tls_thread_record::current();
+    std::unique_ptr<slot> s (new slot);
+    std::lock_guard<std::mutex> lock(detail_::tls_registry::get().mutex);
+    if (rec.slots.size() <= index_) rec.slots.resize(index_ + 1, nullptr);
+    s->thread = &rec;
+    s->index = index_;
+    s->link_before(&head_);
+    rec.slots[index_] = s.get();
+    return s.release()->value;
+  }
+
+public:
+  typedef T value_type;
+
+  tls_optional() : index_(detail_::tls_registry::get().acquire_index()) {}
+
+  tls_optional(const tls_optional&) = delete;
+  tls_optional& operator=(const tls_optional&) = delete;
+
+  ~tls_optional()
+  {
+    detail_::tls_registry& reg = detail_::tls_registry::get();
+    std::vector<detail_::tls_slot_base*> dead;
+    {
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      while (head_.next != &head_) {
+        detail_::tls_slot_base* s = head_.next;
+        s->unlink();
+        s->thread->slots[s->index] = nullptr;
+        dead.push_back(s);
+      }
+      reg.free_indices.push_back(index_);
+    }
+    for (detail_::tls_slot_base* s : dead)
+      delete s;
+  }
+
+  // the calling thread's optional; disengaged on first access
+  optional<T>& local()
+  {
+    detail_::tls_thread_record& rec = detail_::tls_thread_record::current();
+    if (index_ < rec.slots.size() && rec.slots[index_])
+      return static_cast<slot*>(rec.slots[index_])->value;
+    return make_local();
+  }
+
+  // the calling thread's value, emplaced from args if it is disengaged
+  template <class... Args>
+  T& get_or_emplace(Args&&... args)
+  {
+    optional<T>& o = local();
+    if (!o) o.emplace(std::forward<Args>(args)...);
+    return *o;
+  }
+
+  // calls f(T&) for the engaged value of each thread
+  template <class F>
+  void for_each_engaged(F f)
+  {
+    std::lock_guard<std::mutex> lock(detail_::tls_registry::get().mutex);
+    for (detail_::tls_slot_base* s = head_.next; s != &head_; s = s->next) {
+      optional<T>& o = static_cast<slot*>(s)->value;
+      if (o) f(*o);
+    }
+  }
+
+  // folds the engaged values of all threads: op(...op(op(init, v1), v2)..., vn)
+  template <class U, class BinaryOp>
+  U reduce(U init, BinaryOp op) const
+  {
+    std::lock_guard<std::mutex> lock(detail_::tls_registry::get().mutex);
+    for (const detail_::tls_slot_base* s = head_.next; s != &head_; s = s->next) {
+      const optional<T>& o = static_cast<const slot*>(s)->value;
+      if (o) init = op(std::move(init), *o);
+    }
+    return init;
+  }
+};
+
+
+} // namespace experimental
+} // namespace std
+
+# endif //___TLS_OPTIONAL_HPP___